@@ -0,0 +1,207 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/face_association.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mediapipe {
+namespace autoflip {
+
+namespace {
+// Avoids dividing by zero for empty boxes, whose overlap is zero.
+constexpr float kMinEnclosingArea = std::numeric_limits<float>::min();
+}  // namespace
+
+void FaceBoxes::Clear() {
+  xmin.clear();
+  ymin.clear();
+  xmax.clear();
+  ymax.clear();
+}
+
+void FaceBoxes::Add(const Detection& detection) {
+  const auto& box = detection.location_data().relative_bounding_box();
+  xmin.push_back(box.xmin());
+  ymin.push_back(box.ymin());
+  xmax.push_back(box.xmin() + box.width());
+  ymax.push_back(box.ymin() + box.height());
+}
+
+void FaceBoxes::Swap(FaceBoxes* other) {
+  xmin.swap(other->xmin);
+  ymin.swap(other->ymin);
+  xmax.swap(other->xmax);
+  ymax.swap(other->ymax);
+}
+
+float FaceOverlap(float xmin_1, float ymin_1, float xmax_1, float ymax_1,
+                  float xmin_2, float ymin_2, float xmax_2, float ymax_2) {
+  const float inter_width =
+      std::max(0.0f, std::min(xmax_1, xmax_2) - std::max(xmin_1, xmin_2));
+  const float inter_height =
+      std::max(0.0f, std::min(ymax_1, ymax_2) - std::max(ymin_1, ymin_2));
+  const float enclosing_area =
+      (std::max(xmax_1, xmax_2) - std::min(xmin_1, xmin_2)) *
+      (std::max(ymax_1, ymax_2) - std::min(ymin_1, ymin_2));
+  return inter_width * inter_height /
+         std::max(enclosing_area, kMinEnclosingArea);
+}
+
+void ComputeOverlapMatrix(const FaceBoxes& rows, const FaceBoxes& cols,
+                          std::vector<float>* overlap) {
+  const int num_rows = rows.size();
+  const int num_cols = cols.size();
+  overlap->resize(num_rows * num_cols);
+  for (int i = 0; i < num_rows; ++i) {
+    float* out = overlap->data() + i * num_cols;
+    int j = 0;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 min_area = _mm_set1_ps(kMinEnclosingArea);
+    const __m128 xmin_1 = _mm_set1_ps(rows.xmin[i]);
+    const __m128 ymin_1 = _mm_set1_ps(rows.ymin[i]);
+    const __m128 xmax_1 = _mm_set1_ps(rows.xmax[i]);
+    const __m128 ymax_1 = _mm_set1_ps(rows.ymax[i]);
+    for (; j + 4 <= num_cols; j += 4) {
+      const __m128 xmin_2 = _mm_loadu_ps(cols.xmin.data() + j);
+      const __m128 ymin_2 = _mm_loadu_ps(cols.ymin.data() + j);
+      const __m128 xmax_2 = _mm_loadu_ps(cols.xmax.data() + j);
+      const __m128 ymax_2 = _mm_loadu_ps(cols.ymax.data() + j);
+      const __m128 inter_width = _mm_max_ps(
+          zero, _mm_sub_ps(_mm_min_ps(xmax_1, xmax_2),
+                           _mm_max_ps(xmin_1, xmin_2)));
+      const __m128 inter_height = _mm_max_ps(
+          zero, _mm_sub_ps(_mm_min_ps(ymax_1, ymax_2),
+                           _mm_max_ps(ymin_1, ymin_2)));
+      const __m128 enclosing_area = _mm_mul_ps(
+          _mm_sub_ps(_mm_max_ps(xmax_1, xmax_2), _mm_min_ps(xmin_1, xmin_2)),
+          _mm_sub_ps(_mm_max_ps(ymax_1, ymax_2), _mm_min_ps(ymin_1, ymin_2)));
+      _mm_storeu_ps(out + j,
+                    _mm_div_ps(_mm_mul_ps(inter_width, inter_height),
+                               _mm_max_ps(enclosing_area, min_area)));
+    }
+#endif
+    for (; j < num_cols; ++j) {
+      out[j] = FaceOverlap(rows.xmin[i], rows.ymin[i], rows.xmax[i],
+                           rows.ymax[i], cols.xmin[j], cols.ymin[j],
+                           cols.xmax[j], cols.ymax[j]);
+    }
+  }
+}
+
+void FaceAssociation::Match(const std::vector<Detection>& detections,
+                            std::vector<int>* previous_face_ids) {
+  boxes_.Clear();
+  for (const auto& detection : detections) {
+    boxes_.Add(detection);
+  }
+  const int num_faces = boxes_.size();
+  const int num_previous_faces = previous_boxes_.size();
+  previous_face_ids->assign(num_faces, -1);
+
+  if (num_faces > 0 && num_previous_faces > 0) {
+    ComputeOverlapMatrix(boxes_, previous_boxes_, &overlap_);
+    // The assignment is solved with rows no more than columns, so the
+    // matrix is transposed if there are more faces than previous faces.
+    const bool transposed = num_faces > num_previous_faces;
+    const int num_rows = transposed ? num_previous_faces : num_faces;
+    const int num_cols = transposed ? num_faces : num_previous_faces;
+    cost_.resize(num_rows * num_cols);
+    for (int i = 0; i < num_faces; ++i) {
+      for (int j = 0; j < num_previous_faces; ++j) {
+        float overlap = overlap_[i * num_previous_faces + j];
+        // Pairs below the threshold cost as much as not matching.
+        if (overlap < iou_threshold_) overlap = 0.0f;
+        const int index = transposed ? j * num_cols + i : i * num_cols + j;
+        cost_[index] = 1.0f - overlap;
+      }
+    }
+    SolveAssignment(cost_, num_rows, num_cols, &assignment_);
+    for (int row = 0; row < num_rows; ++row) {
+      const int col = assignment_[row];
+      const int face = transposed ? col : row;
+      const int previous_face = transposed ? row : col;
+      if (overlap_[face * num_previous_faces + previous_face] >=
+          iou_threshold_) {
+        (*previous_face_ids)[face] = previous_face;
+      }
+    }
+  }
+
+  previous_boxes_.Swap(&boxes_);
+}
+
+// Hungarian method with potentials, O(num_rows^2 * num_cols). Indices in
+// the scratch buffers are 1-based, 0 is a virtual column.
+void FaceAssociation::SolveAssignment(const std::vector<float>& cost,
+                                      int num_rows, int num_cols,
+                                      std::vector<int>* assignment) {
+  const float kInf = std::numeric_limits<float>::max();
+  u_.assign(num_rows + 1, 0.0f);
+  v_.assign(num_cols + 1, 0.0f);
+  p_.assign(num_cols + 1, 0);
+  way_.assign(num_cols + 1, 0);
+  for (int i = 1; i <= num_rows; ++i) {
+    p_[0] = i;
+    int j0 = 0;
+    min_v_.assign(num_cols + 1, kInf);
+    used_.assign(num_cols + 1, 0);
+    do {
+      used_[j0] = 1;
+      const int i0 = p_[j0];
+      float delta = kInf;
+      int j1 = 0;
+      for (int j = 1; j <= num_cols; ++j) {
+        if (used_[j]) continue;
+        const float cur =
+            cost[(i0 - 1) * num_cols + (j - 1)] - u_[i0] - v_[j];
+        if (cur < min_v_[j]) {
+          min_v_[j] = cur;
+          way_[j] = j0;
+        }
+        if (min_v_[j] < delta) {
+          delta = min_v_[j];
+          j1 = j;
+        }
+      }
+      for (int j = 0; j <= num_cols; ++j) {
+        if (used_[j]) {
+          u_[p_[j]] += delta;
+          v_[j] -= delta;
+        } else {
+          min_v_[j] -= delta;
+        }
+      }
+      j0 = j1;
+    } while (p_[j0] != 0);
+    do {
+      const int j1 = way_[j0];
+      p_[j0] = p_[j1];
+      j0 = j1;
+    } while (j0 != 0);
+  }
+  assignment->assign(num_rows, -1);
+  for (int j = 1; j <= num_cols; ++j) {
+    if (p_[j] != 0) (*assignment)[p_[j] - 1] = j - 1;
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
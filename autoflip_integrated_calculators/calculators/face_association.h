@@ -0,0 +1,101 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FACE_ASSOCIATION_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FACE_ASSOCIATION_H_
+
+#include <vector>
+
+#include "mediapipe/framework/formats/detection.pb.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Face bounding boxes in structure-of-arrays layout, so that one box can be
+// compared against several others with SIMD instructions.
+struct FaceBoxes {
+  std::vector<float> xmin;
+  std::vector<float> ymin;
+  std::vector<float> xmax;
+  std::vector<float> ymax;
+
+  int size() const { return xmin.size(); }
+  void Clear();
+  // Appends the relative bounding box of the detection.
+  void Add(const Detection& detection);
+  void Swap(FaceBoxes* other);
+};
+
+// Overlap of two boxes used to associate faces: the intersection area over
+// the area of the smallest box enclosing both boxes. This is the measure of
+// cv::Rect2f (a & b).area() / (a | b).area().
+float FaceOverlap(float xmin_1, float ymin_1, float xmax_1, float ymax_1,
+                  float xmin_2, float ymin_2, float xmax_2, float ymax_2);
+
+// Computes the overlap of every pair of boxes into a row-major
+// rows.size() x cols.size() matrix. Uses SSE when available.
+void ComputeOverlapMatrix(const FaceBoxes& rows, const FaceBoxes& cols,
+                          std::vector<float>* overlap);
+
+// Associates the faces of consecutive frames. Faces are matched one to one
+// by maximizing the total overlap over all pairs (Hungarian method), and
+// pairs whose overlap is below the threshold are not matched.
+//
+// Example:
+//   FaceAssociation association(iou_threshold);
+//   for each frame:
+//     association.Match(detections, &previous_face_ids);
+class FaceAssociation {
+ public:
+  explicit FaceAssociation(float iou_threshold = 0.5f)
+      : iou_threshold_(iou_threshold) {}
+
+  // Matches the faces to the faces passed to the previous call.
+  // previous_face_ids[i] is the index of the previous face matched to face
+  // i, or -1 if face i is new. A previous face is matched at most once.
+  void Match(const std::vector<Detection>& detections,
+             std::vector<int>* previous_face_ids);
+
+  // Forgets the faces of the previous call.
+  void Reset() { previous_boxes_.Clear(); }
+
+  void set_iou_threshold(float iou_threshold) {
+    iou_threshold_ = iou_threshold;
+  }
+
+ private:
+  // Minimum cost assignment of a num_rows x num_cols cost matrix with
+  // num_rows <= num_cols. assignment[i] is the column of row i.
+  void SolveAssignment(const std::vector<float>& cost, int num_rows,
+                       int num_cols, std::vector<int>* assignment);
+
+  float iou_threshold_;
+  FaceBoxes previous_boxes_;
+  FaceBoxes boxes_;
+  // Scratch buffers, reused across frames.
+  std::vector<float> overlap_;
+  std::vector<float> cost_;
+  std::vector<int> assignment_;
+  std::vector<float> u_;
+  std::vector<float> v_;
+  std::vector<float> min_v_;
+  std::vector<int> p_;
+  std::vector<int> way_;
+  std::vector<char> used_;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FACE_ASSOCIATION_H_
@@ -0,0 +1,110 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the face association of LipTrackCalculator by number of faces.
+//
+// bazel run -c opt \
+//   mediapipe/examples/desktop/autoflip/calculators:face_association_benchmark
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/face_association.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kNumOfFrames = 64;
+const float kIouThreshold = 0.5;
+
+// Faces laid out on a grid, as in a panel or a classroom, which jitter
+// from frame to frame.
+std::vector<std::vector<Detection>> CreateFrames(int num_faces) {
+  std::mt19937 generator(num_faces);
+  std::uniform_real_distribution<float> jitter(-0.005, 0.005);
+  const int grid = std::ceil(std::sqrt(num_faces));
+  const float size = 0.8f / grid;
+  std::vector<std::vector<Detection>> frames(kNumOfFrames);
+  for (auto& faces : frames) {
+    for (int i = 0; i < num_faces; ++i) {
+      Detection face;
+      auto* bbox =
+          face.mutable_location_data()->mutable_relative_bounding_box();
+      bbox->set_xmin((i % grid) / static_cast<float>(grid) + jitter(generator));
+      bbox->set_ymin((i / grid) / static_cast<float>(grid) + jitter(generator));
+      bbox->set_width(size);
+      bbox->set_height(size);
+      faces.push_back(face);
+    }
+  }
+  return frames;
+}
+
+void BM_FaceAssociation(benchmark::State& state) {
+  const auto frames = CreateFrames(state.range(0));
+  FaceAssociation association(kIouThreshold);
+  std::vector<int> previous_face_ids;
+  int frame = 0;
+  for (auto _ : state) {
+    association.Match(frames[frame++ % kNumOfFrames], &previous_face_ids);
+    benchmark::DoNotOptimize(previous_face_ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FaceAssociation)->DenseRange(1, 4)->RangeMultiplier(2)->Range(8, 32);
+
+// The greedy matching LipTrackCalculator used before, which reads every
+// box from the Detection protos for every pair.
+void BM_GreedyMatching(benchmark::State& state) {
+  const auto frames = CreateFrames(state.range(0));
+  std::vector<int> previous_face_ids;
+  int frame = 0;
+  for (auto _ : state) {
+    const auto& previous = frames[frame % kNumOfFrames];
+    const auto& current = frames[(frame + 1) % kNumOfFrames];
+    ++frame;
+    previous_face_ids.clear();
+    for (const auto& face : current) {
+      const auto& box_1 = face.location_data().relative_bounding_box();
+      int idx = -1;
+      float max_iou = 0;
+      for (int i = 0; i < previous.size(); ++i) {
+        const auto& box_2 = previous[i].location_data().relative_bounding_box();
+        const float iou = FaceOverlap(
+            box_1.xmin(), box_1.ymin(), box_1.xmin() + box_1.width(),
+            box_1.ymin() + box_1.height(), box_2.xmin(), box_2.ymin(),
+            box_2.xmin() + box_2.width(), box_2.ymin() + box_2.height());
+        if (iou >= kIouThreshold && iou > max_iou) {
+          max_iou = iou;
+          idx = i;
+        }
+      }
+      previous_face_ids.push_back(idx);
+    }
+    benchmark::DoNotOptimize(previous_face_ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GreedyMatching)->DenseRange(1, 4)->RangeMultiplier(2)->Range(8, 32);
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+BENCHMARK_MAIN();
@@ -0,0 +1,116 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/face_association.h"
+
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const float kIouThreshold = 0.3;
+
+Detection CreateFace(const float xmin, const float ymin, const float width,
+                     const float height) {
+  Detection face;
+  LocationData* location_data = face.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(xmin);
+  bbox->set_ymin(ymin);
+  bbox->set_width(width);
+  bbox->set_height(height);
+  return face;
+}
+
+TEST(FaceAssociationTest, OverlapMatrixMatchesScalarOverlap) {
+  // Seven columns cover both the vectorized and the remaining columns.
+  FaceBoxes rows, cols;
+  for (int i = 0; i < 3; ++i) {
+    rows.Add(CreateFace(0.1 * i, 0.2, 0.3, 0.3));
+  }
+  for (int i = 0; i < 7; ++i) {
+    cols.Add(CreateFace(0.05 * i, 0.1 + 0.02 * i, 0.25, 0.4));
+  }
+  std::vector<float> overlap;
+  ComputeOverlapMatrix(rows, cols, &overlap);
+  ASSERT_EQ(rows.size() * cols.size(), overlap.size());
+  for (int i = 0; i < rows.size(); ++i) {
+    for (int j = 0; j < cols.size(); ++j) {
+      EXPECT_FLOAT_EQ(
+          FaceOverlap(rows.xmin[i], rows.ymin[i], rows.xmax[i], rows.ymax[i],
+                      cols.xmin[j], cols.ymin[j], cols.xmax[j], cols.ymax[j]),
+          overlap[i * cols.size() + j]);
+    }
+  }
+}
+
+TEST(FaceAssociationTest, OverlapOfDisjointAndSameBoxes) {
+  EXPECT_FLOAT_EQ(0.0, FaceOverlap(0.0, 0.0, 0.1, 0.1, 0.5, 0.5, 0.6, 0.6));
+  EXPECT_FLOAT_EQ(1.0, FaceOverlap(0.2, 0.2, 0.4, 0.5, 0.2, 0.2, 0.4, 0.5));
+  EXPECT_FLOAT_EQ(0.0, FaceOverlap(0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2, 0.2));
+}
+
+TEST(FaceAssociationTest, NewFacesAreNotMatched) {
+  FaceAssociation association(kIouThreshold);
+  std::vector<int> previous_face_ids;
+  association.Match({CreateFace(0.1, 0.1, 0.2, 0.2)}, &previous_face_ids);
+  EXPECT_THAT(previous_face_ids, ::testing::ElementsAre(-1));
+  association.Match({CreateFace(0.6, 0.6, 0.2, 0.2),
+                     CreateFace(0.11, 0.1, 0.2, 0.2)},
+                    &previous_face_ids);
+  EXPECT_THAT(previous_face_ids, ::testing::ElementsAre(-1, 0));
+}
+
+TEST(FaceAssociationTest, PreviousFaceIsMatchedOnce) {
+  FaceAssociation association(kIouThreshold);
+  std::vector<int> previous_face_ids;
+  association.Match({CreateFace(0.1, 0.1, 0.2, 0.2)}, &previous_face_ids);
+  // Both faces overlap the previous face, only the closest one takes it.
+  association.Match({CreateFace(0.15, 0.1, 0.2, 0.2),
+                     CreateFace(0.1, 0.1, 0.2, 0.2)},
+                    &previous_face_ids);
+  EXPECT_THAT(previous_face_ids, ::testing::ElementsAre(-1, 0));
+}
+
+TEST(FaceAssociationTest, AssignmentMaximizesTotalOverlap) {
+  FaceAssociation association(kIouThreshold);
+  std::vector<int> previous_face_ids;
+  association.Match({CreateFace(0.0, 0.0, 0.4, 0.4),
+                     CreateFace(0.1, 0.0, 0.4, 0.4)},
+                    &previous_face_ids);
+  // A greedy match would give face 0 the previous face 1 and leave face 1
+  // with a worse match.
+  association.Match({CreateFace(0.06, 0.0, 0.4, 0.4),
+                     CreateFace(0.14, 0.0, 0.4, 0.4)},
+                    &previous_face_ids);
+  EXPECT_THAT(previous_face_ids, ::testing::ElementsAre(0, 1));
+}
+
+TEST(FaceAssociationTest, Reset) {
+  FaceAssociation association(kIouThreshold);
+  std::vector<int> previous_face_ids;
+  association.Match({CreateFace(0.1, 0.1, 0.2, 0.2)}, &previous_face_ids);
+  association.Reset();
+  association.Match({CreateFace(0.1, 0.1, 0.2, 0.2)}, &previous_face_ids);
+  EXPECT_THAT(previous_face_ids, ::testing::ElementsAre(-1));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
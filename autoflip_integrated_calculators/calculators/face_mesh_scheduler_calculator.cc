@@ -0,0 +1,194 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/face_association.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/face_mesh_scheduler_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Frames to schedule. Only the timestamps of the packets are used.
+constexpr char kInputVideo[] = "VIDEO";
+// Face detections of the frames, from a face detector that is much cheaper
+// than the face mesh.
+constexpr char kInputDetection[] = "DETECTIONS";
+// (Optional) The first frame of a shot is a keyframe. The stream is read on
+// every timestamp, not only on the VIDEO ones, so that a boundary on a frame
+// gated out of VIDEO makes the next VIDEO frame a keyframe.
+constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+constexpr char kOutputKeyframe[] = "KEYFRAME";
+
+// This calculator decides on which frames the face mesh runs, so that the
+// mesh is only computed on keyframes and the lip landmarks are tracked in
+// between (see LipLandmarkTrackerCalculator).
+//
+// A frame is a keyframe when max_keyframe_interval frames passed since the
+// last keyframe, on a shot boundary, when the number of faces changes, and
+// when a face moved by more than max_face_motion since the last keyframe.
+// The keyframes are thus rare on static faces and frequent on moving ones.
+// The KEYFRAME output, one bool per VIDEO packet, is meant to be the ALLOW
+// stream of a GateCalculator in front of the face mesh.
+//
+// Example:
+//    calculator: "FaceMeshSchedulerCalculator"
+//    input_stream: "VIDEO:input_video"
+//    input_stream: "DETECTIONS:face_detections"
+//    input_stream: "SHOT_BOUNDARIES:shot_change"
+//    output_stream: "KEYFRAME:is_keyframe"
+//    options: {
+//      [mediapipe.autoflip.FaceMeshSchedulerCalculatorOptions.ext]: {
+//        max_keyframe_interval: 4
+//      }
+//    }
+class FaceMeshSchedulerCalculator : public CalculatorBase {
+ public:
+  FaceMeshSchedulerCalculator() {}
+  ~FaceMeshSchedulerCalculator() override {}
+  FaceMeshSchedulerCalculator(const FaceMeshSchedulerCalculator&) = delete;
+  FaceMeshSchedulerCalculator& operator=(const FaceMeshSchedulerCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Returns true if a face of boxes_ is new or moved too much since the
+  // last keyframe.
+  bool FacesMoved();
+
+  FaceMeshSchedulerCalculatorOptions options_;
+  // Faces of the current frame and of the last keyframe.
+  FaceBoxes boxes_;
+  FaceBoxes keyframe_boxes_;
+  std::vector<float> overlap_;
+  // True if a shot boundary was received since the last keyframe.
+  bool pending_shot_boundary_ = false;
+  // Frames since the last keyframe, -1 before the first one.
+  int frames_since_keyframe_ = -1;
+  int64 num_frames_ = 0;
+  int64 num_keyframes_ = 0;
+};
+REGISTER_CALCULATOR(FaceMeshSchedulerCalculator);
+
+::mediapipe::Status FaceMeshSchedulerCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputVideo).SetAny();
+  cc->Inputs().Tag(kInputDetection).Set<std::vector<Detection>>();
+  if (cc->Inputs().HasTag(kInputShotBoundaries)) {
+    cc->Inputs().Tag(kInputShotBoundaries).Set<bool>();
+  }
+  cc->Outputs().Tag(kOutputKeyframe).Set<bool>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status FaceMeshSchedulerCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  options_ = cc->Options<FaceMeshSchedulerCalculatorOptions>();
+  RET_CHECK_GE(options_.max_keyframe_interval(), 1);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status FaceMeshSchedulerCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  if (cc->Inputs().HasTag(kInputShotBoundaries) &&
+      !cc->Inputs().Tag(kInputShotBoundaries).IsEmpty() &&
+      cc->Inputs().Tag(kInputShotBoundaries).Get<bool>()) {
+    pending_shot_boundary_ = true;
+  }
+  if (cc->Inputs().Tag(kInputVideo).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  // The face detector outputs no packet when there is no face.
+  boxes_.Clear();
+  if (!cc->Inputs().Tag(kInputDetection).IsEmpty()) {
+    for (const auto& detection :
+         cc->Inputs().Tag(kInputDetection).Get<std::vector<Detection>>()) {
+      boxes_.Add(detection);
+    }
+  }
+
+  const bool is_keyframe =
+      frames_since_keyframe_ < 0 ||
+      frames_since_keyframe_ + 1 >= options_.max_keyframe_interval() ||
+      pending_shot_boundary_ || boxes_.size() != keyframe_boxes_.size() ||
+      FacesMoved();
+  if (is_keyframe) {
+    keyframe_boxes_.Swap(&boxes_);
+    pending_shot_boundary_ = false;
+    frames_since_keyframe_ = 0;
+    ++num_keyframes_;
+  } else {
+    ++frames_since_keyframe_;
+  }
+  ++num_frames_;
+
+  cc->Outputs()
+      .Tag(kOutputKeyframe)
+      .Add(new bool(is_keyframe), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status FaceMeshSchedulerCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  VLOG(1) << "Face mesh run on " << num_keyframes_ << " keyframes out of "
+          << num_frames_ << " frames.";
+  return ::mediapipe::OkStatus();
+}
+
+bool FaceMeshSchedulerCalculator::FacesMoved() {
+  if (boxes_.size() == 0) {
+    return false;
+  }
+  ComputeOverlapMatrix(boxes_, keyframe_boxes_, &overlap_);
+  const int num_keyframe_faces = keyframe_boxes_.size();
+  for (int i = 0; i < boxes_.size(); ++i) {
+    const auto row = overlap_.begin() + i * num_keyframe_faces;
+    const auto best = std::max_element(row, row + num_keyframe_faces);
+    if (*best < options_.min_face_overlap()) {
+      return true;
+    }
+    const int j = best - row;
+    const float width = keyframe_boxes_.xmax[j] - keyframe_boxes_.xmin[j];
+    if (width <= 0) {
+      return true;
+    }
+    const float dx = (boxes_.xmin[i] + boxes_.xmax[i] - keyframe_boxes_.xmin[j] -
+                      keyframe_boxes_.xmax[j]) / 2;
+    const float dy = (boxes_.ymin[i] + boxes_.ymax[i] - keyframe_boxes_.ymin[j] -
+                      keyframe_boxes_.ymax[j]) / 2;
+    const float width_change =
+        std::abs(boxes_.xmax[i] - boxes_.xmin[i] - width);
+    const float motion = (std::hypot(dx, dy) + width_change) / width;
+    if (motion > options_.max_face_motion()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
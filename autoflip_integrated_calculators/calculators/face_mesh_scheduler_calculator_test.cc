@@ -0,0 +1,155 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputDetection[] = "DETECTIONS";
+constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+constexpr char kOutputKeyframe[] = "KEYFRAME";
+
+const char kConfig[] = R"(
+    calculator: "FaceMeshSchedulerCalculator"
+    input_stream: "VIDEO:input_video"
+    input_stream: "DETECTIONS:face_detections"
+    input_stream: "SHOT_BOUNDARIES:shot_change"
+    output_stream: "KEYFRAME:is_keyframe"
+    options: {
+      [mediapipe.autoflip.FaceMeshSchedulerCalculatorOptions.ext]: {
+        max_keyframe_interval: 4
+        max_face_motion: 0.1
+      }
+    })";
+
+Detection CreateFace(const float xmin, const float ymin, const float width,
+                     const float height) {
+  Detection face;
+  LocationData* location_data = face.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(xmin);
+  bbox->set_ymin(ymin);
+  bbox->set_width(width);
+  bbox->set_height(height);
+  return face;
+}
+
+// Adds a frame with the faces. No detection packet is added when there is
+// no face, as the face detector does.
+void AddFrame(int64 time, const std::vector<Detection>& faces,
+              bool is_shot_boundary, CalculatorRunner* runner) {
+  runner->MutableInputs()->Tag(kInputVideo).packets.push_back(
+      Adopt(new int(0)).At(Timestamp(time)));
+  if (!faces.empty()) {
+    runner->MutableInputs()->Tag(kInputDetection).packets.push_back(
+        Adopt(new std::vector<Detection>(faces)).At(Timestamp(time)));
+  }
+  runner->MutableInputs()->Tag(kInputShotBoundaries).packets.push_back(
+      Adopt(new bool(is_shot_boundary)).At(Timestamp(time)));
+}
+
+std::vector<bool> GetKeyframes(const CalculatorRunner& runner) {
+  std::vector<bool> keyframes;
+  for (const auto& packet : runner.Outputs().Tag(kOutputKeyframe).packets) {
+    keyframes.push_back(packet.Get<bool>());
+  }
+  return keyframes;
+}
+
+TEST(FaceMeshSchedulerCalculatorTest, StaticFaces) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  for (int i = 0; i < 10; ++i) {
+    AddFrame(i * 1000, {CreateFace(0.1, 0.1, 0.2, 0.2),
+                        CreateFace(0.6, 0.1, 0.2, 0.2)},
+             false, &runner);
+  }
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(GetKeyframes(runner),
+              testing::ElementsAre(true, false, false, false, true, false,
+                                   false, false, true, false));
+}
+
+TEST(FaceMeshSchedulerCalculatorTest, MovingFace) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  // The face moves by 0.075 face width per frame.
+  for (int i = 0; i < 6; ++i) {
+    AddFrame(i * 1000, {CreateFace(0.1 + 0.015 * i, 0.1, 0.2, 0.2)}, false,
+             &runner);
+  }
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(GetKeyframes(runner),
+              testing::ElementsAre(true, false, true, false, true, false));
+}
+
+TEST(FaceMeshSchedulerCalculatorTest, FacesAndShotsChange) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  const Detection face_1 = CreateFace(0.1, 0.1, 0.2, 0.2);
+  const Detection face_2 = CreateFace(0.6, 0.1, 0.2, 0.2);
+  AddFrame(0, {face_1}, false, &runner);
+  AddFrame(1000, {face_1}, false, &runner);
+  // A face appears.
+  AddFrame(2000, {face_1, face_2}, false, &runner);
+  AddFrame(3000, {face_1, face_2}, false, &runner);
+  // A shot boundary.
+  AddFrame(4000, {face_1, face_2}, true, &runner);
+  // The faces disappear, then another face replaces the first one.
+  AddFrame(5000, {}, false, &runner);
+  AddFrame(6000, {}, false, &runner);
+  AddFrame(7000, {face_2}, false, &runner);
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(GetKeyframes(runner),
+              testing::ElementsAre(true, false, true, false, true, true, false,
+                                   true));
+}
+
+// The VIDEO stream is gated by the voice activity while SHOT_BOUNDARIES is
+// not: a boundary on a gated frame makes the next VIDEO frame a keyframe.
+TEST(FaceMeshSchedulerCalculatorTest, ShotBoundaryOnGatedFrame) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  const Detection face = CreateFace(0.1, 0.1, 0.2, 0.2);
+  AddFrame(0, {face}, false, &runner);
+  AddFrame(1000, {face}, false, &runner);
+  // Gated frames, the second one on a shot boundary.
+  for (const int64 time : {2000, 3000}) {
+    runner.MutableInputs()->Tag(kInputDetection).packets.push_back(
+        Adopt(new std::vector<Detection>({face})).At(Timestamp(time)));
+    runner.MutableInputs()->Tag(kInputShotBoundaries).packets.push_back(
+        Adopt(new bool(time == 3000)).At(Timestamp(time)));
+  }
+  AddFrame(4000, {face}, false, &runner);
+  AddFrame(5000, {face}, false, &runner);
+  AddFrame(6000, {face}, false, &runner);
+  MP_ASSERT_OK(runner.Run());
+  EXPECT_THAT(GetKeyframes(runner),
+              testing::ElementsAre(true, false, true, false, false));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
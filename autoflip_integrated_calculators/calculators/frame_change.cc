@@ -0,0 +1,267 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_change.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mediapipe {
+namespace autoflip {
+
+namespace {
+
+constexpr int kSimdWidth = 16;
+constexpr int kBinsPerChannel = kFrameChangeHistogramBins / 3;
+constexpr int kBinShift = 4;
+
+// Number of set bytes of a 0x00 / 0xFF mask of kSimdWidth bytes.
+int CountMask(const uint8* mask) {
+#if defined(__SSE2__)
+  return std::bitset<kSimdWidth>(_mm_movemask_epi8(_mm_loadu_si128(
+                                     reinterpret_cast<const __m128i*>(mask))))
+      .count();
+#else
+  int count = 0;
+  for (int i = 0; i < kSimdWidth; ++i) {
+    count += mask[i] != 0;
+  }
+  return count;
+#endif
+}
+
+// Number of set bytes of mask_1 which are not set in mask_2.
+int CountMaskAndNot(const uint8* mask_1, const uint8* mask_2) {
+#if defined(__SSE2__)
+  const __m128i masked = _mm_andnot_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask_2)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask_1)));
+  return std::bitset<kSimdWidth>(_mm_movemask_epi8(masked)).count();
+#else
+  int count = 0;
+  for (int i = 0; i < kSimdWidth; ++i) {
+    count += mask_1[i] != 0 && mask_2[i] == 0;
+  }
+  return count;
+#endif
+}
+
+}  // namespace
+
+FrameChangeScorer::FrameChangeScorer(int edge_threshold, int long_span_frames)
+    : edge_threshold_(std::min(std::max(edge_threshold, 0), 255)),
+      long_span_frames_(std::max(long_span_frames, 1)) {}
+
+void FrameChangeScorer::Resize(int width, int height) {
+  width_ = width;
+  height_ = height;
+  padded_width_ = (width + kSimdWidth - 1) / kSimdWidth * kSimdWidth;
+  stride_ = padded_width_ + 2 * kPadding;
+  const int size = (height + 2) * stride_;
+  luma_.assign(size, 0);
+  horizontal_max_.assign(size, 0);
+  for (int i = 0; i < 2; ++i) {
+    edges_[i].assign(size, 0);
+    dilated_[i].assign(size, 0);
+  }
+  histograms_.assign(long_span_frames_ * kFrameChangeHistogramBins, 0);
+}
+
+void FrameChangeScorer::ComputeLumaAndHistogram(const ImageFrame& frame,
+                                                int32* histogram) {
+  std::fill(histogram, histogram + kFrameChangeHistogramBins, 0);
+  for (int y = 0; y < height_; ++y) {
+    const uint8* pixel = frame.PixelData() + y * frame.WidthStep();
+    uint8* luma = Row(&luma_, y);
+    for (int x = 0; x < width_; ++x, pixel += 3) {
+      ++histogram[pixel[0] >> kBinShift];
+      ++histogram[kBinsPerChannel + (pixel[1] >> kBinShift)];
+      ++histogram[2 * kBinsPerChannel + (pixel[2] >> kBinShift)];
+      luma[x] = (pixel[0] + 2 * pixel[1] + pixel[2] + 2) >> 2;
+    }
+  }
+}
+
+void FrameChangeScorer::ComputeEdges() {
+  std::vector<uint8>* edges = &edges_[current_];
+  // An edge where |dx| + |dy| of the luma, saturated, is above the threshold.
+  for (int y = 0; y < height_; ++y) {
+    const uint8* up = Row(luma_, y - 1);
+    const uint8* row = Row(luma_, y);
+    const uint8* down = Row(luma_, y + 1);
+    uint8* edge = Row(edges, y);
+    int x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i threshold = _mm_set1_epi8(static_cast<char>(edge_threshold_));
+    for (; x < padded_width_; x += kSimdWidth) {
+      const __m128i left =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1));
+      const __m128i right =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+      const __m128i top =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x));
+      const __m128i bottom =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(down + x));
+      const __m128i dx = _mm_or_si128(_mm_subs_epu8(left, right),
+                                      _mm_subs_epu8(right, left));
+      const __m128i dy = _mm_or_si128(_mm_subs_epu8(top, bottom),
+                                      _mm_subs_epu8(bottom, top));
+      const __m128i above = _mm_subs_epu8(_mm_adds_epu8(dx, dy), threshold);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(edge + x),
+                       _mm_xor_si128(_mm_cmpeq_epi8(above, zero), ones));
+    }
+#endif
+    for (; x < padded_width_; ++x) {
+      const int gradient = std::abs(row[x + 1] - row[x - 1]) +
+                           std::abs(down[x] - up[x]);
+      edge[x] = std::min(gradient, 255) > edge_threshold_ ? 0xFF : 0;
+    }
+    // The gradient is not defined on the border of the frame, whose
+    // neighbours are the padding.
+    edge[0] = 0;
+    std::memset(edge + width_ - 1, 0, padded_width_ - width_ + 1);
+  }
+  std::memset(Row(edges, 0), 0, padded_width_);
+  std::memset(Row(edges, height_ - 1), 0, padded_width_);
+
+  // Dilates the edges by one pixel, horizontally then vertically.
+  for (int y = 0; y < height_; ++y) {
+    const uint8* edge = Row(*edges, y);
+    uint8* horizontal_max = Row(&horizontal_max_, y);
+    int x = 0;
+#if defined(__SSE2__)
+    for (; x < padded_width_; x += kSimdWidth) {
+      const __m128i left =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(edge + x - 1));
+      const __m128i center =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(edge + x));
+      const __m128i right =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(edge + x + 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(horizontal_max + x),
+                       _mm_max_epu8(_mm_max_epu8(left, center), right));
+    }
+#endif
+    for (; x < padded_width_; ++x) {
+      horizontal_max[x] = std::max({edge[x - 1], edge[x], edge[x + 1]});
+    }
+  }
+  std::vector<uint8>* dilated = &dilated_[current_];
+  for (int y = 0; y < height_; ++y) {
+    const uint8* up = Row(horizontal_max_, y - 1);
+    const uint8* row = Row(horizontal_max_, y);
+    const uint8* down = Row(horizontal_max_, y + 1);
+    uint8* dilation = Row(dilated, y);
+    int x = 0;
+#if defined(__SSE2__)
+    for (; x < padded_width_; x += kSimdWidth) {
+      const __m128i top =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(up + x));
+      const __m128i center =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+      const __m128i bottom =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(down + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dilation + x),
+                       _mm_max_epu8(_mm_max_epu8(top, center), bottom));
+    }
+#endif
+    for (; x < padded_width_; ++x) {
+      dilation[x] = std::max({up[x], row[x], down[x]});
+    }
+  }
+}
+
+float FrameChangeScorer::ComputeEdgeChangeRatio() const {
+  const int previous = 1 - current_;
+  int num_edges = 0;
+  int num_previous_edges = 0;
+  int num_entering = 0;
+  int num_exiting = 0;
+  for (int y = 0; y < height_; ++y) {
+    const uint8* edge = Row(edges_[current_], y);
+    const uint8* dilated = Row(dilated_[current_], y);
+    const uint8* previous_edge = Row(edges_[previous], y);
+    const uint8* previous_dilated = Row(dilated_[previous], y);
+    for (int x = 0; x < padded_width_; x += kSimdWidth) {
+      num_edges += CountMask(edge + x);
+      num_previous_edges += CountMask(previous_edge + x);
+      num_entering += CountMaskAndNot(edge + x, previous_dilated + x);
+      num_exiting += CountMaskAndNot(previous_edge + x, dilated + x);
+    }
+  }
+  const float entering =
+      num_edges > 0 ? static_cast<float>(num_entering) / num_edges : 0.0f;
+  const float exiting = num_previous_edges > 0
+                            ? static_cast<float>(num_exiting) /
+                                  num_previous_edges
+                            : 0.0f;
+  return std::max(entering, exiting);
+}
+
+float FrameChangeScorer::Score(const ImageFrame& frame) {
+  if (num_frames_ == 0) {
+    Resize(frame.Width(), frame.Height());
+  }
+  const int slot = num_frames_ % long_span_frames_;
+  int32 histogram[kFrameChangeHistogramBins];
+  ComputeLumaAndHistogram(frame, histogram);
+  current_ = 1 - current_;
+  ComputeEdges();
+
+  const int num_pixels = width_ * height_;
+  if (num_frames_ == 0) {
+    histogram_distance_ = 0.0f;
+    long_span_histogram_distance_ = 0.0f;
+    edge_change_ratio_ = 0.0f;
+  } else {
+    const int previous_slot =
+        (num_frames_ - 1) % long_span_frames_;
+    histogram_distance_ = HistogramDistance(
+        histogram, &histograms_[previous_slot * kFrameChangeHistogramBins],
+        num_pixels);
+    // The slot holds the frame long_span_frames before, or the first frame
+    // at the beginning of the stream.
+    const int long_span_slot =
+        num_frames_ >= long_span_frames_ ? slot : 0;
+    long_span_histogram_distance_ = HistogramDistance(
+        histogram, &histograms_[long_span_slot * kFrameChangeHistogramBins],
+        num_pixels);
+    edge_change_ratio_ = ComputeEdgeChangeRatio();
+  }
+  std::copy(histogram, histogram + kFrameChangeHistogramBins,
+            &histograms_[slot * kFrameChangeHistogramBins]);
+  ++num_frames_;
+  return std::max({histogram_distance_, long_span_histogram_distance_,
+                   edge_change_ratio_});
+}
+
+float HistogramDistance(const int32* histogram_1, const int32* histogram_2,
+                        int num_pixels) {
+  int32 distance = 0;
+  for (int i = 0; i < kFrameChangeHistogramBins; ++i) {
+    distance += std::abs(histogram_1[i] - histogram_2[i]);
+  }
+  // Each channel has num_pixels pixels, moved at most once.
+  return num_pixels > 0 ? distance / (6.0f * num_pixels) : 0.0f;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,118 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FRAME_CHANGE_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FRAME_CHANGE_H_
+
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Number of bins of the colour histograms, 16 per channel.
+constexpr int kFrameChangeHistogramBins = 48;
+
+// Scores how much each frame of a stream changed from the previous ones, as
+// a cheap hint of shot boundaries on small frames, such as the 48x27 input of
+// TransNetV2. The score is the largest of:
+// - the colour histogram distance to the previous frame, for cuts,
+// - the colour histogram distance to the frame long_span_frames before, for
+//   gradual transitions such as dissolves, whose consecutive frames differ
+//   little,
+// - the edge change ratio to the previous frame, the fraction of the edges
+//   which appear or disappear, for cuts between shots of similar colours.
+// Each of them is in [0, 1], 0 for identical frames.
+//
+// The edges are where the gradient of the luma is above edge_threshold, and
+// an edge matches the edges of the other frame within one pixel. The edge
+// maps are computed with SSE2 when available and a scalar loop otherwise.
+//
+// Example:
+//   FrameChangeScorer scorer(/*edge_threshold=*/48, /*long_span_frames=*/8);
+//   for (const ImageFrame& frame : frames) {
+//     const float score = scorer.Score(frame);
+//   }
+class FrameChangeScorer {
+ public:
+  FrameChangeScorer(int edge_threshold, int long_span_frames);
+
+  // Returns the score of an SRGB frame. The first frame scores 0, and the
+  // frames have to keep its size.
+  float Score(const ImageFrame& frame);
+
+  // The components of the last score.
+  float histogram_distance() const { return histogram_distance_; }
+  float long_span_histogram_distance() const {
+    return long_span_histogram_distance_;
+  }
+  float edge_change_ratio() const { return edge_change_ratio_; }
+
+ private:
+  // Prepares the buffers for the size of the first frame.
+  void Resize(int width, int height);
+  // Computes the luma and the histogram of the frame.
+  void ComputeLumaAndHistogram(const ImageFrame& frame, int32* histogram);
+  // Computes the edge map of the luma into edges_[current_], and its
+  // dilation into dilated_[current_].
+  void ComputeEdges();
+  // Computes the edge change ratio between the previous and the current
+  // edge maps.
+  float ComputeEdgeChangeRatio() const;
+  uint8* Row(std::vector<uint8>* buffer, int y) {
+    return buffer->data() + (y + 1) * stride_ + kPadding;
+  }
+  const uint8* Row(const std::vector<uint8>& buffer, int y) const {
+    return buffer.data() + (y + 1) * stride_ + kPadding;
+  }
+
+  // Columns of zeros on each side of the rows of the buffers, for the
+  // neighbours of the SIMD loads.
+  static constexpr int kPadding = 16;
+
+  int edge_threshold_;
+  int long_span_frames_;
+  int width_ = 0;
+  int height_ = 0;
+  // The width rounded up to the SIMD width.
+  int padded_width_ = 0;
+  int stride_ = 0;
+  int64 num_frames_ = 0;
+  // The buffers have a row of zeros above and below the frame rows.
+  std::vector<uint8> luma_;
+  std::vector<uint8> horizontal_max_;
+  // The edge maps and their dilations, 0xFF on the edges, of the previous
+  // and the current frames.
+  std::vector<uint8> edges_[2];
+  std::vector<uint8> dilated_[2];
+  int current_ = 0;
+  // The histograms of the last long_span_frames frames, by frame index
+  // modulo long_span_frames.
+  std::vector<int32> histograms_;
+  float histogram_distance_ = 0.0f;
+  float long_span_histogram_distance_ = 0.0f;
+  float edge_change_ratio_ = 0.0f;
+};
+
+// Returns the distance between two colour histograms of num_pixels pixels,
+// half their L1 distance over the channels, in [0, 1].
+float HistogramDistance(const int32* histogram_1, const int32* histogram_2,
+                        int num_pixels);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FRAME_CHANGE_H_
@@ -0,0 +1,59 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the frame change scores of FrameChangeCalculator by frame size,
+// from the 48x27 input of TransNetV2.
+//
+// bazel run -c opt \
+//   mediapipe/examples/desktop/autoflip/calculators:frame_change_benchmark
+
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_change.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_shots.h"
+#include "mediapipe/framework/formats/image_frame.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+std::vector<ImageFrame> CreateFrames(int scale) {
+  SyntheticShotOptions options;
+  options.num_shots = 4;
+  options.frame_width = 48 * scale;
+  options.frame_height = 27 * scale;
+  std::vector<ImageFrame> frames;
+  std::vector<ShotTransition> transitions;
+  GenerateSyntheticShots(options, &frames, &transitions);
+  return frames;
+}
+
+void BM_FrameChange(benchmark::State& state) {
+  const auto frames = CreateFrames(state.range(0));
+  FrameChangeScorer scorer(/*edge_threshold=*/48, /*long_span_frames=*/8);
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(scorer.Score(frames[i]));
+    i = (i + 1) % frames.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameChange)->RangeMultiplier(2)->Range(1, 8);
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+BENCHMARK_MAIN();
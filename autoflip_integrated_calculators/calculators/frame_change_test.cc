@@ -0,0 +1,112 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_change.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_shots.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kEdgeThreshold = 48;
+const int kLongSpanFrames = 8;
+// The default min_score of ShotBoundaryGateCalculator.
+const float kMinScore = 0.2f;
+
+// A grey frame with a white vertical bar of the columns [begin, end). The
+// width is not a multiple of the SIMD width.
+ImageFrame MakeBarFrame(int begin, int end) {
+  ImageFrame frame(ImageFormat::SRGB, 37, 21);
+  for (int y = 0; y < frame.Height(); ++y) {
+    uint8* row = frame.MutablePixelData() + y * frame.WidthStep();
+    for (int x = 0; x < frame.Width(); ++x) {
+      std::fill(row + 3 * x, row + 3 * x + 3,
+                x >= begin && x < end ? 255 : 64);
+    }
+  }
+  return frame;
+}
+
+TEST(FrameChangeTest, IdenticalFramesScoreZero) {
+  FrameChangeScorer scorer(kEdgeThreshold, kLongSpanFrames);
+  const ImageFrame frame = MakeBarFrame(10, 20);
+  for (int i = 0; i < 2 * kLongSpanFrames; ++i) {
+    EXPECT_EQ(0.0f, scorer.Score(frame));
+  }
+}
+
+TEST(FrameChangeTest, EdgeChangeRatio) {
+  FrameChangeScorer scorer(kEdgeThreshold, kLongSpanFrames);
+  scorer.Score(MakeBarFrame(5, 15));
+  // The edges moved by one pixel still match.
+  EXPECT_EQ(0.0f, scorer.Score(MakeBarFrame(6, 16)));
+  // The same colours elsewhere: the histograms are equal, but all the edges
+  // moved.
+  EXPECT_FLOAT_EQ(1.0f, scorer.Score(MakeBarFrame(25, 35)));
+  EXPECT_EQ(0.0f, scorer.histogram_distance());
+  EXPECT_FLOAT_EQ(1.0f, scorer.edge_change_ratio());
+}
+
+TEST(FrameChangeTest, HistogramDistance) {
+  FrameChangeScorer scorer(kEdgeThreshold, kLongSpanFrames);
+  scorer.Score(MakeBarFrame(0, 0));
+  // A third of the pixels changed of bin in every channel.
+  scorer.Score(MakeBarFrame(0, 12));
+  EXPECT_NEAR(12.0f / 37, scorer.histogram_distance(), 1e-6);
+  EXPECT_NEAR(12.0f / 37, scorer.long_span_histogram_distance(), 1e-6);
+}
+
+TEST(FrameChangeTest, ScoresTheSyntheticTransitions) {
+  SyntheticShotOptions options;
+  options.num_shots = 30;
+  options.dissolve_fraction = 0.5f;
+  std::vector<ImageFrame> frames;
+  std::vector<ShotTransition> transitions;
+  GenerateSyntheticShots(options, &frames, &transitions);
+
+  FrameChangeScorer scorer(kEdgeThreshold, kLongSpanFrames);
+  std::vector<float> scores;
+  for (const ImageFrame& frame : frames) {
+    scores.push_back(scorer.Score(frame));
+  }
+  int shot_begin = 0;
+  int num_shot_frames = 0;
+  int num_high_shot_frames = 0;
+  for (const ShotTransition& transition : transitions) {
+    // Every transition has a high score.
+    EXPECT_GE(*std::max_element(scores.begin() + transition.begin,
+                                scores.begin() + transition.end + 1),
+              kMinScore);
+    // The frames of the shot, once the long span left the previous
+    // transition, mostly have low scores. The stripes may move far over the
+    // long span.
+    for (int i = shot_begin + kLongSpanFrames; i < transition.begin; ++i) {
+      ++num_shot_frames;
+      num_high_shot_frames += scores[i] >= kMinScore;
+    }
+    shot_begin = transition.end + 1;
+  }
+  EXPECT_LT(num_high_shot_frames, 0.02 * num_shot_frames);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,92 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_render_queue.h"
+
+#include <algorithm>
+
+namespace mediapipe {
+namespace autoflip {
+
+FrameRenderQueue::FrameRenderQueue(int capacity)
+    : capacity_(std::max(capacity, 1)), worker_([this] { Run(); }) {}
+
+FrameRenderQueue::~FrameRenderQueue() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stop_ = true;
+    num_dropped_ += pending_.size();
+    pending_.clear();
+  }
+  worker_.join();
+}
+
+void FrameRenderQueue::Push(int64 timestamp, RenderCallback render) {
+  absl::MutexLock lock(&mutex_);
+  const int queued = pending_.size() + (rendering_ ? 1 : 0);
+  if (queued >= capacity_) {
+    ++num_dropped_;
+    if (pending_.empty()) return;
+    pending_.pop_front();
+  }
+  pending_.push_back({timestamp, std::move(render)});
+}
+
+void FrameRenderQueue::PopRendered(std::vector<RenderedFrame>* frames) {
+  absl::MutexLock lock(&mutex_);
+  for (auto& frame : rendered_) {
+    frames->push_back(std::move(frame));
+  }
+  rendered_.clear();
+}
+
+void FrameRenderQueue::Flush() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &FrameRenderQueue::IsIdle));
+}
+
+int64 FrameRenderQueue::num_dropped() const {
+  absl::MutexLock lock(&mutex_);
+  return num_dropped_;
+}
+
+bool FrameRenderQueue::IsIdle() const {
+  return pending_.empty() && !rendering_;
+}
+
+bool FrameRenderQueue::HasWork() const { return stop_ || !pending_.empty(); }
+
+void FrameRenderQueue::Run() {
+  while (true) {
+    PendingFrame frame;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &FrameRenderQueue::HasWork));
+      if (stop_) return;
+      frame = std::move(pending_.front());
+      pending_.pop_front();
+      rendering_ = true;
+    }
+    // Rendering runs without the lock, so that Push() never waits for it.
+    std::unique_ptr<ImageFrame> rendered = frame.render();
+    absl::MutexLock lock(&mutex_);
+    rendering_ = false;
+    if (rendered) {
+      rendered_.emplace_back(frame.timestamp, std::move(rendered));
+    }
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,99 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FRAME_RENDER_QUEUE_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FRAME_RENDER_QUEUE_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Renders debug frames on a dedicated thread, so that drawing does not
+// delay the outputs of the calculator which owns the queue.
+//
+// The frames are rendered in the order they are pushed. A calculator pushes
+// render callbacks in Process(), and outputs the rendered frames in a later
+// Process() or in Close(), since only the calculator thread may add packets.
+// At most `capacity` frames are pending or being rendered. The rendered
+// frames which are not popped yet do not count, so a burst of frames is not
+// dropped as long as the rendering keeps up. When the queue is full, the
+// oldest pending frame is dropped, or the new frame if the only frame in the
+// queue is being rendered.
+//
+// Example:
+//   FrameRenderQueue queue(/* capacity = */ 16);
+//   queue.Push(timestamp, [frame] { return Render(frame); });
+//   ...
+//   queue.PopRendered(&frames);
+class FrameRenderQueue {
+ public:
+  // Returns the rendered frame, or nullptr if the frame is skipped.
+  using RenderCallback = std::function<std::unique_ptr<ImageFrame>()>;
+  using RenderedFrame = std::pair<int64, std::unique_ptr<ImageFrame>>;
+
+  explicit FrameRenderQueue(int capacity);
+  // Drops the pending frames and joins the worker.
+  ~FrameRenderQueue();
+  FrameRenderQueue(const FrameRenderQueue&) = delete;
+  FrameRenderQueue& operator=(const FrameRenderQueue&) = delete;
+
+  // Enqueues a frame to render.
+  void Push(int64 timestamp, RenderCallback render);
+
+  // Moves the rendered frames, in push order, to the end of frames.
+  void PopRendered(std::vector<RenderedFrame>* frames);
+
+  // Blocks until every pushed frame is rendered or dropped.
+  void Flush();
+
+  // Number of frames dropped so far.
+  int64 num_dropped() const;
+
+ private:
+  struct PendingFrame {
+    int64 timestamp;
+    RenderCallback render;
+  };
+
+  // Conditions of the worker and of Flush().
+  bool IsIdle() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Renders the pending frames until the queue is destroyed.
+  void Run();
+
+  const int capacity_;
+  mutable absl::Mutex mutex_;
+  std::deque<PendingFrame> pending_ ABSL_GUARDED_BY(mutex_);
+  std::vector<RenderedFrame> rendered_ ABSL_GUARDED_BY(mutex_);
+  // True while the worker renders a frame taken from pending_.
+  bool rendering_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stop_ ABSL_GUARDED_BY(mutex_) = false;
+  int64 num_dropped_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::thread worker_;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_FRAME_RENDER_QUEUE_H_
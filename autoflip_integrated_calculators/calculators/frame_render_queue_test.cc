@@ -0,0 +1,123 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_render_queue.h"
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/notification.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+std::unique_ptr<ImageFrame> CreateFrame() {
+  return absl::make_unique<ImageFrame>(ImageFormat::SRGB, 4, 2);
+}
+
+std::vector<int64> Timestamps(
+    const std::vector<FrameRenderQueue::RenderedFrame>& frames) {
+  std::vector<int64> timestamps;
+  for (const auto& frame : frames) {
+    timestamps.push_back(frame.first);
+  }
+  return timestamps;
+}
+
+TEST(FrameRenderQueueTest, RendersInPushOrder) {
+  FrameRenderQueue queue(/* capacity = */ 8);
+  for (int64 timestamp = 0; timestamp < 5; ++timestamp) {
+    queue.Push(timestamp, CreateFrame);
+  }
+  queue.Flush();
+  std::vector<FrameRenderQueue::RenderedFrame> frames;
+  queue.PopRendered(&frames);
+  EXPECT_THAT(Timestamps(frames), testing::ElementsAre(0, 1, 2, 3, 4));
+  EXPECT_EQ(0, queue.num_dropped());
+  for (const auto& frame : frames) {
+    EXPECT_EQ(4, frame.second->Width());
+  }
+}
+
+TEST(FrameRenderQueueTest, SkipsNullFrames) {
+  FrameRenderQueue queue(/* capacity = */ 8);
+  queue.Push(0, CreateFrame);
+  queue.Push(1, [] { return std::unique_ptr<ImageFrame>(); });
+  queue.Push(2, CreateFrame);
+  queue.Flush();
+  std::vector<FrameRenderQueue::RenderedFrame> frames;
+  queue.PopRendered(&frames);
+  EXPECT_THAT(Timestamps(frames), testing::ElementsAre(0, 2));
+}
+
+TEST(FrameRenderQueueTest, DropsOldestPendingFrameWhenFull) {
+  FrameRenderQueue queue(/* capacity = */ 3);
+  // Holds the worker on the first frame.
+  absl::Notification started, release;
+  queue.Push(0, [&] {
+    started.Notify();
+    release.WaitForNotification();
+    return CreateFrame();
+  });
+  started.WaitForNotification();
+  for (int64 timestamp = 1; timestamp < 5; ++timestamp) {
+    queue.Push(timestamp, CreateFrame);
+  }
+  release.Notify();
+  queue.Flush();
+  std::vector<FrameRenderQueue::RenderedFrame> frames;
+  queue.PopRendered(&frames);
+  EXPECT_THAT(Timestamps(frames), testing::ElementsAre(0, 3, 4));
+  EXPECT_EQ(2, queue.num_dropped());
+}
+
+TEST(FrameRenderQueueTest, DropsNewFrameWhileRenderingWhenFull) {
+  FrameRenderQueue queue(/* capacity = */ 1);
+  absl::Notification started, release;
+  queue.Push(0, [&] {
+    started.Notify();
+    release.WaitForNotification();
+    return CreateFrame();
+  });
+  started.WaitForNotification();
+  queue.Push(1, CreateFrame);
+  release.Notify();
+  queue.Flush();
+  std::vector<FrameRenderQueue::RenderedFrame> frames;
+  queue.PopRendered(&frames);
+  EXPECT_THAT(Timestamps(frames), testing::ElementsAre(0));
+  EXPECT_EQ(1, queue.num_dropped());
+}
+
+// A burst longer than the capacity, e.g. the frames of a scene, is kept as
+// long as the rendering keeps up, even if the frames are only popped at the
+// end of the burst.
+TEST(FrameRenderQueueTest, KeepsBurstWhenRenderingKeepsUp) {
+  FrameRenderQueue queue(/* capacity = */ 4);
+  for (int64 timestamp = 0; timestamp < 20; ++timestamp) {
+    queue.Push(timestamp, CreateFrame);
+    queue.Flush();
+  }
+  std::vector<FrameRenderQueue::RenderedFrame> frames;
+  queue.PopRendered(&frames);
+  EXPECT_EQ(20, frames.size());
+  EXPECT_EQ(19, frames.back().first);
+  EXPECT_EQ(0, queue.num_dropped());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
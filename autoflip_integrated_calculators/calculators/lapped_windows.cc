@@ -0,0 +1,63 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lapped_windows.h"
+
+#include <algorithm>
+
+namespace mediapipe {
+
+LappedWindows::LappedWindows(int window_size, int overlap, int num_padding)
+    : window_size_(window_size),
+      step_(window_size - overlap),
+      num_padding_(num_padding),
+      next_window_begin_(-num_padding) {}
+
+bool LappedWindows::IsNextWindowComplete(int num_frames) const {
+  return next_window_begin_ + window_size_ <= num_frames;
+}
+
+bool LappedWindows::IsNextWindowNeeded(int num_frames) const {
+  return next_window_begin_ + num_padding_ < num_frames;
+}
+
+LappedWindow LappedWindows::PopWindow(int num_frames) {
+  LappedWindow window;
+  window.begin = next_window_begin_;
+  window.end = next_window_begin_ + window_size_;
+  window.real_begin = std::max(window.begin, 0);
+  window.real_end = std::min(window.end, num_frames);
+  next_window_begin_ += step_;
+  return window;
+}
+
+int LappedWindows::first_needed_frame() const {
+  return std::max(next_window_begin_, 0);
+}
+
+void AppendWindowTimestamps(const LappedWindow& window,
+                            Timestamp first_timestamp,
+                            const std::vector<Timestamp>& recent_timestamps,
+                            std::vector<Timestamp>* timestamps) {
+  const int offset = timestamps->size();
+  timestamps->resize(offset + window.real_begin - window.begin,
+                     first_timestamp);
+  timestamps->insert(
+      timestamps->end(),
+      recent_timestamps.end() - (window.real_end - window.real_begin),
+      recent_timestamps.end());
+  timestamps->resize(offset + window.end - window.begin, Timestamp::Done());
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,75 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LAPPED_WINDOWS_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LAPPED_WINDOWS_H_
+
+#include <vector>
+
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+
+// A window of consecutive frames. The frames before the first frame of the
+// stream and after the last one are padding, copies of the first or the
+// last frame.
+struct LappedWindow {
+  // Index of the first frame of the window, negative when the window starts
+  // with padding.
+  int begin;
+  int end;
+  // The real frames [real_begin, real_end) of the window.
+  int real_begin;
+  int real_end;
+};
+
+// Schedules the overlapping windows of frames fed to TransNetV2, independently
+// of how the frames are stored. The first window starts num_padding frames
+// before the first frame, each window starts window_size - overlap frames
+// after the previous one, and the frames of a window are decoded after its
+// first num_padding frames.
+class LappedWindows {
+ public:
+  LappedWindows(int window_size, int overlap, int num_padding);
+
+  // Returns true when the next window is complete after num_frames frames.
+  bool IsNextWindowComplete(int num_frames) const;
+  // At the end of a stream of num_frames frames, returns true while the
+  // decoded part of the next window starts with a real frame.
+  bool IsNextWindowNeeded(int num_frames) const;
+  // Returns the next window after num_frames frames, and moves to the
+  // following one. The window ends with the last frame or after it.
+  LappedWindow PopWindow(int num_frames);
+  // Index of the first frame the next windows need.
+  int first_needed_frame() const;
+
+ private:
+  int window_size_;
+  int step_;
+  int num_padding_;
+  int next_window_begin_;
+};
+
+// Appends the timestamps of the frames of a window to timestamps. The
+// padding before the stream has the timestamp of the first frame, and the
+// padding after it is Timestamp::Done(). The timestamps of the real frames
+// of the window are the last ones of recent_timestamps.
+void AppendWindowTimestamps(const LappedWindow& window,
+                            Timestamp first_timestamp,
+                            const std::vector<Timestamp>& recent_timestamps,
+                            std::vector<Timestamp>* timestamps);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LAPPED_WINDOWS_H_
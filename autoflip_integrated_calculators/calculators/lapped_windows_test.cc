@@ -0,0 +1,69 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lapped_windows.h"
+
+#include <vector>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+TEST(LappedWindowsTest, SchedulesThePaddedWindows) {
+  LappedWindows windows(/*window_size=*/100, /*overlap=*/50,
+                        /*num_padding=*/25);
+  EXPECT_FALSE(windows.IsNextWindowComplete(74));
+  ASSERT_TRUE(windows.IsNextWindowComplete(75));
+  EXPECT_EQ(0, windows.first_needed_frame());
+  const LappedWindow first = windows.PopWindow(75);
+  EXPECT_EQ(-25, first.begin);
+  EXPECT_EQ(75, first.end);
+  EXPECT_EQ(0, first.real_begin);
+  EXPECT_EQ(75, first.real_end);
+  EXPECT_EQ(25, windows.first_needed_frame());
+
+  // The video ends with frame 90: the second window is padded after it, and
+  // the third one is not needed.
+  EXPECT_FALSE(windows.IsNextWindowComplete(90));
+  ASSERT_TRUE(windows.IsNextWindowNeeded(90));
+  const LappedWindow second = windows.PopWindow(90);
+  EXPECT_EQ(25, second.begin);
+  EXPECT_EQ(125, second.end);
+  EXPECT_EQ(25, second.real_begin);
+  EXPECT_EQ(90, second.real_end);
+  EXPECT_FALSE(windows.IsNextWindowNeeded(90));
+}
+
+TEST(LappedWindowsTest, AppendsTheWindowTimestamps) {
+  LappedWindow window;
+  window.begin = -2;
+  window.end = 4;
+  window.real_begin = 0;
+  window.real_end = 3;
+  std::vector<Timestamp> timestamps = {Timestamp(-1)};
+  AppendWindowTimestamps(window, Timestamp(10),
+                         {Timestamp(5), Timestamp(10), Timestamp(20),
+                          Timestamp(30)},
+                         &timestamps);
+  EXPECT_EQ(std::vector<Timestamp>({Timestamp(-1), Timestamp(10),
+                                    Timestamp(10), Timestamp(10),
+                                    Timestamp(20), Timestamp(30),
+                                    Timestamp::Done()}),
+            timestamps);
+}
+
+}  // namespace
+}  // namespace mediapipe
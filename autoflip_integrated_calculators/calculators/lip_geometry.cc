@@ -0,0 +1,233 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace mediapipe {
+namespace autoflip {
+
+const int kLipLandmarkIdx[kNumLipLandmarks] = {
+    78, 308, 82, 13, 312, 87, 14, 317,  // Inner lip contour.
+    61, 291, 37, 0, 267, 84, 17, 314};  // Outer lip contour.
+
+namespace {
+
+// Positions in kLipLandmarkIdx of the landmarks of a contour.
+constexpr int kLeftCorner = 0;
+constexpr int kRightCorner = 1;
+constexpr int kUpper = 2;
+constexpr int kLower = 5;
+constexpr int kNumHeights = 3;
+constexpr int kOuterContour = 8;
+// Faces are padded to the widest SIMD width.
+constexpr int kPadding = 8;
+
+// Scalar ratio of one face, i.e. the reference of the vectorized kernels.
+float LipRatio(const float* packed, int stride, int face, int contour,
+               float x_scale, float y_scale) {
+  auto distance = [&](int landmark_1, int landmark_2) {
+    const float* p1 = packed + (contour + landmark_1) * 3 * stride + face;
+    const float* p2 = packed + (contour + landmark_2) * 3 * stride + face;
+    const float dx = (p1[0] - p2[0]) * x_scale;
+    const float dy = (p1[stride] - p2[stride]) * y_scale;
+    const float dz = p1[2 * stride] - p2[2 * stride];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+  };
+  const float width = distance(kLeftCorner, kRightCorner);
+  float height = 0.0f;
+  for (int i = 0; i < kNumHeights; ++i) {
+    height += distance(kUpper + i, kLower + i);
+  }
+  height /= kNumHeights;
+  return height / width;
+}
+
+#if defined(__AVX2__)
+// Eight faces per iteration.
+__m256 Distance(const float* packed, int stride, int face, int landmark_1,
+                int landmark_2, __m256 x_scale, __m256 y_scale) {
+  const float* p1 = packed + landmark_1 * 3 * stride + face;
+  const float* p2 = packed + landmark_2 * 3 * stride + face;
+  const __m256 dx = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_loadu_ps(p1), _mm256_loadu_ps(p2)), x_scale);
+  const __m256 dy = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(p1 + stride),
+                                                _mm256_loadu_ps(p2 + stride)),
+                                  y_scale);
+  const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(p1 + 2 * stride),
+                                  _mm256_loadu_ps(p2 + 2 * stride));
+  return _mm256_sqrt_ps(
+      _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                    _mm256_mul_ps(dz, dz)));
+}
+
+__m256 LipRatios(const float* packed, int stride, int face, int contour,
+                 __m256 x_scale, __m256 y_scale) {
+  const __m256 width = Distance(packed, stride, face, contour + kLeftCorner,
+                                contour + kRightCorner, x_scale, y_scale);
+  __m256 height = _mm256_setzero_ps();
+  for (int i = 0; i < kNumHeights; ++i) {
+    height = _mm256_add_ps(
+        height, Distance(packed, stride, face, contour + kUpper + i,
+                         contour + kLower + i, x_scale, y_scale));
+  }
+  height = _mm256_div_ps(height, _mm256_set1_ps(kNumHeights));
+  return _mm256_div_ps(height, width);
+}
+#elif defined(__SSE2__)
+// Four faces per iteration.
+__m128 Distance(const float* packed, int stride, int face, int landmark_1,
+                int landmark_2, __m128 x_scale, __m128 y_scale) {
+  const float* p1 = packed + landmark_1 * 3 * stride + face;
+  const float* p2 = packed + landmark_2 * 3 * stride + face;
+  const __m128 dx =
+      _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(p1), _mm_loadu_ps(p2)), x_scale);
+  const __m128 dy = _mm_mul_ps(
+      _mm_sub_ps(_mm_loadu_ps(p1 + stride), _mm_loadu_ps(p2 + stride)),
+      y_scale);
+  const __m128 dz =
+      _mm_sub_ps(_mm_loadu_ps(p1 + 2 * stride), _mm_loadu_ps(p2 + 2 * stride));
+  return _mm_sqrt_ps(_mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+}
+
+__m128 LipRatios(const float* packed, int stride, int face, int contour,
+                 __m128 x_scale, __m128 y_scale) {
+  const __m128 width = Distance(packed, stride, face, contour + kLeftCorner,
+                                contour + kRightCorner, x_scale, y_scale);
+  __m128 height = _mm_setzero_ps();
+  for (int i = 0; i < kNumHeights; ++i) {
+    height = _mm_add_ps(height, Distance(packed, stride, face,
+                                         contour + kUpper + i,
+                                         contour + kLower + i, x_scale,
+                                         y_scale));
+  }
+  height = _mm_div_ps(height, _mm_set1_ps(kNumHeights));
+  return _mm_div_ps(height, width);
+}
+#endif
+
+}  // namespace
+
+void ComputeLipRatios(const float* packed, int stride, int num_faces,
+                      float x_scale, float y_scale, float* inner_ratios,
+                      float* outer_ratios) {
+  int face = 0;
+#if defined(__AVX2__)
+  const __m256 x_scale_v = _mm256_set1_ps(x_scale);
+  const __m256 y_scale_v = _mm256_set1_ps(y_scale);
+  for (; face < num_faces; face += 8) {
+    _mm256_storeu_ps(inner_ratios + face,
+                     LipRatios(packed, stride, face, /* contour = */ 0,
+                               x_scale_v, y_scale_v));
+    _mm256_storeu_ps(outer_ratios + face,
+                     LipRatios(packed, stride, face, kOuterContour,
+                               x_scale_v, y_scale_v));
+  }
+#elif defined(__SSE2__)
+  const __m128 x_scale_v = _mm_set1_ps(x_scale);
+  const __m128 y_scale_v = _mm_set1_ps(y_scale);
+  for (; face < num_faces; face += 4) {
+    _mm_storeu_ps(inner_ratios + face,
+                  LipRatios(packed, stride, face, /* contour = */ 0,
+                            x_scale_v, y_scale_v));
+    _mm_storeu_ps(outer_ratios + face,
+                  LipRatios(packed, stride, face, kOuterContour, x_scale_v,
+                            y_scale_v));
+  }
+#endif
+  for (; face < num_faces; ++face) {
+    inner_ratios[face] = LipRatio(packed, stride, face, /* contour = */ 0,
+                                  x_scale, y_scale);
+    outer_ratios[face] =
+        LipRatio(packed, stride, face, kOuterContour, x_scale, y_scale);
+  }
+}
+
+LipLandmarks ExtractLipLandmarks(const NormalizedLandmarkList& landmark_list) {
+  LipLandmarks lip_landmarks = {};
+  if (landmark_list.landmark_size() < kFaceMeshLandmarks) return lip_landmarks;
+  lip_landmarks.valid = true;
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    const auto& landmark = landmark_list.landmark(kLipLandmarkIdx[i]);
+    lip_landmarks.x[i] = landmark.x();
+    lip_landmarks.y[i] = landmark.y();
+    lip_landmarks.z[i] = landmark.z();
+  }
+  return lip_landmarks;
+}
+
+void LipGeometry::Resize(int num_faces) {
+  num_faces_ = num_faces;
+  stride_ = (num_faces + kPadding - 1) / kPadding * kPadding;
+  // Padded faces are zeros and their ratios are ignored.
+  packed_.assign(kNumLipLandmarks * 3 * stride_, 0.0f);
+  valid_.assign(num_faces, 0);
+  inner_.resize(stride_);
+  outer_.resize(stride_);
+}
+
+void LipGeometry::Gather(
+    const std::vector<NormalizedLandmarkList>& landmark_lists) {
+  Resize(landmark_lists.size());
+  for (int face = 0; face < num_faces_; ++face) {
+    const auto& landmark_list = landmark_lists[face];
+    if (landmark_list.landmark_size() < kFaceMeshLandmarks) continue;
+    valid_[face] = 1;
+    for (int i = 0; i < kNumLipLandmarks; ++i) {
+      const auto& landmark = landmark_list.landmark(kLipLandmarkIdx[i]);
+      Coordinate(i, 0)[face] = landmark.x();
+      Coordinate(i, 1)[face] = landmark.y();
+      Coordinate(i, 2)[face] = landmark.z();
+    }
+  }
+}
+
+void LipGeometry::Gather(const std::vector<LipLandmarks>& lip_landmarks) {
+  Resize(lip_landmarks.size());
+  for (int face = 0; face < num_faces_; ++face) {
+    const auto& lips = lip_landmarks[face];
+    if (!lips.valid) continue;
+    valid_[face] = 1;
+    for (int i = 0; i < kNumLipLandmarks; ++i) {
+      Coordinate(i, 0)[face] = lips.x[i];
+      Coordinate(i, 1)[face] = lips.y[i];
+      Coordinate(i, 2)[face] = lips.z[i];
+    }
+  }
+}
+
+void LipGeometry::ComputeRatios(int frame_width, int frame_height,
+                                std::vector<float>* inner_ratios,
+                                std::vector<float>* outer_ratios) {
+  inner_ratios->clear();
+  outer_ratios->clear();
+  if (num_faces_ == 0) return;
+  ComputeLipRatios(packed_.data(), stride_, num_faces_, frame_width,
+                   frame_height, inner_.data(), outer_.data());
+  for (int face = 0; face < num_faces_; ++face) {
+    inner_ratios->push_back(valid_[face] ? inner_[face] : 0.0f);
+    outer_ratios->push_back(valid_[face] ? outer_[face] : 0.0f);
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,106 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_GEOMETRY_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_GEOMETRY_H_
+
+#include <vector>
+
+#include "mediapipe/framework/formats/landmark.pb.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Number of lip landmarks used per face: for the inner and the outer lip
+// contours, the left and right corners, three upper lip landmarks and
+// three lower lip landmarks.
+constexpr int kNumLipLandmarks = 16;
+
+// Face mesh indices of the lip landmarks, in the order used by LipGeometry:
+// inner left corner, inner right corner, inner upper x3, inner lower x3,
+// then the same for the outer contour.
+extern const int kLipLandmarkIdx[kNumLipLandmarks];
+
+// Number of face mesh landmarks.
+constexpr int kFaceMeshLandmarks = 468;
+
+// The lip landmarks of one face, in the order of kLipLandmarkIdx. This is
+// the packet type LipLandmarksCalculator emits for LipTrackCalculator, and
+// it is about 100x smaller than the NormalizedLandmarkList of the face mesh.
+struct LipLandmarks {
+  float x[kNumLipLandmarks];
+  float y[kNumLipLandmarks];
+  float z[kNumLipLandmarks];
+  // False when the face has fewer than kFaceMeshLandmarks landmarks. The
+  // coordinates are zeros then.
+  bool valid;
+};
+
+// Copies the lip landmarks of a face mesh.
+LipLandmarks ExtractLipLandmarks(const NormalizedLandmarkList& landmark_list);
+
+// Computes the lip opening ratio (mean mouth height over mouth width) of all
+// the faces in a frame, for the inner and the outer lip contours.
+//
+// The lip landmarks of all the faces are gathered once into a packed
+// structure-of-arrays buffer ([landmark][x, y, z][face]), and the ratios of
+// every face and both contours are computed in one pass over the faces,
+// with AVX2 or SSE when available and a scalar loop otherwise.
+//
+// Example:
+//   LipGeometry geometry;
+//   geometry.Gather(landmark_lists);
+//   geometry.ComputeRatios(frame_width, frame_height, &inner, &outer);
+class LipGeometry {
+ public:
+  // Gathers the lip landmarks of the faces. Faces with fewer than
+  // kFaceMeshLandmarks landmarks get a ratio of 0.
+  void Gather(const std::vector<NormalizedLandmarkList>& landmark_lists);
+  // Gathers the lip landmarks of the faces. Invalid faces get a ratio of 0.
+  void Gather(const std::vector<LipLandmarks>& lip_landmarks);
+
+  // Computes the ratios of the gathered faces. x and y are scaled by the
+  // frame dimensions, z is used as is.
+  void ComputeRatios(int frame_width, int frame_height,
+                     std::vector<float>* inner_ratios,
+                     std::vector<float>* outer_ratios);
+
+  int num_faces() const { return num_faces_; }
+
+ private:
+  // Prepares the buffers for num_faces faces, padded to the SIMD width.
+  void Resize(int num_faces);
+  float* Coordinate(int landmark, int axis) {
+    return packed_.data() + (landmark * 3 + axis) * stride_;
+  }
+
+  int num_faces_ = 0;
+  int stride_ = 0;
+  std::vector<float> packed_;
+  std::vector<char> valid_;
+  std::vector<float> inner_;
+  std::vector<float> outer_;
+};
+
+// Computes the inner and outer lip ratios of num_faces faces from a packed
+// [kNumLipLandmarks][3][stride] buffer. stride has to be a multiple of 8
+// and at least num_faces. The outputs have to hold stride values.
+void ComputeLipRatios(const float* packed, int stride, int num_faces,
+                      float x_scale, float y_scale, float* inner_ratios,
+                      float* outer_ratios);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_GEOMETRY_H_
@@ -0,0 +1,111 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks the lip statistics of LipTrackCalculator by number of faces.
+//
+// bazel run -c opt \
+//   mediapipe/examples/desktop/autoflip/calculators:lip_geometry_benchmark
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/formats/landmark.pb.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kFrameWidth = 1920;
+const int kFrameHeight = 1080;
+
+std::vector<NormalizedLandmarkList> CreateFaces(int num_faces) {
+  std::mt19937 generator(num_faces);
+  std::uniform_real_distribution<float> coordinate(0.0, 1.0);
+  std::vector<NormalizedLandmarkList> faces(num_faces);
+  for (auto& face : faces) {
+    for (int i = 0; i < kFaceMeshLandmarks; ++i) {
+      auto* landmark = face.add_landmark();
+      landmark->set_x(coordinate(generator));
+      landmark->set_y(coordinate(generator));
+      landmark->set_z(coordinate(generator) * 0.1f);
+    }
+  }
+  return faces;
+}
+
+void BM_LipGeometry(benchmark::State& state) {
+  const auto faces = CreateFaces(state.range(0));
+  LipGeometry geometry;
+  std::vector<float> inner, outer;
+  for (auto _ : state) {
+    geometry.Gather(faces);
+    geometry.ComputeRatios(kFrameWidth, kFrameHeight, &inner, &outer);
+    benchmark::DoNotOptimize(inner.data());
+    benchmark::DoNotOptimize(outer.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LipGeometry)->DenseRange(1, 4)->RangeMultiplier(2)->Range(8, 32);
+
+float GetDistance(const NormalizedLandmark& mark_1,
+                  const NormalizedLandmark& mark_2) {
+  return std::sqrt(std::pow((mark_1.x() - mark_2.x()) * kFrameWidth, 2) +
+                   std::pow((mark_1.y() - mark_2.y()) * kFrameHeight, 2) +
+                   std::pow(mark_1.z() - mark_2.z(), 2));
+}
+
+// The per contour statistics LipTrackCalculator used before, which walks
+// the landmark lists once per contour.
+void GetStatistics(const std::vector<NormalizedLandmarkList>& landmark_lists,
+                   int contour, std::vector<float>* lip_statistics) {
+  for (const auto& landmark_list : landmark_lists) {
+    auto landmark = [&](int i) {
+      return landmark_list.landmark(kLipLandmarkIdx[contour + i]);
+    };
+    const float mouth_width = GetDistance(landmark(0), landmark(1));
+    float mouth_height = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+      mouth_height += GetDistance(landmark(2 + i), landmark(5 + i));
+    }
+    mouth_height /= 3.0f;
+    lip_statistics->push_back(mouth_height / mouth_width);
+  }
+}
+
+void BM_PerContourStatistics(benchmark::State& state) {
+  const auto faces = CreateFaces(state.range(0));
+  std::vector<float> inner, outer;
+  for (auto _ : state) {
+    inner.clear();
+    outer.clear();
+    GetStatistics(faces, /* contour = */ 0, &inner);
+    GetStatistics(faces, /* contour = */ 8, &outer);
+    benchmark::DoNotOptimize(inner.data());
+    benchmark::DoNotOptimize(outer.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PerContourStatistics)
+    ->DenseRange(1, 4)
+    ->RangeMultiplier(2)
+    ->Range(8, 32);
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+BENCHMARK_MAIN();
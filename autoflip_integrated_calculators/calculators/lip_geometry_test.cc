@@ -0,0 +1,117 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+
+#include <cmath>
+
+#include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kFrameWidth = 640;
+const int kFrameHeight = 480;
+
+NormalizedLandmarkList CreateFace(int seed, int num_landmarks) {
+  NormalizedLandmarkList face;
+  for (int i = 0; i < num_landmarks; ++i) {
+    auto* landmark = face.add_landmark();
+    landmark->set_x(0.5f + 0.1f * std::sin(seed + 0.37f * i));
+    landmark->set_y(0.5f + 0.1f * std::cos(seed * 0.5f + 0.23f * i));
+    landmark->set_z(0.01f * std::sin(seed + 0.11f * i));
+  }
+  return face;
+}
+
+float Distance(const NormalizedLandmark& mark_1,
+               const NormalizedLandmark& mark_2) {
+  return std::sqrt(std::pow((mark_1.x() - mark_2.x()) * kFrameWidth, 2) +
+                   std::pow((mark_1.y() - mark_2.y()) * kFrameHeight, 2) +
+                   std::pow(mark_1.z() - mark_2.z(), 2));
+}
+
+// Lip ratio computed directly from the landmark list.
+float ExpectedRatio(const NormalizedLandmarkList& face, int contour) {
+  auto landmark = [&](int i) {
+    return face.landmark(kLipLandmarkIdx[contour + i]);
+  };
+  float height = 0.0f;
+  for (int i = 0; i < 3; ++i) {
+    height += Distance(landmark(2 + i), landmark(5 + i));
+  }
+  return height / 3 / Distance(landmark(0), landmark(1));
+}
+
+TEST(LipGeometryTest, MatchesScalarRatios) {
+  // Up to 19 faces cover the vectorized and the remaining faces.
+  LipGeometry geometry;
+  std::vector<float> inner, outer;
+  for (int num_faces = 1; num_faces < 20; ++num_faces) {
+    std::vector<NormalizedLandmarkList> faces;
+    for (int i = 0; i < num_faces; ++i) {
+      faces.push_back(CreateFace(i, kFaceMeshLandmarks));
+    }
+    geometry.Gather(faces);
+    geometry.ComputeRatios(kFrameWidth, kFrameHeight, &inner, &outer);
+    ASSERT_EQ(num_faces, inner.size());
+    ASSERT_EQ(num_faces, outer.size());
+    for (int i = 0; i < num_faces; ++i) {
+      EXPECT_NEAR(ExpectedRatio(faces[i], 0), inner[i], 1e-5);
+      EXPECT_NEAR(ExpectedRatio(faces[i], 8), outer[i], 1e-5);
+    }
+  }
+}
+
+TEST(LipGeometryTest, RatiosAreIndependentOfOtherFaces) {
+  LipGeometry geometry;
+  std::vector<float> inner, outer, inner_alone, outer_alone;
+  geometry.Gather({CreateFace(3, kFaceMeshLandmarks)});
+  geometry.ComputeRatios(kFrameWidth, kFrameHeight, &inner_alone,
+                         &outer_alone);
+  geometry.Gather({CreateFace(1, kFaceMeshLandmarks),
+                   CreateFace(2, kFaceMeshLandmarks),
+                   CreateFace(3, kFaceMeshLandmarks)});
+  geometry.ComputeRatios(kFrameWidth, kFrameHeight, &inner, &outer);
+  ASSERT_EQ(3, inner.size());
+  EXPECT_FLOAT_EQ(inner_alone[0], inner[2]);
+  EXPECT_FLOAT_EQ(outer_alone[0], outer[2]);
+}
+
+TEST(LipGeometryTest, IncompleteFaceHasZeroRatio) {
+  LipGeometry geometry;
+  std::vector<float> inner, outer;
+  geometry.Gather({CreateFace(1, kFaceMeshLandmarks), CreateFace(2, 10)});
+  geometry.ComputeRatios(kFrameWidth, kFrameHeight, &inner, &outer);
+  ASSERT_EQ(2, inner.size());
+  EXPECT_GT(inner[0], 0.0f);
+  EXPECT_EQ(0.0f, inner[1]);
+  EXPECT_EQ(0.0f, outer[1]);
+}
+
+TEST(LipGeometryTest, NoFaces) {
+  LipGeometry geometry;
+  std::vector<float> inner{1.0f}, outer{1.0f};
+  geometry.Gather(std::vector<NormalizedLandmarkList>());
+  geometry.ComputeRatios(kFrameWidth, kFrameHeight, &inner, &outer);
+  EXPECT_TRUE(inner.empty());
+  EXPECT_TRUE(outer.empty());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,148 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/face_association.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_landmark_tracking.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputDetection[] = "DETECTIONS";
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
+constexpr char kOutputLipLandmark[] = "LIP_LANDMARKS";
+
+// This calculator outputs the lip landmarks of every face on every frame
+// while the face mesh only runs on keyframes (see
+// FaceMeshSchedulerCalculator).
+//
+// The output holds one LipLandmarks per face of DETECTIONS, in the same
+// order, so it can be passed to LipTrackCalculator with the same
+// detections. On keyframes, the lip landmarks of the face mesh are assigned
+// to the face box containing them. Otherwise, the lip landmarks of the face
+// in the previous frame are tracked in the current frame with
+// TrackLipLandmarks. The faces of consecutive frames are associated as in
+// LipTrackCalculator. Faces without lip landmarks are marked invalid.
+//
+// Example:
+//    calculator: "LipLandmarkTrackerCalculator"
+//    input_stream: "VIDEO:input_video"
+//    input_stream: "DETECTIONS:face_detections"
+//    input_stream: "LIP_LANDMARKS:keyframe_lip_landmarks"
+//    output_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+class LipLandmarkTrackerCalculator : public CalculatorBase {
+ public:
+  LipLandmarkTrackerCalculator() {}
+  ~LipLandmarkTrackerCalculator() override {}
+  LipLandmarkTrackerCalculator(const LipLandmarkTrackerCalculator&) = delete;
+  LipLandmarkTrackerCalculator& operator=(const LipLandmarkTrackerCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Forgets the previous frame.
+  void Reset();
+
+  FaceAssociation face_association_;
+  std::vector<int> previous_face_ids_;
+  GrayFrame frame_;
+  GrayFrame prev_frame_;
+  std::vector<Detection> prev_faces_;
+  std::vector<LipLandmarks> prev_lips_;
+};
+REGISTER_CALCULATOR(LipLandmarkTrackerCalculator);
+
+::mediapipe::Status LipLandmarkTrackerCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputVideo).Set<ImageFrame>();
+  cc->Inputs().Tag(kInputDetection).Set<std::vector<Detection>>();
+  cc->Inputs().Tag(kInputLipLandmark).Set<std::vector<LipLandmarks>>();
+  cc->Outputs().Tag(kOutputLipLandmark).Set<std::vector<LipLandmarks>>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipLandmarkTrackerCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipLandmarkTrackerCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  // Tracking needs consecutive frames with faces.
+  if (cc->Inputs().Tag(kInputVideo).IsEmpty() ||
+      cc->Inputs().Tag(kInputDetection).IsEmpty()) {
+    Reset();
+    return ::mediapipe::OkStatus();
+  }
+  const auto& faces =
+      cc->Inputs().Tag(kInputDetection).Get<std::vector<Detection>>();
+  frame_.Assign(cc->Inputs().Tag(kInputVideo).Get<ImageFrame>());
+
+  LipLandmarks invalid_lips = {};
+  invalid_lips.valid = false;
+  auto lips =
+      absl::make_unique<std::vector<LipLandmarks>>(faces.size(), invalid_lips);
+  if (!cc->Inputs().Tag(kInputLipLandmark).IsEmpty()) {
+    for (const auto& mesh_lips :
+         cc->Inputs().Tag(kInputLipLandmark).Get<std::vector<LipLandmarks>>()) {
+      const int face_idx = FindFaceOfLips(mesh_lips, faces);
+      if (face_idx != -1 && !(*lips)[face_idx].valid) {
+        (*lips)[face_idx] = mesh_lips;
+      }
+    }
+  }
+
+  face_association_.Match(faces, &previous_face_ids_);
+  for (int i = 0; i < faces.size(); ++i) {
+    const int prev_idx = previous_face_ids_[i];
+    if ((*lips)[i].valid || prev_idx == -1 || prev_frame_.empty()) {
+      continue;
+    }
+    TrackLipLandmarks(prev_frame_, frame_, prev_faces_[prev_idx], faces[i],
+                      prev_lips_[prev_idx], &(*lips)[i]);
+  }
+
+  prev_faces_ = faces;
+  prev_lips_ = *lips;
+  std::swap(frame_, prev_frame_);
+  cc->Outputs()
+      .Tag(kOutputLipLandmark)
+      .Add(lips.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+void LipLandmarkTrackerCalculator::Reset() {
+  face_association_.Reset();
+  prev_frame_.pixels.clear();
+  prev_faces_.clear();
+  prev_lips_.clear();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
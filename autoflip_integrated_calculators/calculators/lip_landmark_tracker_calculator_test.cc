@@ -0,0 +1,142 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputDetection[] = "DETECTIONS";
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
+constexpr char kOutputLipLandmark[] = "LIP_LANDMARKS";
+
+const int kFrameWidth = 200;
+const int kFrameHeight = 160;
+
+const char kConfig[] = R"(
+    calculator: "LipLandmarkTrackerCalculator"
+    input_stream: "VIDEO:input_video"
+    input_stream: "DETECTIONS:face_detections"
+    input_stream: "LIP_LANDMARKS:keyframe_lip_landmarks"
+    output_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+    )";
+
+Detection CreateFace(const float xmin, const float ymin, const float width,
+                     const float height) {
+  Detection face;
+  LocationData* location_data = face.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(xmin);
+  bbox->set_ymin(ymin);
+  bbox->set_width(width);
+  bbox->set_height(height);
+  return face;
+}
+
+// Textured SRGB frame, moved right by dx pixels.
+ImageFrame* CreateFrame(int dx) {
+  auto* frame = new ImageFrame(ImageFormat::SRGB, kFrameWidth, kFrameHeight);
+  for (int y = 0; y < kFrameHeight; ++y) {
+    uint8* row = frame->MutablePixelData() + y * frame->WidthStep();
+    for (int x = 0; x < kFrameWidth; ++x) {
+      const unsigned int u = x - dx;
+      const uint8 value = (u * 7919u ^ y * 104729u) * 2654435761u >> 24;
+      row[3 * x] = row[3 * x + 1] = row[3 * x + 2] = value;
+    }
+  }
+  return frame;
+}
+
+// Lips on a 4 x 4 grid of pixels around (x, y).
+LipLandmarks CreateLips(int x, int y) {
+  LipLandmarks lips;
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    lips.x[i] = static_cast<float>(x + 4 * (i % 4)) / kFrameWidth;
+    lips.y[i] = static_cast<float>(y + 4 * (i / 4)) / kFrameHeight;
+    lips.z[i] = 0;
+  }
+  lips.valid = true;
+  return lips;
+}
+
+TEST(LipLandmarkTrackerCalculatorTest, TracksLipsBetweenKeyframes) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  const std::vector<Detection> faces = {CreateFace(0.0, 0.2, 0.4, 0.5),
+                                        CreateFace(0.5, 0.2, 0.4, 0.5)};
+  for (int i = 0; i < 3; ++i) {
+    runner.MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(CreateFrame(2 * i)).At(Timestamp(i * 1000)));
+    runner.MutableInputs()->Tag(kInputDetection).packets.push_back(
+        Adopt(new std::vector<Detection>(faces)).At(Timestamp(i * 1000)));
+  }
+  // The face mesh only runs on the first frame, and lists the faces in
+  // another order than the face detector.
+  runner.MutableInputs()->Tag(kInputLipLandmark).packets.push_back(
+      Adopt(new std::vector<LipLandmarks>(
+                {CreateLips(130, 60), CreateLips(30, 60)}))
+          .At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputLipLandmark).packets;
+  ASSERT_EQ(3, packets.size());
+  for (int i = 0; i < 3; ++i) {
+    const auto& lips = packets[i].Get<std::vector<LipLandmarks>>();
+    ASSERT_EQ(2, lips.size());
+    const LipLandmarks expected[] = {CreateLips(30 + 2 * i, 60),
+                                     CreateLips(130 + 2 * i, 60)};
+    for (int face = 0; face < 2; ++face) {
+      EXPECT_TRUE(lips[face].valid);
+      for (int k = 0; k < kNumLipLandmarks; ++k) {
+        EXPECT_FLOAT_EQ(expected[face].x[k], lips[face].x[k]);
+        EXPECT_FLOAT_EQ(expected[face].y[k], lips[face].y[k]);
+      }
+    }
+  }
+}
+
+TEST(LipLandmarkTrackerCalculatorTest, NewFaceWithoutKeyframeIsInvalid) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner.MutableInputs()->Tag(kInputVideo).packets.push_back(
+      Adopt(CreateFrame(0)).At(Timestamp(0)));
+  runner.MutableInputs()->Tag(kInputDetection).packets.push_back(
+      Adopt(new std::vector<Detection>({CreateFace(0.0, 0.2, 0.4, 0.5)}))
+          .At(Timestamp(0)));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputLipLandmark).packets;
+  ASSERT_EQ(1, packets.size());
+  const auto& lips = packets[0].Get<std::vector<LipLandmarks>>();
+  ASSERT_EQ(1, lips.size());
+  EXPECT_FALSE(lips[0].valid);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,201 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_landmark_tracking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace mediapipe {
+namespace autoflip {
+
+void GrayFrame::Assign(const ImageFrame& frame) {
+  width = frame.Width();
+  height = frame.Height();
+  pixels.resize(width * height);
+  const int channels = frame.NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    const uint8* row = frame.PixelData() + y * frame.WidthStep();
+    uint8* out = pixels.data() + y * width;
+    if (channels < 3) {
+      for (int x = 0; x < width; ++x) out[x] = row[x * channels];
+      continue;
+    }
+    for (int x = 0; x < width; ++x) {
+      const uint8* pixel = row + x * channels;
+      out[x] = (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2]) >> 8;
+    }
+  }
+}
+
+uint8 GrayFrame::At(int x, int y) const {
+  x = std::min(std::max(x, 0), width - 1);
+  y = std::min(std::max(y, 0), height - 1);
+  return pixels[y * width + x];
+}
+
+namespace {
+
+// Sum of absolute differences between the patches centered on (x1, y1) in
+// frame1 and on (x2, y2) in frame2.
+int PatchDistance(const GrayFrame& frame1, int x1, int y1,
+                  const GrayFrame& frame2, int x2, int y2, int radius) {
+  int distance = 0;
+  for (int dy = -radius; dy <= radius; ++dy) {
+    for (int dx = -radius; dx <= radius; ++dx) {
+      distance += std::abs(frame1.At(x1 + dx, y1 + dy) -
+                           frame2.At(x2 + dx, y2 + dy));
+    }
+  }
+  return distance;
+}
+
+}  // namespace
+
+void TrackLipLandmarks(const GrayFrame& prev_frame, const GrayFrame& frame,
+                       const Detection& prev_face, const Detection& face,
+                       const LipLandmarks& prev_lips, LipLandmarks* lips,
+                       int patch_radius, float search_range) {
+  const auto& prev_box = prev_face.location_data().relative_bounding_box();
+  const auto& box = face.location_data().relative_bounding_box();
+  if (!prev_lips.valid || prev_box.width() <= 0 || prev_box.height() <= 0) {
+    *lips = prev_lips;
+    return;
+  }
+  lips->valid = true;
+  const float x_scale = box.width() / prev_box.width();
+  const float y_scale = box.height() / prev_box.height();
+  const int search_radius =
+      std::max(1, static_cast<int>(
+                      std::lround(search_range * box.width() * frame.width)));
+
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    // Moves the landmark with the face box.
+    const float x = box.xmin() + (prev_lips.x[i] - prev_box.xmin()) * x_scale;
+    const float y = box.ymin() + (prev_lips.y[i] - prev_box.ymin()) * y_scale;
+    lips->z[i] = prev_lips.z[i] * x_scale;
+
+    const int prev_x = std::lround(prev_lips.x[i] * prev_frame.width);
+    const int prev_y = std::lround(prev_lips.y[i] * prev_frame.height);
+    const int center_x = std::lround(x * frame.width);
+    const int center_y = std::lround(y * frame.height);
+    // Keeps the prediction unless a patch matches strictly better, and
+    // prefers the smaller moves on ties.
+    int best_distance = PatchDistance(prev_frame, prev_x, prev_y, frame,
+                                      center_x, center_y, patch_radius);
+    int best_dx = 0;
+    int best_dy = 0;
+    for (int dy = -search_radius; dy <= search_radius; ++dy) {
+      for (int dx = -search_radius; dx <= search_radius; ++dx) {
+        if (dx == 0 && dy == 0) continue;
+        const int distance =
+            PatchDistance(prev_frame, prev_x, prev_y, frame, center_x + dx,
+                          center_y + dy, patch_radius);
+        const int move = std::abs(dx) + std::abs(dy);
+        if (distance < best_distance ||
+            (distance == best_distance &&
+             move < std::abs(best_dx) + std::abs(best_dy))) {
+          best_distance = distance;
+          best_dx = dx;
+          best_dy = dy;
+        }
+      }
+    }
+    lips->x[i] = static_cast<float>(center_x + best_dx) / frame.width;
+    lips->y[i] = static_cast<float>(center_y + best_dy) / frame.height;
+  }
+}
+
+int FindFaceOfLips(const LipLandmarks& lips,
+                   const std::vector<Detection>& faces) {
+  if (!lips.valid) {
+    return -1;
+  }
+  float lips_x = 0;
+  float lips_y = 0;
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    lips_x += lips.x[i];
+    lips_y += lips.y[i];
+  }
+  lips_x /= kNumLipLandmarks;
+  lips_y /= kNumLipLandmarks;
+
+  int best_face = -1;
+  float best_distance = std::numeric_limits<float>::max();
+  for (int i = 0; i < faces.size(); ++i) {
+    const auto& box = faces[i].location_data().relative_bounding_box();
+    if (lips_x < box.xmin() || lips_x > box.xmin() + box.width() ||
+        lips_y < box.ymin() || lips_y > box.ymin() + box.height()) {
+      continue;
+    }
+    const float dx = lips_x - (box.xmin() + box.width() / 2);
+    const float dy = lips_y - (box.ymin() + box.height() / 2);
+    const float distance = dx * dx + dy * dy;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best_face = i;
+    }
+  }
+  return best_face;
+}
+
+bool GetMouthCrop(const LipLandmarks& lips, int width, int height,
+                  float margin, int max_shift, MouthCrop* crop) {
+  if (!lips.valid) {
+    return false;
+  }
+  const auto x_range = std::minmax_element(lips.x, lips.x + kNumLipLandmarks);
+  const auto y_range = std::minmax_element(lips.y, lips.y + kNumLipLandmarks);
+  const float border = margin * (*x_range.second - *x_range.first);
+  const int xmin = std::floor((*x_range.first - border) * width);
+  const int ymin = std::floor((*y_range.first - border) * height);
+  const int xmax = std::ceil((*x_range.second + border) * width);
+  const int ymax = std::ceil((*y_range.second + border) * height);
+  crop->xmin = std::max(max_shift, xmin);
+  crop->ymin = std::max(max_shift, ymin);
+  crop->xmax = std::min(width - max_shift, xmax);
+  crop->ymax = std::min(height - max_shift, ymax);
+  return crop->xmin < crop->xmax && crop->ymin < crop->ymax;
+}
+
+float MouthMotion(const GrayFrame& prev_frame, const GrayFrame& frame,
+                  const MouthCrop& crop, int max_shift) {
+  const int crop_width = crop.xmax - crop.xmin;
+  const int crop_height = crop.ymax - crop.ymin;
+  if (crop_width <= 0 || crop_height <= 0) {
+    return 0.0f;
+  }
+  int best_distance = std::numeric_limits<int>::max();
+  for (int dy = -max_shift; dy <= max_shift; ++dy) {
+    for (int dx = -max_shift; dx <= max_shift; ++dx) {
+      int distance = 0;
+      for (int y = crop.ymin; y < crop.ymax; ++y) {
+        const uint8* prev_row = prev_frame.pixels.data() + y * frame.width;
+        const uint8* row = frame.pixels.data() + (y + dy) * frame.width + dx;
+        for (int x = crop.xmin; x < crop.xmax; ++x) {
+          distance += std::abs(prev_row[x] - row[x]);
+        }
+        // This shift can no longer win.
+        if (distance >= best_distance) break;
+      }
+      best_distance = std::min(best_distance, distance);
+    }
+  }
+  return best_distance / (255.0f * crop_width * crop_height);
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
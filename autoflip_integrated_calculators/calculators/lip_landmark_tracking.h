@@ -0,0 +1,88 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_LANDMARK_TRACKING_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_LANDMARK_TRACKING_H_
+
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// 8-bit grayscale copy of a frame.
+struct GrayFrame {
+  std::vector<uint8> pixels;
+  int width = 0;
+  int height = 0;
+
+  // Converts an SRGB or SRGBA frame, reusing the storage.
+  void Assign(const ImageFrame& frame);
+  // Pixel at (x, y), with the coordinates clamped to the frame.
+  uint8 At(int x, int y) const;
+  bool empty() const { return pixels.empty(); }
+};
+
+// Moves the lip landmarks of a face from the previous frame to the current
+// frame, so that the lip statistics can be computed between two face mesh
+// keyframes.
+//
+// Every landmark is first moved and scaled with the relative bounding box
+// of the face, then refined by block matching: the patch of
+// 2 * patch_radius + 1 pixels around the landmark in the previous frame is
+// searched in the current frame within search_range times the face width.
+// The refinement follows the lips opening and closing, which the face box
+// does not.
+void TrackLipLandmarks(const GrayFrame& prev_frame, const GrayFrame& frame,
+                       const Detection& prev_face, const Detection& face,
+                       const LipLandmarks& prev_lips, LipLandmarks* lips,
+                       int patch_radius = 3, float search_range = 0.04f);
+
+// Returns the index of the face whose relative bounding box contains the
+// center of the lips, the closest to the box center if several do, or -1.
+int FindFaceOfLips(const LipLandmarks& lips,
+                   const std::vector<Detection>& faces);
+
+// Pixel box [xmin, xmax) x [ymin, ymax) of a mouth in a frame.
+struct MouthCrop {
+  int xmin = 0;
+  int ymin = 0;
+  int xmax = 0;
+  int ymax = 0;
+};
+
+// Returns the box of the lip landmarks in a width x height frame, grown by
+// margin times the mouth width on every side. The box is clamped max_shift
+// pixels away from the frame borders, so that MouthMotion can shift it
+// without reading outside of the frame. Returns false if the lips are
+// invalid or the box is empty.
+bool GetMouthCrop(const LipLandmarks& lips, int width, int height,
+                  float margin, int max_shift, MouthCrop* crop);
+
+// Mouth motion between two frames of the same size: the mean absolute
+// difference of the gray levels in the mouth crop, in [0, 1]. The crop of
+// frame is shifted by up to max_shift pixels to best match prev_frame, so
+// that a small move of the head is not taken for the mouth opening or
+// closing.
+float MouthMotion(const GrayFrame& prev_frame, const GrayFrame& frame,
+                  const MouthCrop& crop, int max_shift);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_LANDMARK_TRACKING_H_
@@ -0,0 +1,178 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_landmark_tracking.h"
+
+#include <vector>
+
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kFrameWidth = 200;
+const int kFrameHeight = 160;
+
+Detection CreateFace(const float xmin, const float ymin, const float width,
+                     const float height) {
+  Detection face;
+  LocationData* location_data = face.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(xmin);
+  bbox->set_ymin(ymin);
+  bbox->set_width(width);
+  bbox->set_height(height);
+  return face;
+}
+
+// Textured frame, moved by (dx, dy) pixels.
+GrayFrame CreateFrame(int dx, int dy) {
+  GrayFrame frame;
+  frame.width = kFrameWidth;
+  frame.height = kFrameHeight;
+  frame.pixels.resize(kFrameWidth * kFrameHeight);
+  for (int y = 0; y < kFrameHeight; ++y) {
+    for (int x = 0; x < kFrameWidth; ++x) {
+      const unsigned int u = x - dx;
+      const unsigned int v = y - dy;
+      frame.pixels[y * kFrameWidth + x] =
+          (u * 7919u ^ v * 104729u) * 2654435761u >> 24;
+    }
+  }
+  return frame;
+}
+
+// Lips on a 4 x 4 grid of pixels around (x, y).
+LipLandmarks CreateLips(int x, int y) {
+  LipLandmarks lips;
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    lips.x[i] = static_cast<float>(x + 4 * (i % 4)) / kFrameWidth;
+    lips.y[i] = static_cast<float>(y + 4 * (i / 4)) / kFrameHeight;
+    lips.z[i] = 0.01f * i;
+  }
+  lips.valid = true;
+  return lips;
+}
+
+TEST(LipLandmarkTrackingTest, FollowsTheImage) {
+  const Detection face = CreateFace(0.25, 0.25, 0.5, 0.5);
+  const LipLandmarks prev_lips = CreateLips(90, 90);
+  LipLandmarks lips;
+  TrackLipLandmarks(CreateFrame(0, 0), CreateFrame(3, -2), face, face,
+                    prev_lips, &lips);
+  const LipLandmarks expected = CreateLips(93, 88);
+  EXPECT_TRUE(lips.valid);
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    EXPECT_FLOAT_EQ(expected.x[i], lips.x[i]);
+    EXPECT_FLOAT_EQ(expected.y[i], lips.y[i]);
+    EXPECT_FLOAT_EQ(prev_lips.z[i], lips.z[i]);
+  }
+}
+
+TEST(LipLandmarkTrackingTest, FollowsTheFaceBeyondTheSearchRange) {
+  // The face moves by 20 pixels, more than the search range of 4 pixels.
+  const Detection prev_face = CreateFace(0.25, 0.25, 0.5, 0.5);
+  const Detection face = CreateFace(0.35, 0.25, 0.5, 0.5);
+  LipLandmarks lips;
+  TrackLipLandmarks(CreateFrame(0, 0), CreateFrame(21, 1), prev_face, face,
+                    CreateLips(90, 90), &lips);
+  const LipLandmarks expected = CreateLips(111, 91);
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    EXPECT_FLOAT_EQ(expected.x[i], lips.x[i]);
+    EXPECT_FLOAT_EQ(expected.y[i], lips.y[i]);
+  }
+}
+
+TEST(LipLandmarkTrackingTest, InvalidLipsStayInvalid) {
+  const Detection face = CreateFace(0.25, 0.25, 0.5, 0.5);
+  LipLandmarks prev_lips = CreateLips(90, 90);
+  prev_lips.valid = false;
+  LipLandmarks lips;
+  TrackLipLandmarks(CreateFrame(0, 0), CreateFrame(1, 0), face, face,
+                    prev_lips, &lips);
+  EXPECT_FALSE(lips.valid);
+}
+
+TEST(LipLandmarkTrackingTest, FindsTheFaceOfTheLips) {
+  const std::vector<Detection> faces = {CreateFace(0.6, 0.2, 0.3, 0.6),
+                                        CreateFace(0.0, 0.0, 1.0, 1.0),
+                                        CreateFace(0.25, 0.25, 0.4, 0.4)};
+  // The lips are in the large face and the last one, which is centered on
+  // the lips.
+  EXPECT_EQ(2, FindFaceOfLips(CreateLips(84, 66), faces));
+  EXPECT_EQ(1, FindFaceOfLips(CreateLips(10, 10), faces));
+  EXPECT_EQ(-1, FindFaceOfLips(CreateLips(10, 10),
+                               std::vector<Detection>(1, faces[0])));
+}
+
+TEST(LipLandmarkTrackingTest, GetsTheMouthCrop) {
+  // The lips cover pixels 90 to 102, and the margin adds 3 pixels.
+  MouthCrop crop;
+  ASSERT_TRUE(GetMouthCrop(CreateLips(90, 90), kFrameWidth, kFrameHeight,
+                           0.25f, 2, &crop));
+  EXPECT_NEAR(87, crop.xmin, 1);
+  EXPECT_NEAR(87, crop.ymin, 1);
+  EXPECT_NEAR(105, crop.xmax, 1);
+  EXPECT_NEAR(105, crop.ymax, 1);
+  // The crop stays max_shift pixels away from the borders.
+  ASSERT_TRUE(GetMouthCrop(CreateLips(0, 0), kFrameWidth, kFrameHeight,
+                           0.25f, 2, &crop));
+  EXPECT_EQ(2, crop.xmin);
+  EXPECT_EQ(2, crop.ymin);
+  LipLandmarks invalid_lips = CreateLips(90, 90);
+  invalid_lips.valid = false;
+  EXPECT_FALSE(GetMouthCrop(invalid_lips, kFrameWidth, kFrameHeight, 0.25f,
+                            2, &crop));
+}
+
+TEST(LipLandmarkTrackingTest, MouthMotionIgnoresSmallHeadMoves) {
+  MouthCrop crop;
+  ASSERT_TRUE(GetMouthCrop(CreateLips(90, 90), kFrameWidth, kFrameHeight,
+                           0.25f, 2, &crop));
+  const GrayFrame prev_frame = CreateFrame(0, 0);
+  EXPECT_EQ(0.0f, MouthMotion(prev_frame, prev_frame, crop, 2));
+  EXPECT_EQ(0.0f, MouthMotion(prev_frame, CreateFrame(1, -2), crop, 2));
+  EXPECT_GT(MouthMotion(prev_frame, CreateFrame(1, -2), crop, 0), 0.1f);
+}
+
+TEST(LipLandmarkTrackingTest, MouthMotionMeasuresTheMouthOpening) {
+  MouthCrop crop;
+  ASSERT_TRUE(GetMouthCrop(CreateLips(90, 90), kFrameWidth, kFrameHeight,
+                           0.25f, 2, &crop));
+  const GrayFrame prev_frame = CreateFrame(0, 0);
+  // The mouth opens: a dark hole appears in the middle of the lips.
+  GrayFrame frame = prev_frame;
+  for (int y = 94; y < 98; ++y) {
+    for (int x = 92; x < 100; ++x) {
+      frame.pixels[y * kFrameWidth + x] = 0;
+    }
+  }
+  const float motion = MouthMotion(prev_frame, frame, crop, 2);
+  EXPECT_GT(motion, 0.01f);
+  EXPECT_LT(motion, 0.2f);
+  // Outside of the crop, the hole does not count.
+  MouthCrop other_crop;
+  ASSERT_TRUE(GetMouthCrop(CreateLips(30, 30), kFrameWidth, kFrameHeight,
+                           0.25f, 2, &other_crop));
+  EXPECT_EQ(0.0f, MouthMotion(prev_frame, frame, other_crop, 2));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,84 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+constexpr char kInputLandmark[] = "LANDMARKS";
+constexpr char kOutputLipLandmark[] = "LIP_LANDMARKS";
+
+// This calculator keeps the lip landmarks of the face meshes, which are the
+// only landmarks LipTrackCalculator reads, so that LipTrackCalculator
+// buffers a small LipLandmarks struct per face instead of the 468 landmark
+// protos.
+// Example:
+//    calculator: "LipLandmarksCalculator"
+//    input_stream: "LANDMARKS:multi_face_landmarks"
+//    output_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+class LipLandmarksCalculator : public CalculatorBase {
+ public:
+  LipLandmarksCalculator() {}
+  ~LipLandmarksCalculator() override {}
+  LipLandmarksCalculator(const LipLandmarksCalculator&) = delete;
+  LipLandmarksCalculator& operator=(const LipLandmarksCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+};
+REGISTER_CALCULATOR(LipLandmarksCalculator);
+
+::mediapipe::Status LipLandmarksCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputLandmark).Set<std::vector<NormalizedLandmarkList>>();
+  cc->Outputs().Tag(kOutputLipLandmark).Set<std::vector<LipLandmarks>>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipLandmarksCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipLandmarksCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kInputLandmark).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& landmark_lists =
+      cc->Inputs().Tag(kInputLandmark).Get<std::vector<NormalizedLandmarkList>>();
+  auto lip_landmarks = absl::make_unique<std::vector<LipLandmarks>>();
+  lip_landmarks->reserve(landmark_lists.size());
+  for (const auto& landmark_list : landmark_lists) {
+    lip_landmarks->push_back(ExtractLipLandmarks(landmark_list));
+  }
+  cc->Outputs()
+      .Tag(kOutputLipLandmark)
+      .Add(lip_landmarks.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
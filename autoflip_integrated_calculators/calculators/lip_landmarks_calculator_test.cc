@@ -0,0 +1,77 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputLandmark[] = "LANDMARKS";
+constexpr char kOutputLipLandmark[] = "LIP_LANDMARKS";
+
+const char kConfig[] = R"(
+    calculator: "LipLandmarksCalculator"
+    input_stream: "LANDMARKS:multi_face_landmarks"
+    output_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+    )";
+
+NormalizedLandmarkList CreateLandmarkList(int num_landmarks) {
+  NormalizedLandmarkList landmark_list;
+  for (int i = 0; i < num_landmarks; ++i) {
+    auto* landmark = landmark_list.add_landmark();
+    landmark->set_x(i * 0.001f);
+    landmark->set_y(i * 0.002f);
+    landmark->set_z(i * 0.003f);
+  }
+  return landmark_list;
+}
+
+TEST(LipLandmarksCalculatorTest, ExtractsLipLandmarks) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  auto landmark_lists = absl::make_unique<std::vector<NormalizedLandmarkList>>();
+  landmark_lists->push_back(CreateLandmarkList(kFaceMeshLandmarks));
+  landmark_lists->push_back(CreateLandmarkList(10));
+  runner.MutableInputs()->Tag(kInputLandmark).packets.push_back(
+      Adopt(landmark_lists.release()).At(Timestamp(1000)));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputLipLandmark).packets;
+  ASSERT_EQ(1, packets.size());
+  EXPECT_EQ(Timestamp(1000), packets[0].Timestamp());
+  const auto& lip_landmarks = packets[0].Get<std::vector<LipLandmarks>>();
+  ASSERT_EQ(2, lip_landmarks.size());
+  EXPECT_TRUE(lip_landmarks[0].valid);
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    EXPECT_FLOAT_EQ(kLipLandmarkIdx[i] * 0.001f, lip_landmarks[0].x[i]);
+    EXPECT_FLOAT_EQ(kLipLandmarkIdx[i] * 0.002f, lip_landmarks[0].y[i]);
+    EXPECT_FLOAT_EQ(kLipLandmarkIdx[i] * 0.003f, lip_landmarks[0].z[i]);
+  }
+  EXPECT_FALSE(lip_landmarks[1].valid);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
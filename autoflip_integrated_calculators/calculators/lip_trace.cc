@@ -0,0 +1,332 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_builder.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// The records are read in place, so their layout must not change.
+static_assert(sizeof(LipTraceHeader) == 48, "LipTraceHeader layout changed");
+static_assert(sizeof(LipTraceFrame) == 24, "LipTraceFrame layout changed");
+static_assert(sizeof(LipTraceFace) == 212, "LipTraceFace layout changed");
+
+namespace {
+
+// The frames are aligned for their int64 timestamps.
+uint64 AlignFrames(uint64 offset) {
+  const uint64 alignment = alignof(LipTraceFrame);
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+LipTraceWriter::~LipTraceWriter() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
+
+::mediapipe::Status LipTraceWriter::Open(const std::string& path,
+                                         int frame_width, int frame_height) {
+  RET_CHECK(file_ == nullptr) << "The trace is already open.";
+  file_ = fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return ::mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot open the lip trace " << path;
+  }
+  path_ = path;
+  std::memset(&header_, 0, sizeof(header_));
+  std::memcpy(header_.magic, kLipTraceMagic, sizeof(header_.magic));
+  header_.version = kLipTraceVersion;
+  header_.frame_width = frame_width;
+  header_.frame_height = frame_height;
+  header_.faces_offset = sizeof(LipTraceHeader);
+  frames_.clear();
+  // The header is written again with the counts in Close().
+  if (fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+    return ::mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot write the lip trace " << path_;
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void LipTraceWriter::SetFrameSize(int frame_width, int frame_height) {
+  header_.frame_width = frame_width;
+  header_.frame_height = frame_height;
+}
+
+::mediapipe::Status LipTraceWriter::AddFrame(
+    int64 timestamp, const std::vector<LipLandmarks>& lip_landmarks,
+    const std::vector<Detection>& detections, const bool* shot_boundary,
+    bool has_video) {
+  RET_CHECK(file_ != nullptr) << "The trace is not open.";
+  RET_CHECK_EQ(lip_landmarks.size(), detections.size())
+      << "Each face needs its lip landmarks.";
+  LipTraceFrame frame;
+  frame.timestamp = timestamp;
+  frame.first_face = header_.num_faces;
+  frame.num_faces = detections.size();
+  frame.flags = has_video ? kLipTraceHasVideo : 0;
+  if (shot_boundary != nullptr) {
+    frame.flags |= kLipTraceHasShotBoundary;
+    if (*shot_boundary) {
+      frame.flags |= kLipTraceShotBoundary;
+    }
+  }
+  for (int i = 0; i < detections.size(); ++i) {
+    const LipTraceFace face = ToLipTraceFace(lip_landmarks[i], detections[i]);
+    if (fwrite(&face, sizeof(face), 1, file_) != 1) {
+      return ::mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+             << "Cannot write the lip trace " << path_;
+    }
+  }
+  header_.num_faces += detections.size();
+  frames_.push_back(frame);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipTraceWriter::Close() {
+  RET_CHECK(file_ != nullptr) << "The trace is not open.";
+  const uint64 faces_end =
+      header_.faces_offset + header_.num_faces * sizeof(LipTraceFace);
+  header_.frames_offset = AlignFrames(faces_end);
+  header_.num_frames = frames_.size();
+  const char padding[alignof(LipTraceFrame)] = {};
+  bool ok =
+      fwrite(padding, 1, header_.frames_offset - faces_end, file_) ==
+          header_.frames_offset - faces_end &&
+      fwrite(frames_.data(), sizeof(LipTraceFrame), frames_.size(), file_) ==
+          frames_.size() &&
+      fseek(file_, 0, SEEK_SET) == 0 &&
+      fwrite(&header_, sizeof(header_), 1, file_) == 1;
+  ok = fclose(file_) == 0 && ok;
+  file_ = nullptr;
+  frames_.clear();
+  if (!ok) {
+    return ::mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot write the lip trace " << path_;
+  }
+  return ::mediapipe::OkStatus();
+}
+
+LipTrace::~LipTrace() { Unmap(); }
+
+void LipTrace::Unmap() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  faces_ = nullptr;
+  frames_ = nullptr;
+}
+
+::mediapipe::Status LipTrace::Open(const std::string& path) {
+  Unmap();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ::mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot open the lip trace " << path;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      file_stat.st_size < sizeof(LipTraceHeader)) {
+    close(fd);
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Not a lip trace: " << path;
+  }
+  void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return ::mediapipe::UnknownErrorBuilder(MEDIAPIPE_LOC)
+           << "Cannot map the lip trace " << path;
+  }
+  data_ = data;
+  size_ = file_stat.st_size;
+
+  const char* bytes = static_cast<const char*>(data_);
+  header_ = reinterpret_cast<const LipTraceHeader*>(bytes);
+  const bool valid_header =
+      std::memcmp(header_->magic, kLipTraceMagic, sizeof(kLipTraceMagic)) ==
+          0 &&
+      header_->version == kLipTraceVersion &&
+      header_->faces_offset == sizeof(LipTraceHeader) &&
+      header_->num_faces <= (size_ - header_->faces_offset) /
+                                sizeof(LipTraceFace) &&
+      header_->frames_offset ==
+          AlignFrames(header_->faces_offset +
+                      header_->num_faces * sizeof(LipTraceFace)) &&
+      header_->frames_offset <= size_ &&
+      header_->num_frames ==
+          (size_ - header_->frames_offset) / sizeof(LipTraceFrame);
+  if (!valid_header) {
+    Unmap();
+    return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Not a lip trace, or a truncated one: " << path;
+  }
+  faces_ = reinterpret_cast<const LipTraceFace*>(bytes + header_->faces_offset);
+  frames_ =
+      reinterpret_cast<const LipTraceFrame*>(bytes + header_->frames_offset);
+  for (int i = 0; i < header_->num_frames; ++i) {
+    if (frames_[i].first_face > header_->num_faces ||
+        frames_[i].num_faces > header_->num_faces - frames_[i].first_face) {
+      Unmap();
+      return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+             << "Frame " << i << " is out of the faces of the lip trace "
+             << path;
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+LipTraceFace ToLipTraceFace(const LipLandmarks& lip_landmarks,
+                            const Detection& detection) {
+  LipTraceFace face;
+  const auto& bbox = detection.location_data().relative_bounding_box();
+  face.xmin = bbox.xmin();
+  face.ymin = bbox.ymin();
+  face.width = bbox.width();
+  face.height = bbox.height();
+  std::memcpy(face.x, lip_landmarks.x, sizeof(face.x));
+  std::memcpy(face.y, lip_landmarks.y, sizeof(face.y));
+  std::memcpy(face.z, lip_landmarks.z, sizeof(face.z));
+  face.valid = lip_landmarks.valid;
+  return face;
+}
+
+LipLandmarks ToLipLandmarks(const LipTraceFace& face) {
+  LipLandmarks lip_landmarks;
+  std::memcpy(lip_landmarks.x, face.x, sizeof(face.x));
+  std::memcpy(lip_landmarks.y, face.y, sizeof(face.y));
+  std::memcpy(lip_landmarks.z, face.z, sizeof(face.z));
+  lip_landmarks.valid = face.valid != 0;
+  return lip_landmarks;
+}
+
+Detection ToDetection(const LipTraceFace& face) {
+  Detection detection;
+  auto* location_data = detection.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(face.xmin);
+  bbox->set_ymin(face.ymin);
+  bbox->set_width(face.width);
+  bbox->set_height(face.height);
+  return detection;
+}
+
+namespace {
+
+// Lip opening ratios of the faces, see LipGeometry. The talking face
+// opens and closes its mouth with a period of 8 frames.
+constexpr float kQuietRatio = 0.03f;
+constexpr float kTalkingRatio = 0.3f;
+constexpr float kTalkingAmplitude = 0.25f;
+constexpr int kTalkingPeriod = 8;
+
+// Lips of a mouth whose inner contour has the given opening ratio, in the
+// lower middle of the face box.
+LipLandmarks CreateMouth(const Detection& face, float ratio, int frame_width,
+                         int frame_height) {
+  const auto& bbox = face.location_data().relative_bounding_box();
+  const float center_x = bbox.xmin() + bbox.width() / 2;
+  const float center_y = bbox.ymin() + bbox.height() * 0.75f;
+  const float width = bbox.width() * 0.4f;
+  const float aspect = static_cast<float>(frame_width) / frame_height;
+  LipLandmarks lips;
+  // The outer contour is wider and higher than the inner one.
+  const float contour_widths[2] = {width, width * 1.2f};
+  const float contour_heights[2] = {ratio * width * aspect,
+                                    (ratio + 0.3f) * width * aspect};
+  for (int contour = 0; contour < 2; ++contour) {
+    float* x = lips.x + contour * 8;
+    float* y = lips.y + contour * 8;
+    const float half_width = contour_widths[contour] / 2;
+    const float half_height = contour_heights[contour] / 2;
+    // Corners, then the upper and the lower lip from left to right.
+    x[0] = center_x - half_width;
+    x[1] = center_x + half_width;
+    y[0] = y[1] = center_y;
+    for (int i = 0; i < 3; ++i) {
+      x[2 + i] = x[5 + i] = center_x + (i - 1) * half_width / 2;
+      y[2 + i] = center_y - half_height;
+      y[5 + i] = center_y + half_height;
+    }
+  }
+  std::memset(lips.z, 0, sizeof(lips.z));
+  lips.valid = true;
+  return lips;
+}
+
+}  // namespace
+
+::mediapipe::Status WriteSyntheticLipTrace(
+    const SyntheticLipTraceOptions& options, const std::string& path) {
+  RET_CHECK_GT(options.num_faces, 0);
+  RET_CHECK_GT(options.speaker_frames, 0);
+  LipTraceWriter writer;
+  MP_RETURN_IF_ERROR(
+      writer.Open(path, options.frame_width, options.frame_height));
+
+  std::mt19937 generator(options.seed);
+  std::uniform_real_distribution<float> jitter(-0.002f, 0.002f);
+  const int grid = std::ceil(std::sqrt(options.num_faces));
+  const float size = 0.8f / grid;
+  std::vector<Detection> faces(options.num_faces);
+  std::vector<LipLandmarks> lips(options.num_faces);
+  for (int frame = 0; frame < options.num_frames; ++frame) {
+    const int speaker = (frame / options.speaker_frames) % options.num_faces;
+    for (int i = 0; i < options.num_faces; ++i) {
+      Detection& face = faces[i];
+      auto* location_data = face.mutable_location_data();
+      location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+      auto* bbox = location_data->mutable_relative_bounding_box();
+      bbox->set_xmin(0.1f + (i % grid) * 0.8f / grid + jitter(generator));
+      bbox->set_ymin(0.1f + (i / grid) * 0.8f / grid + jitter(generator));
+      bbox->set_width(size);
+      bbox->set_height(size);
+      const float ratio =
+          i == speaker
+              ? kTalkingRatio +
+                    kTalkingAmplitude *
+                        std::sin(2 * M_PI * frame / kTalkingPeriod)
+              : kQuietRatio;
+      lips[i] = CreateMouth(face, ratio, options.frame_width,
+                            options.frame_height);
+    }
+    bool shot_boundary =
+        options.shot_frames > 0 && frame > 0 && frame % options.shot_frames == 0;
+    MP_RETURN_IF_ERROR(writer.AddFrame(frame * options.frame_duration_us, lips,
+                                       faces, &shot_boundary));
+  }
+  return writer.Close();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
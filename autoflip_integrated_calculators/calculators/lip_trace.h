@@ -0,0 +1,191 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_TRACE_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_TRACE_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// A lip trace holds the inputs of LipTrackCalculator, i.e. the lip
+// landmarks, the face boxes and the shot boundaries of a video, so that the
+// speaker logic can be run and benchmarked without the face mesh.
+//
+// The file is a header, the faces and then the frames, all fixed-size
+// little-endian records which are read in place from a memory mapping:
+//   LipTraceHeader
+//   LipTraceFace[num_faces]    faces of all the frames, in frame order
+//   LipTraceFrame[num_frames]
+// The frames are written last, so that a trace is written in one pass.
+
+constexpr char kLipTraceMagic[8] = {'L', 'I', 'P', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32 kLipTraceVersion = 1;
+
+struct LipTraceHeader {
+  char magic[8];
+  uint32 version;
+  // Dimensions of the video frames.
+  int32 frame_width;
+  int32 frame_height;
+  uint32 num_frames;
+  uint64 num_faces;
+  // Byte offsets of the faces and of the frames in the file.
+  uint64 faces_offset;
+  uint64 frames_offset;
+};
+
+struct LipTraceFrame {
+  int64 timestamp;
+  // Index of the first face of the frame in the faces of the trace.
+  uint64 first_face;
+  uint32 num_faces;
+  // Combination of the LipTraceFrameFlags.
+  uint32 flags;
+};
+
+enum LipTraceFrameFlags : uint32 {
+  // The frame has a SHOT_BOUNDARIES packet, whose value is
+  // kLipTraceShotBoundary.
+  kLipTraceHasShotBoundary = 1,
+  kLipTraceShotBoundary = 2,
+  // The frame has a VIDEO packet. Timestamps with only a shot boundary
+  // have none.
+  kLipTraceHasVideo = 4,
+};
+
+struct LipTraceFace {
+  // Relative bounding box of the face detection.
+  float xmin;
+  float ymin;
+  float width;
+  float height;
+  float x[kNumLipLandmarks];
+  float y[kNumLipLandmarks];
+  float z[kNumLipLandmarks];
+  uint32 valid;
+};
+
+// Writes a lip trace frame by frame.
+//
+// Example:
+//   LipTraceWriter writer;
+//   MP_RETURN_IF_ERROR(writer.Open(path, frame_width, frame_height));
+//   MP_RETURN_IF_ERROR(writer.AddFrame(timestamp, lips, faces, nullptr));
+//   MP_RETURN_IF_ERROR(writer.Close());
+class LipTraceWriter {
+ public:
+  LipTraceWriter() {}
+  ~LipTraceWriter();
+  LipTraceWriter(const LipTraceWriter&) = delete;
+  LipTraceWriter& operator=(const LipTraceWriter&) = delete;
+
+  ::mediapipe::Status Open(const std::string& path, int frame_width,
+                           int frame_height);
+  // Sets the frame dimensions if they are unknown when the trace is opened.
+  void SetFrameSize(int frame_width, int frame_height);
+  // Adds a frame. lip_landmarks and detections must have the same size, the
+  // i-th lips being the ones of the i-th face. shot_boundary is null when
+  // the frame has no SHOT_BOUNDARIES packet.
+  ::mediapipe::Status AddFrame(int64 timestamp,
+                               const std::vector<LipLandmarks>& lip_landmarks,
+                               const std::vector<Detection>& detections,
+                               const bool* shot_boundary,
+                               bool has_video = true);
+  // Writes the frames and the header, and closes the file.
+  ::mediapipe::Status Close();
+
+ private:
+  FILE* file_ = nullptr;
+  std::string path_;
+  LipTraceHeader header_;
+  std::vector<LipTraceFrame> frames_;
+};
+
+// A lip trace mapped in memory.
+//
+// Example:
+//   LipTrace trace;
+//   MP_RETURN_IF_ERROR(trace.Open(path));
+//   for (int i = 0; i < trace.num_frames(); ++i) {
+//     const LipTraceFrame& frame = trace.frame(i);
+//     const LipTraceFace* faces = trace.faces(frame);
+//   }
+class LipTrace {
+ public:
+  LipTrace() {}
+  ~LipTrace();
+  LipTrace(const LipTrace&) = delete;
+  LipTrace& operator=(const LipTrace&) = delete;
+
+  ::mediapipe::Status Open(const std::string& path);
+
+  int frame_width() const { return header_->frame_width; }
+  int frame_height() const { return header_->frame_height; }
+  int num_frames() const { return header_->num_frames; }
+  const LipTraceFrame& frame(int i) const { return frames_[i]; }
+  // The faces of a frame.
+  const LipTraceFace* faces(const LipTraceFrame& frame) const {
+    return faces_ + frame.first_face;
+  }
+
+ private:
+  void Unmap();
+
+  void* data_ = nullptr;
+  size_t size_ = 0;
+  const LipTraceHeader* header_ = nullptr;
+  const LipTraceFace* faces_ = nullptr;
+  const LipTraceFrame* frames_ = nullptr;
+};
+
+// Converts between the records of a trace and the packets of
+// LipTrackCalculator.
+LipTraceFace ToLipTraceFace(const LipLandmarks& lip_landmarks,
+                            const Detection& detection);
+LipLandmarks ToLipLandmarks(const LipTraceFace& face);
+Detection ToDetection(const LipTraceFace& face);
+
+// Options of a synthetic trace: faces laid out on a grid which jitter from
+// frame to frame. One face at a time talks, i.e. opens and closes the
+// mouth, and the speaker changes every speaker_frames frames. The other
+// faces keep their mouths slightly open.
+struct SyntheticLipTraceOptions {
+  int num_faces = 1;
+  int num_frames = 3000;
+  int frame_width = 1280;
+  int frame_height = 720;
+  int64 frame_duration_us = 33333;
+  int speaker_frames = 90;
+  // A shot boundary every shot_frames frames, or none if 0.
+  int shot_frames = 300;
+  uint32 seed = 0;
+};
+
+// Writes a synthetic trace.
+::mediapipe::Status WriteSyntheticLipTrace(
+    const SyntheticLipTraceOptions& options, const std::string& path);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIP_TRACE_H_
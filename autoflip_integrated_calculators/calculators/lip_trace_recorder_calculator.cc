@@ -0,0 +1,157 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_trace.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// The inputs of LipTrackCalculator, with the same tags.
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputLandmark[] = "LANDMARKS";
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
+constexpr char kInputDetection[] = "DETECTIONS";
+constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+// Path of the lip trace to write.
+constexpr char kTracePath[] = "TRACE_PATH";
+
+// This calculator records the inputs of LipTrackCalculator in a lip trace
+// (see lip_trace.h), so that the speaker logic can be replayed and
+// benchmarked without running the face mesh, e.g. with
+// lip_track_replay_benchmark. Only the lip landmarks of the face meshes and
+// the face boxes are kept, which is all LipTrackCalculator reads. The video
+// frames are only used for their dimensions.
+//
+// Example:
+//    calculator: "LipTraceRecorderCalculator"
+//    input_stream: "VIDEO:input_video"
+//    input_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+//    input_stream: "DETECTIONS:face_detections"
+//    input_stream: "SHOT_BOUNDARIES:shot_change"
+//    input_side_packet: "TRACE_PATH:lip_trace_path"
+class LipTraceRecorderCalculator : public CalculatorBase {
+ public:
+  LipTraceRecorderCalculator() {}
+  ~LipTraceRecorderCalculator() override {}
+  LipTraceRecorderCalculator(const LipTraceRecorderCalculator&) = delete;
+  LipTraceRecorderCalculator& operator=(const LipTraceRecorderCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  LipTraceWriter writer_;
+  bool has_frame_size_ = false;
+  std::vector<LipLandmarks> lip_landmarks_;
+  std::vector<Detection> detections_;
+};
+REGISTER_CALCULATOR(LipTraceRecorderCalculator);
+
+::mediapipe::Status LipTraceRecorderCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputVideo).Set<ImageFrame>();
+  RET_CHECK(cc->Inputs().HasTag(kInputLandmark) !=
+            cc->Inputs().HasTag(kInputLipLandmark))
+      << "One of LANDMARKS and LIP_LANDMARKS is needed.";
+  if (cc->Inputs().HasTag(kInputLandmark)) {
+    cc->Inputs().Tag(kInputLandmark).Set<std::vector<NormalizedLandmarkList>>();
+  }
+  if (cc->Inputs().HasTag(kInputLipLandmark)) {
+    cc->Inputs().Tag(kInputLipLandmark).Set<std::vector<LipLandmarks>>();
+  }
+  cc->Inputs().Tag(kInputDetection).Set<std::vector<Detection>>();
+  if (cc->Inputs().HasTag(kInputShotBoundaries)) {
+    cc->Inputs().Tag(kInputShotBoundaries).Set<bool>();
+  }
+  cc->InputSidePackets().Tag(kTracePath).Set<std::string>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipTraceRecorderCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  // The frame dimensions are set with the first frame.
+  return writer_.Open(cc->InputSidePackets().Tag(kTracePath).Get<std::string>(),
+                      0, 0);
+}
+
+::mediapipe::Status LipTraceRecorderCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  const bool has_video = !cc->Inputs().Tag(kInputVideo).IsEmpty();
+  if (has_video && !has_frame_size_) {
+    const auto& frame = cc->Inputs().Tag(kInputVideo).Get<ImageFrame>();
+    writer_.SetFrameSize(frame.Width(), frame.Height());
+    has_frame_size_ = true;
+  }
+
+  // As in LipTrackCalculator, a frame only has faces if it has both the
+  // landmarks and the detections, one per face.
+  lip_landmarks_.clear();
+  detections_.clear();
+  const char* landmark_tag =
+      cc->Inputs().HasTag(kInputLipLandmark) ? kInputLipLandmark : kInputLandmark;
+  if (has_video && !cc->Inputs().Tag(landmark_tag).IsEmpty() &&
+      !cc->Inputs().Tag(kInputDetection).IsEmpty()) {
+    const auto& detections =
+        cc->Inputs().Tag(kInputDetection).Get<std::vector<Detection>>();
+    if (cc->Inputs().HasTag(kInputLipLandmark)) {
+      lip_landmarks_ =
+          cc->Inputs().Tag(kInputLipLandmark).Get<std::vector<LipLandmarks>>();
+    } else {
+      for (const auto& landmark_list :
+           cc->Inputs()
+               .Tag(kInputLandmark)
+               .Get<std::vector<NormalizedLandmarkList>>()) {
+        lip_landmarks_.push_back(ExtractLipLandmarks(landmark_list));
+      }
+    }
+    if (lip_landmarks_.size() == detections.size()) {
+      detections_ = detections;
+    } else {
+      lip_landmarks_.clear();
+    }
+  }
+
+  bool shot_boundary = false;
+  const bool has_shot_boundary =
+      cc->Inputs().HasTag(kInputShotBoundaries) &&
+      !cc->Inputs().Tag(kInputShotBoundaries).IsEmpty();
+  if (has_shot_boundary) {
+    shot_boundary = cc->Inputs().Tag(kInputShotBoundaries).Get<bool>();
+  }
+  return writer_.AddFrame(cc->InputTimestamp().Value(), lip_landmarks_,
+                          detections_,
+                          has_shot_boundary ? &shot_boundary : nullptr,
+                          has_video);
+}
+
+::mediapipe::Status LipTraceRecorderCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  return writer_.Close();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,122 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_trace.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/landmark.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputLandmark[] = "LANDMARKS";
+constexpr char kInputDetection[] = "DETECTIONS";
+constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+constexpr char kTracePath[] = "TRACE_PATH";
+
+const char kConfig[] = R"(
+    calculator: "LipTraceRecorderCalculator"
+    input_stream: "VIDEO:input_video"
+    input_stream: "LANDMARKS:multi_face_landmarks"
+    input_stream: "DETECTIONS:face_detections"
+    input_stream: "SHOT_BOUNDARIES:shot_change"
+    input_side_packet: "TRACE_PATH:lip_trace_path"
+    )";
+
+Detection CreateFace(const float xmin, const float ymin, const float width,
+                     const float height) {
+  Detection face;
+  LocationData* location_data = face.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(xmin);
+  bbox->set_ymin(ymin);
+  bbox->set_width(width);
+  bbox->set_height(height);
+  return face;
+}
+
+// A face mesh whose landmark i is at (i / 1000, 0.5, 0).
+NormalizedLandmarkList CreateFaceMesh() {
+  NormalizedLandmarkList landmark_list;
+  for (int i = 0; i < kFaceMeshLandmarks; ++i) {
+    auto* landmark = landmark_list.add_landmark();
+    landmark->set_x(i / 1000.0f);
+    landmark->set_y(0.5f);
+    landmark->set_z(0.0f);
+  }
+  return landmark_list;
+}
+
+TEST(LipTraceRecorderCalculatorTest, RecordsTheInputs) {
+  const std::string path = ::testing::TempDir() + "/recorded_lip_trace";
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner.MutableSidePackets()->Tag(kTracePath) = MakePacket<std::string>(path);
+  auto* inputs = runner.MutableInputs();
+  for (int i = 0; i < 3; ++i) {
+    inputs->Tag(kInputVideo).packets.push_back(
+        Adopt(new ImageFrame(ImageFormat::SRGB, 320, 240))
+            .At(Timestamp(i * 1000)));
+  }
+  // The first frame has a face, the second one has no face mesh, and the
+  // last one is a shot boundary.
+  inputs->Tag(kInputLandmark).packets.push_back(
+      Adopt(new std::vector<NormalizedLandmarkList>({CreateFaceMesh()}))
+          .At(Timestamp(0)));
+  for (int i = 0; i < 2; ++i) {
+    inputs->Tag(kInputDetection).packets.push_back(
+        Adopt(new std::vector<Detection>({CreateFace(0.1, 0.2, 0.3, 0.4)}))
+            .At(Timestamp(i * 1000)));
+  }
+  inputs->Tag(kInputShotBoundaries).packets.push_back(
+      Adopt(new bool(true)).At(Timestamp(2000)));
+  MP_ASSERT_OK(runner.Run());
+
+  LipTrace trace;
+  MP_ASSERT_OK(trace.Open(path));
+  EXPECT_EQ(320, trace.frame_width());
+  EXPECT_EQ(240, trace.frame_height());
+  ASSERT_EQ(3, trace.num_frames());
+  ASSERT_EQ(1, trace.frame(0).num_faces);
+  const LipTraceFace& face = trace.faces(trace.frame(0))[0];
+  EXPECT_FLOAT_EQ(0.1, face.xmin);
+  EXPECT_FLOAT_EQ(0.4, face.height);
+  EXPECT_TRUE(face.valid);
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    EXPECT_FLOAT_EQ(kLipLandmarkIdx[i] / 1000.0f, face.x[i]);
+  }
+  EXPECT_EQ(0, trace.frame(1).num_faces);
+  EXPECT_EQ(kLipTraceHasVideo, trace.frame(1).flags);
+  EXPECT_EQ(kLipTraceHasVideo | kLipTraceHasShotBoundary | kLipTraceShotBoundary,
+            trace.frame(2).flags);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
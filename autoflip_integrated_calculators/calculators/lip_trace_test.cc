@@ -0,0 +1,167 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_trace.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+Detection CreateFace(const float xmin, const float ymin, const float width,
+                     const float height) {
+  Detection face;
+  LocationData* location_data = face.mutable_location_data();
+  location_data->set_format(LocationData::RELATIVE_BOUNDING_BOX);
+  auto* bbox = location_data->mutable_relative_bounding_box();
+  bbox->set_xmin(xmin);
+  bbox->set_ymin(ymin);
+  bbox->set_width(width);
+  bbox->set_height(height);
+  return face;
+}
+
+LipLandmarks CreateLips(float offset) {
+  LipLandmarks lips;
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    lips.x[i] = offset + 0.01f * i;
+    lips.y[i] = offset + 0.02f * i;
+    lips.z[i] = offset + 0.03f * i;
+  }
+  lips.valid = true;
+  return lips;
+}
+
+TEST(LipTraceTest, WriteAndRead) {
+  const std::string path = ::testing::TempDir() + "/lip_trace_write_and_read";
+  LipTraceWriter writer;
+  MP_ASSERT_OK(writer.Open(path, 0, 0));
+  writer.SetFrameSize(640, 480);
+  const bool shot_boundary = true;
+  MP_ASSERT_OK(writer.AddFrame(
+      1000, {CreateLips(0.1f), CreateLips(0.2f)},
+      {CreateFace(0.1, 0.2, 0.3, 0.4), CreateFace(0.5, 0.2, 0.3, 0.4)},
+      nullptr));
+  MP_ASSERT_OK(writer.AddFrame(2000, {}, {}, &shot_boundary));
+  MP_ASSERT_OK(writer.AddFrame(3000, {CreateLips(0.3f)},
+                               {CreateFace(0.6, 0.2, 0.3, 0.4)}, nullptr,
+                               /* has_video = */ false));
+  MP_ASSERT_OK(writer.Close());
+
+  LipTrace trace;
+  MP_ASSERT_OK(trace.Open(path));
+  EXPECT_EQ(640, trace.frame_width());
+  EXPECT_EQ(480, trace.frame_height());
+  ASSERT_EQ(3, trace.num_frames());
+
+  const LipTraceFrame& frame_0 = trace.frame(0);
+  EXPECT_EQ(1000, frame_0.timestamp);
+  EXPECT_EQ(kLipTraceHasVideo, frame_0.flags);
+  ASSERT_EQ(2, frame_0.num_faces);
+  const LipTraceFace* faces = trace.faces(frame_0);
+  const Detection detection = ToDetection(faces[1]);
+  const auto& bbox = detection.location_data().relative_bounding_box();
+  EXPECT_FLOAT_EQ(0.5, bbox.xmin());
+  EXPECT_FLOAT_EQ(0.2, bbox.ymin());
+  EXPECT_FLOAT_EQ(0.3, bbox.width());
+  EXPECT_FLOAT_EQ(0.4, bbox.height());
+  const LipLandmarks lips = ToLipLandmarks(faces[1]);
+  const LipLandmarks expected = CreateLips(0.2f);
+  EXPECT_TRUE(lips.valid);
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    EXPECT_EQ(expected.x[i], lips.x[i]);
+    EXPECT_EQ(expected.y[i], lips.y[i]);
+    EXPECT_EQ(expected.z[i], lips.z[i]);
+  }
+
+  EXPECT_EQ(0, trace.frame(1).num_faces);
+  EXPECT_EQ(kLipTraceHasVideo | kLipTraceHasShotBoundary | kLipTraceShotBoundary,
+            trace.frame(1).flags);
+  EXPECT_EQ(1, trace.frame(2).num_faces);
+  EXPECT_EQ(0, trace.frame(2).flags);
+  EXPECT_FLOAT_EQ(0.6, trace.faces(trace.frame(2))[0].xmin);
+}
+
+TEST(LipTraceTest, RejectsTruncatedTrace) {
+  const std::string path = ::testing::TempDir() + "/lip_trace_truncated";
+  LipTraceWriter writer;
+  MP_ASSERT_OK(writer.Open(path, 640, 480));
+  MP_ASSERT_OK(writer.AddFrame(1000, {CreateLips(0.1f)},
+                               {CreateFace(0.1, 0.2, 0.3, 0.4)}, nullptr));
+  MP_ASSERT_OK(writer.Close());
+  ASSERT_EQ(0, truncate(path.c_str(), sizeof(LipTraceHeader) + 8));
+
+  LipTrace trace;
+  EXPECT_FALSE(trace.Open(path).ok());
+  EXPECT_FALSE(trace.Open(::testing::TempDir() + "/lip_trace_missing").ok());
+}
+
+// The synthetic faces are on a grid, and only the speaker opens the mouth.
+TEST(LipTraceTest, SyntheticTrace) {
+  const std::string path = ::testing::TempDir() + "/lip_trace_synthetic";
+  SyntheticLipTraceOptions options;
+  options.num_faces = 30;
+  options.num_frames = 20;
+  options.speaker_frames = 10;
+  options.shot_frames = 15;
+  MP_ASSERT_OK(WriteSyntheticLipTrace(options, path));
+
+  LipTrace trace;
+  MP_ASSERT_OK(trace.Open(path));
+  ASSERT_EQ(options.num_frames, trace.num_frames());
+  LipGeometry geometry;
+  std::vector<float> inner, outer;
+  float max_speaker_ratio[2] = {0, 0};
+  for (int i = 0; i < trace.num_frames(); ++i) {
+    const LipTraceFrame& frame = trace.frame(i);
+    EXPECT_EQ(i * options.frame_duration_us, frame.timestamp);
+    EXPECT_EQ(i == options.shot_frames, (frame.flags & kLipTraceShotBoundary) != 0);
+    ASSERT_EQ(options.num_faces, frame.num_faces);
+    std::vector<LipLandmarks> lips;
+    for (int face = 0; face < frame.num_faces; ++face) {
+      lips.push_back(ToLipLandmarks(trace.faces(frame)[face]));
+    }
+    geometry.Gather(lips);
+    geometry.ComputeRatios(options.frame_width, options.frame_height, &inner,
+                           &outer);
+    const int speaker = i / options.speaker_frames;
+    max_speaker_ratio[speaker] =
+        std::max(max_speaker_ratio[speaker], inner[speaker]);
+    for (int face = 0; face < frame.num_faces; ++face) {
+      if (face != speaker) {
+        EXPECT_NEAR(0.03f, inner[face], 1e-4);
+      }
+      // The outer lips are wider and higher than the inner ones.
+      EXPECT_GT(outer[face], inner[face]);
+    }
+  }
+  EXPECT_NEAR(0.55f, max_speaker_ratio[0], 1e-3);
+  EXPECT_NEAR(0.55f, max_speaker_ratio[1], 1e-3);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
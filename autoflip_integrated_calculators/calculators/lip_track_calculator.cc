@@ -16,10 +16,21 @@
 #include <algorithm>
 #include <memory>
 #include <cmath>
+#include <thread>
+#include <vector>
 
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/face_association.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/frame_render_queue.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/lip_track_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_segment.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/track_table.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/deps/threadpool.h"
 #include "mediapipe/framework/formats/detection.pb.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/landmark.pb.h"
@@ -37,8 +48,14 @@ namespace autoflip {
 
 constexpr char kInputVideo[] = "VIDEO";
 constexpr char kInputLandmark[] = "LANDMARKS";
+// The lip landmarks of the faces, which LipLandmarksCalculator extracts
+// from the face meshes. Either LANDMARKS or LIP_LANDMARKS is used.
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
 constexpr char kInputDetection[] = "DETECTIONS";
 constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+// (Optional) The motion of the mouths measured at the full frame rate by
+// MouthMotionCalculator, one value per face of LIP_LANDMARKS.
+constexpr char kInputMouthMotion[] = "MOUTH_MOTION";
 constexpr char kOutputROI[] = "DETECTIONS_SPEAKERS";
 
 // Output the shot boundary signal to change the camera quicily.
@@ -48,56 +65,212 @@ constexpr char kOutputROI[] = "DETECTIONS_SPEAKERS";
 // speaker.
 constexpr char kOutputShot[] = "IS_SPEAKER_CHANGE";
 
+// (Optional) The same signal as a ShotSegment per speaker shot, at the
+// timestamp of its first frame, once the next speaker change or the end of
+// the stream ends it. Its timestamp bound follows the start of the current
+// shot, so a consumer which is synchronized with SEGMENT waits for each shot
+// to end. IS_SPEAKER_CHANGE may be left unconnected.
+constexpr char kOutputSegment[] = "SEGMENT";
+
 // (Optional) Output the frame with face mesh landmarks, as well
 // as visualization of lip contour and related information.
 constexpr char kOutputContour[] = "CONTOUR_INFORMATION_FRAME";
 
-// Lip contour landmarks.
-// Inner lip conrner
-const int32 kLipLeftInnerCornerIdx = 78;
-const int32 kLipRightInnerCornerIdx = 308;
-// Inner upper lip landmarks
-const std::vector<int32> kLipInnerUpperIdx{82, 13, 312};
-// Inner lower lip landmarks
-const std::vector<int32> kLipInnerLowerIdx{87, 14, 317};
-// Inner lip contour
-const std::vector<int32> kLipInnerContourIdx{78, 82, 13, 312, 308, 317, 14, 87};
-// Outer lip conrner
-const int32 kLipLeftOuterCornerIdx = 61;
-const int32 kLipRightOuterCornerIdx = 291;
-// Outer upper lip landmarks
-const std::vector<int32> kLipOuterUpperIdx{37, 0, 267};
-// Outer lower lip landmarks
-const std::vector<int32> kLipOuterLowerIdx{84, 17, 314};
-// Outer lip contour
-const std::vector<int32> kLipOuterContourIdx{61, 37, 0, 267, 291, 84, 17, 314};
-
-// Landmarks size
-const int32 kFaceMeshLandmarks = 468;
+// (Optional) Output a LipTrackSceneStats per processed scene with the
+// buffer, tracking and timing counters of the scene.
+constexpr char kOutputStats[] = "STATS";
+
+// (Optional) Side packets to resume the speaker tracking of a previous run,
+// e.g. of the previous chunk of a long video, and to export it when the
+// calculator closes. Both are LipTrackState.
+constexpr char kInputState[] = "INITIAL_STATE";
+constexpr char kOutputState[] = "STATE";
 
 const cv::Scalar kRed = cv::Scalar(255.0, 0.0, 0.0); // active speaker bbox    
 const cv::Scalar kGreen = cv::Scalar(0.0, 255.0, 0.0); // input contour, bbox
 const cv::Scalar kBlue = cv::Scalar(0.0, 0.0, 255.0);  // landmarks
 const cv::Scalar kWhite = cv::Scalar(255.0, 255.0, 255.0);  // infor
 
+// Smallest number of frames worth a thread of their own when the lip
+// statistics of a scene are computed in parallel.
+constexpr int kMinFramesPerStatisticsThread = 8;
+
+// Fixed-capacity ring buffer of the lip statistics of one face track. The
+// mean and the variance of the window are updated in O(1) per value with a
+// sliding-window Welford update, and the storage is only allocated when the
+// window is sized in Reset().
+class LipStatisticsWindow {
+ public:
+  // Sizes the window and drops all values.
+  void Reset(int capacity, int mean_history) {
+    values_.assign(std::max(capacity, 1), 0.0f);
+    mean_history_ = std::max(mean_history, 1);
+    Clear();
+  }
+
+  // Drops all values and keeps the storage.
+  void Clear() {
+    head_ = 0;
+    size_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    recent_sum_ = 0.0;
+  }
+
+  // Appends a value, evicting the oldest one if the window is full.
+  void Push(float value) {
+    const int capacity = values_.size();
+    // The value leaving the most recent mean_history values.
+    if (size_ >= mean_history_) {
+      recent_sum_ -= At(size_ - mean_history_);
+    }
+    recent_sum_ += value;
+
+    if (size_ < capacity) {
+      values_[(head_ + size_) % capacity] = value;
+      ++size_;
+      const double delta = value - mean_;
+      mean_ += delta / size_;
+      m2_ += delta * (value - mean_);
+    } else {
+      const float evicted = values_[head_];
+      values_[head_] = value;
+      head_ = (head_ + 1) % capacity;
+      const double pre_mean = mean_;
+      mean_ += (static_cast<double>(value) - evicted) / size_;
+      m2_ += (static_cast<double>(value) - evicted) *
+             (value - mean_ + evicted - pre_mean);
+      // Guards against the rounding error of the update.
+      m2_ = std::max(m2_, 0.0);
+    }
+  }
+
+  int size() const { return size_; }
+
+  // Mean of the most recent mean_history values. If there are fewer values,
+  // the oldest value is used.
+  float RecentMean() const {
+    if (size_ < mean_history_) return At(0);
+    return recent_sum_ / mean_history_;
+  }
+
+  // Variance of all the values in the window.
+  float Variance() const { return size_ == 0 ? 0.0f : m2_ / size_; }
+
+ private:
+  // Returns the i_th oldest value.
+  float At(int i) const { return values_[(head_ + i) % values_.size()]; }
+
+  std::vector<float> values_;
+  int mean_history_ = 1;
+  // Position of the oldest value.
+  int head_ = 0;
+  int size_ = 0;
+  // Running statistics of the window.
+  double mean_ = 0.0;
+  double m2_ = 0.0;
+  double recent_sum_ = 0.0;
+};
+
+// Inner and outer lip statistics of one face track, and the mouth motion
+// when MOUTH_MOTION is connected.
+struct LipTrackStatistics {
+  LipStatisticsWindow inner;
+  LipStatisticsWindow outer;
+  LipStatisticsWindow motion;
+};
+
+// Wall time counters of a scene for the STATS output.
+struct LipTrackSceneCounters {
+  int64 statistics_ns = 0;
+  int64 matching_ns = 0;
+  int64 emission_ns = 0;
+};
+
+// Adds its lifetime to a counter. With a null counter, the clock is not
+// read at all, so the timers cost nothing when STATS is unconnected.
+class ScopedSceneTimer {
+ public:
+  explicit ScopedSceneTimer(int64* counter_ns)
+    : counter_ns_(counter_ns),
+      start_ns_(counter_ns ? absl::GetCurrentTimeNanos() : 0) {}
+  ~ScopedSceneTimer() {
+    if (counter_ns_) *counter_ns_ += absl::GetCurrentTimeNanos() - start_ns_;
+  }
+
+ private:
+  int64* counter_ns_;
+  int64 start_ns_;
+};
+
 struct LipSignal {
-  std::vector<NormalizedLandmarkList> landmark_lists;
+  // Only the lip landmarks of the faces are kept.
+  std::vector<LipLandmarks> lip_landmarks;
   std::vector<Detection> detections;
-  cv::Mat frame;
+  // Mouth motion of the faces, empty without MOUTH_MOTION.
+  std::vector<float> mouth_motion;
+  // Inner and outer lip ratios of the faces. They only depend on the frame,
+  // so they are computed once, possibly in parallel with other frames.
+  std::vector<float> statistics_inner;
+  std::vector<float> statistics_outer;
+  bool has_statistics = false;
+  // Reference-counted handle to the input frame. It is only kept when the
+  // visualization output is connected, and it is empty otherwise.
+  Packet frame_packet;
   int64 timestamp;
 };
 
 // This calculator tracks the lip motion based on face mesh landmarks and detects
 // active speakers in the images. Lip contour is obtained from face mesh. The output
 // is speakers' face bound boxes. 
+//
+// By default the frames are buffered and output once per scene, i.e. when a
+// shot boundary arrives or min_speaker_span is reached. In streaming_mode,
+// every frame is output as soon as look_ahead_frames later frames are
+// analyzed, with a dominate speaker estimate which is revised as the scene
+// goes on.
+//
+// With async_scene_processing, a scene is analyzed on a worker thread while
+// the frames of the next scene are buffered, and its outputs are emitted by
+// a later Process() or by Close(), in timestamp order. At most one scene is
+// analyzed at a time. The lip ratios of the frames of a scene are computed
+// in parallel on statistics_threads threads, and only the matching of the
+// faces from one frame to the next is sequential. The worker threads are
+// started in Open() and live as long as the calculator. Both are off by
+// default, since the graph may already run other calculators in parallel.
+//
+// The lip statistics of the face mesh are only as frequent as the mesh,
+// which may run at a low frame rate. MOUTH_MOTION adds the motion of the
+// mouths measured at the full frame rate by MouthMotionCalculator: a face
+// whose mouth is still is not a speaker, whatever its lip statistics, and a
+// face whose mouth moves the most is a speaker before its lip statistics
+// span variance_history frames. Speaker turns are then followed within a
+// few frames of the face mesh instead of variance_history frames.
+//
+// The speaker tracking state that carries over across scenes can be
+// exported on the STATE output side packet and imported from the
+// INITIAL_STATE input side packet, so that a long video can be processed in
+// chunks. With output_start_timestamp, the chunk starts with an overlap with
+// the previous chunk: the overlap frames only warm up the face tracks, and
+// the speaker found in the overlap is reconciled with the imported one, so
+// that the seam does not add a speaker change.
+//
+// The speaker changes can also be output as a ShotSegment per speaker shot
+// on SEGMENT, which is one packet per shot instead of one bool per frame in
+// streaming_mode.
 // Example:
 //    calculator: "LipTrackCalculator"
 //    input_stream: "VIDEO:input_video"
-//    input_stream: "LANDMARKS:multi_face_landmarks"
+//    input_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
 //    input_stream: "DETECTIONS:face_detections"
+//    input_stream: "MOUTH_MOTION:mouth_motion"
 //    output_stream: "DETECTIONS_SPEAKERS:active_speakers_detections"
 //    output_stream: "IS_SPEAKER_CHANGE:speaker_change"
+//    output_stream: "SEGMENT:speaker_segment"
 //    output_stream: "CONTOUR_INFORMATION_FRAME:contour_information_frames"
+//    output_stream: "STATS:lip_track_stats"
+//    input_side_packet: "INITIAL_STATE:previous_chunk_state"
+//    output_side_packet: "STATE:chunk_state"
 //    options:{
 //      [mediapipe.autoflip.LipTrackCalculatorOptions.ext]: {
 //        output_shot_boundary: true
@@ -107,7 +280,7 @@ struct LipSignal {
 class LipTrackCalculator : public CalculatorBase {
  public:
   LipTrackCalculator();
-  ~LipTrackCalculator() override {}
+  ~LipTrackCalculator() override;
   LipTrackCalculator(const LipTrackCalculator&) = delete;
   LipTrackCalculator& operator=(const LipTrackCalculator&) = delete;
 
@@ -117,62 +290,142 @@ class LipTrackCalculator : public CalculatorBase {
   ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
 
  private:
-  // Obtain lip statistics from face landmarks
-  ::mediapipe::Status GetStatistics(
-    const std::vector<NormalizedLandmarkList>& landmark_lists, 
-    int lip_left_corner, int lip_right_corner, const std::vector<int32>& lip_upper,
-    const std::vector<int32>& lip_lower, std::vector<float>* lip_statistics); 
-  // Find match face from last frame. If not find, return -1, otherwise
-  // return the face index.
-  int MatchFace(const Detection& face_bbox);
   // Convert Detection to opencv Rect
   cv::Rect2f DetectionToRect(const Detection& bbox);
   // Determine whether the face is active speaker or not.
-  ::mediapipe::Status IsActiveSpeaker(const std::deque<float>& face_lip_statistics_inner, 
-                    const std::deque<float>& face_lip_statistics_outer, bool* is_speaker);
-  // Calculator the absolute Euclidean distance between two landmarks.
-  float GetDistance(const NormalizedLandmark& mark_1, const NormalizedLandmark& mark_2);
+  ::mediapipe::Status IsActiveSpeaker(const LipTrackStatistics& face_lip_statistics,
+                    bool* is_speaker);
   // Calculator IOU of two face bboxes.
   float GetIOU(const Detection& bbox_1, const Detection& bbox_2);
-  void GetMeanAndVariance(const std::deque<float>& face_lip_statistics,
-                float* mean, float* variance); 
+  // Returns the index of an unused LipTrackStatistics in track_statistics_.
+  int AcquireTrackStatistics();
+  // Releases all the LipTrackStatistics for reuse.
+  void ResetTrackStatistics();
   // Convert landmark to cv point2f.
-  cv::Point2f LandmarkToPoint(const int idx, const NormalizedLandmarkList& landmark_list);
+  cv::Point2f LandmarkToPoint(const int idx, const LipLandmarks& lip_landmarks);
   // Draws and outputs visualization frames if those streams are present.
+  // With a render queue, the frame is drawn on the render thread and output
+  // by a later EmitRenderedVizFrames().
   ::mediapipe::Status OutputVizFrames(
-                const std::vector<NormalizedLandmarkList>& input_landmark_lists,
+                const std::vector<LipLandmarks>& input_lip_landmarks,
                 const std::vector<Detection>& detected_bbox,
                 const std::vector<Detection>& active_speaker_bbox, 
-                const cv::Mat& scene_frame, CalculatorContext* cc, int64 timestamp);
+                const Packet& frame_packet, CalculatorContext* cc, int64 timestamp);
+  // Draws a visualization frame. It only reads the frame dimensions of the
+  // calculator, so it is safe to call from the render thread.
+  ::mediapipe::Status RenderVizFrame(
+                const std::vector<LipLandmarks>& input_lip_landmarks,
+                const std::vector<Detection>& detected_bbox,
+                const std::vector<Detection>& active_speaker_bbox,
+                const Packet& frame_packet, std::unique_ptr<ImageFrame>* viz_frame);
+  // Outputs the visualization frames the render thread has finished.
+  void EmitRenderedVizFrames(CalculatorContext* cc);
+  // Outputs the counters of the buffered scene if STATS is connected.
+  void OutputSceneStats(CalculatorContext* cc);
+  // Returns the counter to time into, or null when STATS is unconnected.
+  int64* SceneCounter(int64* counter_ns) {
+    return output_stats_ ? counter_ns : nullptr;
+  }
   ::mediapipe::Status DrawLandMarksAndInfor(
-      const std::vector<NormalizedLandmarkList>& landmark_lists,
+      const std::vector<LipLandmarks>& lip_landmarks,
       const cv::Scalar& landmark_color, 
       const cv::Scalar& contour_color, cv::Mat* viz_mat);
   ::mediapipe::Status DrawBBox(const std::vector<Detection>& bboxes,
                const bool detected, const cv::Scalar& color, cv::Mat* viz_mat);  
   void Transmit(mediapipe::CalculatorContext* cc, bool is_speaker_change, int64 timestamp);
   ::mediapipe::Status ProcessScene(bool is_end_of_scene, ::mediapipe::CalculatorContext* cc);
+  // Analyzes the frames of signal_buff_ which are not analyzed yet, and
+  // finds the dominate speaker of the scene. It does not touch the
+  // calculator context, so it may run on the scene worker.
+  ::mediapipe::Status AnalyzeScene();
+  // Outputs the analyzed scene. scene_timestamp is the input timestamp at
+  // which the scene ended.
+  ::mediapipe::Status EmitScene(bool is_end_of_scene, Timestamp scene_timestamp,
+                                ::mediapipe::CalculatorContext* cc);
+  // Starts AnalyzeScene() on the scene worker. The next frames are buffered
+  // in next_signal_buff_ until the scene is emitted.
+  void StartSceneAnalysis(bool is_end_of_scene, Timestamp scene_timestamp);
+  // Emits the scene analyzed on the scene worker, if any, and makes
+  // next_signal_buff_ the current buffer. If wait is false, it returns
+  // right away when the analysis is not done.
+  ::mediapipe::Status FinishSceneAnalysis(bool wait, ::mediapipe::CalculatorContext* cc);
+  // Buffer in which the input frames are added.
+  std::vector<LipSignal>& InputBuffer() {
+    return scene_in_flight_ ? next_signal_buff_ : signal_buff_;
+  }
+  // Computes the lip ratios of the frames in [begin, end) of signal_buff_,
+  // in parallel when there are enough frames.
+  void ComputeSceneStatistics(int begin, int end);
+  // Computes the lip ratios of the faces of a frame.
+  void ComputeFrameStatistics(LipGeometry* lip_geometry, LipSignal* signal) const;
+  // Updates the face tracks and the speaker votes with the frame at
+  // buff_position of signal_buff_.
+  ::mediapipe::Status AnalyzeFrame(int buff_position);
+  // Clears the buffered signals and the per scene tracking state.
+  void ResetScene();
+  // Streaming mode: outputs the frames before end_position which are not
+  // output yet, with the current dominate speaker estimate.
+  ::mediapipe::Status EmitStreamingFrames(int end_position, ::mediapipe::CalculatorContext* cc);
+  // Streaming mode: outputs the remaining frames and starts a new scene.
+  ::mediapipe::Status FlushStreamingScene(bool is_end_of_scene, ::mediapipe::CalculatorContext* cc);
+  // Warm-up: analyzes the buffered frames and only updates the speaker
+  // history with them, without any output.
+  ::mediapipe::Status WarmUpScene(bool is_end_of_scene);
+  // Ends the warm-up and reconciles its speaker with the imported state.
+  // is_end_of_scene is true when the first output frame is a shot boundary.
+  ::mediapipe::Status FinishWarmUp(bool is_end_of_scene);
+  // Restores and saves the state carried over across scenes.
+  void ImportState(const LipTrackState& state);
+  void ExportState(LipTrackState* state);
 
   // Calculator options.
   LipTrackCalculatorOptions options_;
-  // Face bounding boxes in last frame.
-  std::vector<Detection> face_bbox_;
-  // Face statistics in previous frames.
-  std::map<int32, std::deque<float>> face_statistics_outer_;
-  std::map<int32, std::deque<float>> face_statistics_inner_;
+  // Matches the faces to the faces in last frame.
+  FaceAssociation face_association_;
+  // Pool of lip statistics windows, reused across frames and scenes so that
+  // no window is allocated once the pool has grown to the peak face count.
+  std::vector<LipTrackStatistics> track_statistics_;
+  std::vector<int32> free_track_statistics_;
+  // The indices are the face ids in the last frame, and values are the
+  // indices of their statistics in track_statistics_.
+  std::vector<int32> face_statistics_ids_;
+  // Per frame scratch buffers.
+  std::vector<int32> cur_face_statistics_ids_;
+  std::vector<int32> previous_face_ids_;
+  std::vector<int32> cur_meta_face_indices_;
+  // Packed lip landmarks of the faces in the frame being analyzed, and of
+  // the other statistics threads.
+  LipGeometry lip_geometry_;
+  std::vector<LipGeometry> thread_lip_geometries_;
+  int statistics_threads_ = 1;
+  // Computes the lip ratios of the frame ranges but the first one, which
+  // the analyzing thread computes itself. Null with one statistics thread.
+  std::unique_ptr<ThreadPool> statistics_pool_;
   // The indices are the face ids in the frame, and values
   // are the corresponding meta face ids. 
   std::vector<int32> meta_face_indices_;
+  // Meta faces of the scene. Track ids are the meta face ids, and
+  // frames are positions in signal_buff_. Each meta face also counts
+  // the times that it is detected as active speakers.
+  TrackTable meta_faces_;
+  // Number of frames in signal_buff_ which are analyzed and output.
+  int num_analyzed_frames_ = 0;
+  int num_emitted_frames_ = 0;
+  // Streaming mode: the last output speaker detection.
+  std::vector<Detection> streaming_speaker_detection_;
   // Active speaker information.
   float speaker_mean_inner_ = 0;
   float speaker_variance_inner_ = 0;
   float speaker_mean_outer_ = 0;
   float speaker_variance_outer_ = 0;
+  float speaker_motion_ = 0;
   // For speaker shot.
   int pre_dominate_speaker_id_ = -1;
   std::vector<Detection> pre_dominate_speaker_detection_;
   // Last time a speaker shot was detected.
   Timestamp last_shot_timestamp_;
+  // The speaker shots of the SEGMENT output.
+  ShotSegmentBuilder segment_builder_{ShotSegment::SPEAKER_CHANGE};
   // Last time the sence is processed.
   Timestamp last_sence_processed_timestamp_;
   // Dimensions of video frame.
@@ -181,32 +434,91 @@ class LipTrackCalculator : public CalculatorBase {
   ImageFormat::Format frame_format_ = ImageFormat::UNKNOWN;
   // Store the input signals.
   std::vector<LipSignal> signal_buff_;
+  // Asynchronous scene processing: the scene of signal_buff_ is analyzed on
+  // the single thread of scene_pool_ while the next frames fill
+  // next_signal_buff_. Null without async_scene_processing.
+  std::vector<LipSignal> next_signal_buff_;
+  bool scene_in_flight_ = false;
+  bool scene_in_flight_end_of_scene_ = false;
+  Timestamp scene_in_flight_timestamp_;
+  std::unique_ptr<ThreadPool> scene_pool_;
+  absl::Mutex scene_mutex_;
+  bool scene_analyzed_ ABSL_GUARDED_BY(scene_mutex_) = false;
+  ::mediapipe::Status scene_status_ ABSL_GUARDED_BY(scene_mutex_);
+  // Dominate speaker found by AnalyzeScene().
+  int32 scene_dominate_speaker_id_ = -1;
   bool pre_stop_by_scene_change_;
+  // Timestamp of the last input frame.
+  int64 last_frame_timestamp_ = 0;
+  // Whether the frames are only used to warm up, before
+  // output_start_timestamp.
+  bool warm_up_ = false;
+  // State imported from INITIAL_STATE, reconciled after the warm-up.
+  bool has_initial_state_ = false;
+  LipTrackState initial_state_;
+  // Renders the visualization frames off the calculator thread. Null when
+  // CONTOUR_INFORMATION_FRAME is unconnected or visualization_queue_size is 0.
+  std::unique_ptr<FrameRenderQueue> viz_render_queue_;
+  std::vector<FrameRenderQueue::RenderedFrame> rendered_viz_frames_;
+  // Whether STATS is connected, and the counters of the current scene.
+  bool output_stats_ = false;
+  // Whether IS_SPEAKER_CHANGE or SEGMENT is output.
+  bool output_speaker_changes_ = false;
+  LipTrackSceneCounters scene_counters_;
 }; // end with inheritance
 
 REGISTER_CALCULATOR(LipTrackCalculator);
 
 LipTrackCalculator::LipTrackCalculator() {}
 
+LipTrackCalculator::~LipTrackCalculator() {
+  // Close() normally waits for the scene analysis, but not if the graph
+  // failed before. The scene analysis uses the statistics pool, so it is
+  // finished first.
+  scene_pool_.reset();
+  statistics_pool_.reset();
+}
+
 ::mediapipe::Status LipTrackCalculator::GetContract(
     mediapipe::CalculatorContract* cc) {
   cc->Inputs().Tag(kInputVideo).Set<ImageFrame>();
+  RET_CHECK(!(cc->Inputs().HasTag(kInputLandmark)
+    && cc->Inputs().HasTag(kInputLipLandmark)))
+    << "Only one of LANDMARKS and LIP_LANDMARKS can be used.";
   if (cc->Inputs().HasTag(kInputLandmark)) {
     cc->Inputs().Tag(kInputLandmark).Set<std::vector<NormalizedLandmarkList>>();
   }
+  if (cc->Inputs().HasTag(kInputLipLandmark)) {
+    cc->Inputs().Tag(kInputLipLandmark).Set<std::vector<LipLandmarks>>();
+  }
   if (cc->Inputs().HasTag(kInputDetection)) {
     cc->Inputs().Tag(kInputDetection).Set<std::vector<Detection>>();
   }
   if (cc->Inputs().HasTag(kInputShotBoundaries)) {
     cc->Inputs().Tag(kInputShotBoundaries).Set<bool>();
   }
+  if (cc->Inputs().HasTag(kInputMouthMotion)) {
+    cc->Inputs().Tag(kInputMouthMotion).Set<std::vector<float>>();
+  }
   cc->Outputs().Tag(kOutputROI).Set<std::vector<Detection>>();
   if (cc->Outputs().HasTag(kOutputShot)) {
     cc->Outputs().Tag(kOutputShot).Set<bool>();
   }
+  if (cc->Outputs().HasTag(kOutputSegment)) {
+    cc->Outputs().Tag(kOutputSegment).Set<ShotSegment>();
+  }
   if (cc->Outputs().HasTag(kOutputContour)) {
     cc->Outputs().Tag(kOutputContour).Set<ImageFrame>();
   }
+  if (cc->Outputs().HasTag(kOutputStats)) {
+    cc->Outputs().Tag(kOutputStats).Set<LipTrackSceneStats>();
+  }
+  if (cc->InputSidePackets().HasTag(kInputState)) {
+    cc->InputSidePackets().Tag(kInputState).Set<LipTrackState>();
+  }
+  if (cc->OutputSidePackets().HasTag(kOutputState)) {
+    cc->OutputSidePackets().Tag(kOutputState).Set<LipTrackState>();
+  }
 
   return ::mediapipe::OkStatus();
 }
@@ -214,29 +526,84 @@ LipTrackCalculator::LipTrackCalculator() {}
 ::mediapipe::Status LipTrackCalculator::Open(
     mediapipe::CalculatorContext* cc) {
   options_ = cc->Options<LipTrackCalculatorOptions>();
+  RET_CHECK_GE(options_.look_ahead_frames(), 0)
+    << "Negative look_ahead_frames is not allowed.";
+  face_association_.set_iou_threshold(options_.iou_threshold());
+  output_stats_ = cc->Outputs().HasTag(kOutputStats);
+  output_speaker_changes_ =
+    options_.output_shot_boundary() &&
+    (cc->Outputs().HasTag(kOutputShot) || cc->Outputs().HasTag(kOutputSegment));
   last_shot_timestamp_ = Timestamp(0);
   last_sence_processed_timestamp_ = Timestamp(0);
   pre_dominate_speaker_id_ = -1;
   pre_stop_by_scene_change_ = false;
+  RET_CHECK_GE(options_.visualization_queue_size(), 0)
+    << "Negative visualization_queue_size is not allowed.";
+  RET_CHECK_GE(options_.statistics_threads(), 0)
+    << "Negative statistics_threads is not allowed.";
+  statistics_threads_ = options_.statistics_threads();
+  if (statistics_threads_ == 0) {
+    statistics_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+  thread_lip_geometries_.resize(statistics_threads_ - 1);
+  if (statistics_threads_ > 1) {
+    statistics_pool_ = absl::make_unique<ThreadPool>("lip_track_statistics",
+                                                     statistics_threads_ - 1);
+    statistics_pool_->StartWorkers();
+  }
+  if (options_.async_scene_processing() && !options_.streaming_mode()) {
+    scene_pool_ = absl::make_unique<ThreadPool>("lip_track_scene", 1);
+    scene_pool_->StartWorkers();
+  }
+  if (cc->Outputs().HasTag(kOutputContour) && options_.visualization_queue_size() > 0) {
+    viz_render_queue_ =
+      absl::make_unique<FrameRenderQueue>(options_.visualization_queue_size());
+  }
+  if (cc->InputSidePackets().HasTag(kInputState)) {
+    has_initial_state_ = true;
+    initial_state_ = cc->InputSidePackets().Tag(kInputState).Get<LipTrackState>();
+  }
+  // Without warm-up, the run simply resumes from the imported state.
+  warm_up_ = options_.has_output_start_timestamp();
+  if (has_initial_state_ && !warm_up_) {
+    ImportState(initial_state_);
+  }
 
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status LipTrackCalculator::Process(
     mediapipe::CalculatorContext* cc) {
+  EmitRenderedVizFrames(cc);
+  // Outputs the scene analyzed on the scene worker as soon as it is done.
+  MP_RETURN_IF_ERROR(FinishSceneAnalysis(/* wait = */ false, cc));
   // Processes a scene when shot boundary or time period is larger than min_speaker_span.
   bool is_end_of_scene = false;
   if (cc->Inputs().HasTag(kInputShotBoundaries) &&
       !cc->Inputs().Tag(kInputShotBoundaries).Value().IsEmpty()) {
     is_end_of_scene = cc->Inputs().Tag(kInputShotBoundaries).Get<bool>();
   }
+  if (warm_up_ && cc->InputTimestamp().Value() >= options_.output_start_timestamp()) {
+    MP_RETURN_IF_ERROR(FinishWarmUp(is_end_of_scene));
+  }
 
-
-  bool process_scene = !signal_buff_.empty() 
-    && (cc->InputTimestamp().Value() - signal_buff_[0].timestamp) >= options_.min_speaker_span()
-    || (!signal_buff_.empty() && is_end_of_scene);
+  const auto& input_buff = InputBuffer();
+  bool process_scene = !input_buff.empty() 
+    && (cc->InputTimestamp().Value() - input_buff[0].timestamp) >= options_.min_speaker_span()
+    || (!input_buff.empty() && is_end_of_scene);
   if (process_scene) {
-    MP_RETURN_IF_ERROR(ProcessScene(is_end_of_scene, cc));
+    if (warm_up_) {
+      MP_RETURN_IF_ERROR(WarmUpScene(is_end_of_scene));
+    } else if (options_.streaming_mode()) {
+      MP_RETURN_IF_ERROR(FlushStreamingScene(is_end_of_scene, cc));
+    } else if (options_.async_scene_processing()) {
+      // Double buffering: the previous scene has to be emitted before this
+      // one is analyzed.
+      MP_RETURN_IF_ERROR(FinishSceneAnalysis(/* wait = */ true, cc));
+      StartSceneAnalysis(is_end_of_scene, cc->InputTimestamp());
+    } else {
+      MP_RETURN_IF_ERROR(ProcessScene(is_end_of_scene, cc));
+    }
   }
 
   if (!cc->Inputs().Tag(kInputVideo).Value().IsEmpty()) {
@@ -250,16 +617,48 @@ LipTrackCalculator::LipTrackCalculator() {}
       frame_format_ = frame.Format();
     }
     LipSignal signal;
-    mediapipe::formats::MatView(&frame).copyTo(signal.frame);
+    // Holds the frame packet instead of copying the frame. The frame is only
+    // needed to render the visualization output.
+    if (cc->Outputs().HasTag(kOutputContour)) {
+      signal.frame_packet = cc->Inputs().Tag(kInputVideo).Value();
+    }
     signal.timestamp = cc->InputTimestamp().Value();
-
-    if (!cc->Inputs().Tag(kInputLandmark).Value().IsEmpty() && !cc->Inputs().Tag(kInputDetection).Value().IsEmpty()) {
-      signal.landmark_lists = 
-            cc->Inputs().Tag(kInputLandmark).Get<std::vector<NormalizedLandmarkList>>();
+    last_frame_timestamp_ = signal.timestamp;
+
+    const bool use_lip_landmarks = cc->Inputs().HasTag(kInputLipLandmark);
+    const char* landmark_tag = use_lip_landmarks ? kInputLipLandmark : kInputLandmark;
+    if (cc->Inputs().HasTag(landmark_tag) && cc->Inputs().HasTag(kInputDetection)
+      && !cc->Inputs().Tag(landmark_tag).IsEmpty()
+      && !cc->Inputs().Tag(kInputDetection).IsEmpty()) {
+      if (use_lip_landmarks) {
+        signal.lip_landmarks =
+              cc->Inputs().Tag(kInputLipLandmark).Get<std::vector<LipLandmarks>>();
+      } else {
+        // Only the lip landmarks of the face meshes are buffered.
+        const auto& landmark_lists =
+              cc->Inputs().Tag(kInputLandmark).Get<std::vector<NormalizedLandmarkList>>();
+        signal.lip_landmarks.reserve(landmark_lists.size());
+        for (const auto& landmark_list : landmark_lists) {
+          signal.lip_landmarks.push_back(ExtractLipLandmarks(landmark_list));
+        }
+      }
       signal.detections =
             cc->Inputs().Tag(kInputDetection).Get<std::vector<Detection>>(); 
+      if (cc->Inputs().HasTag(kInputMouthMotion)
+        && !cc->Inputs().Tag(kInputMouthMotion).IsEmpty()) {
+        signal.mouth_motion =
+              cc->Inputs().Tag(kInputMouthMotion).Get<std::vector<float>>();
+      }
+    }
+    InputBuffer().push_back(std::move(signal));
+
+    // In streaming mode, the frame is analyzed right away, and the frames
+    // that have enough look-ahead are emitted.
+    if (options_.streaming_mode() && !warm_up_) {
+      MP_RETURN_IF_ERROR(AnalyzeFrame(signal_buff_.size() - 1));
+      MP_RETURN_IF_ERROR(EmitStreamingFrames(
+        signal_buff_.size() - options_.look_ahead_frames(), cc));
     }
-    signal_buff_.push_back(signal);
   }
 
   return ::mediapipe::OkStatus();
@@ -267,140 +666,254 @@ LipTrackCalculator::LipTrackCalculator() {}
 
 ::mediapipe::Status LipTrackCalculator::Close(
     ::mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(FinishSceneAnalysis(/* wait = */ true, cc));
+  // The input ended within the warm-up.
+  if (warm_up_) {
+    MP_RETURN_IF_ERROR(FinishWarmUp(/* is_end_of_scene = */ false));
+  }
   if (!signal_buff_.empty()) {
-    MP_RETURN_IF_ERROR(ProcessScene(/* is_end_of_scene = */ false, cc));
+    if (options_.streaming_mode()) {
+      MP_RETURN_IF_ERROR(FlushStreamingScene(/* is_end_of_scene = */ false, cc));
+    } else {
+      MP_RETURN_IF_ERROR(ProcessScene(/* is_end_of_scene = */ false, cc));
+    }
+  }
+  ShotSegment segment;
+  if (cc->Outputs().HasTag(kOutputSegment) &&
+      segment_builder_.Finish(
+          segment_builder_.last_timestamp().NextAllowedInStream(), &segment)) {
+    cc->Outputs().Tag(kOutputSegment).AddPacket(
+        MakePacket<ShotSegment>(segment).At(
+            Timestamp(segment.start_timestamp_us())));
+  }
+  if (cc->OutputSidePackets().HasTag(kOutputState)) {
+    auto state = absl::make_unique<LipTrackState>();
+    ExportState(state.get());
+    cc->OutputSidePackets().Tag(kOutputState).Set(Adopt(state.release()));
   }
   pre_dominate_speaker_detection_.clear();
-  face_statistics_inner_.clear();
-  face_statistics_outer_.clear();
-  meta_face_indices_.clear();
+  ResetScene();
+  if (viz_render_queue_) {
+    viz_render_queue_->Flush();
+    EmitRenderedVizFrames(cc);
+    if (viz_render_queue_->num_dropped() > 0) {
+      LOG(WARNING) << viz_render_queue_->num_dropped()
+                   << " visualization frames are dropped.";
+    }
+    viz_render_queue_.reset();
+  }
 
   return ::mediapipe::OkStatus();
 }
 
-::mediapipe::Status LipTrackCalculator::ProcessScene(
-    bool is_end_of_scene, ::mediapipe::CalculatorContext* cc) {
-  // meta_faces: key is the meta face id, value is a vector
-  // whose size equals to the current signal_buff_ size. The
-  // i_th value in the vector is the face id in the i_th frame. 
-  // If a speaker does not appear in a frame, the value is -1.
-  std::map<int32, std::vector<int32>> meta_faces;
-  int meta_face_count = 0;
-  // num_of_active_speaker: key is the meta face id, value is
-  // the times that this meta face id is detected as active speakers.
-  std::map<int32, int32> num_of_active_speaker;
-
-  // Get the speaker for each frame.
-  for (int buff_position = 0; buff_position < signal_buff_.size(); ++buff_position){
-    const auto& signal = signal_buff_[buff_position];
-    const auto& input_landmark_lists = signal.landmark_lists;
-    const auto& input_detections = signal.detections;
+::mediapipe::Status LipTrackCalculator::AnalyzeFrame(int buff_position) {
+  auto& signal = signal_buff_[buff_position];
+  const auto& input_lip_landmarks = signal.lip_landmarks;
+  const auto& input_detections = signal.detections;
+  // The mouth motion is only used if it has a value per face.
+  const bool has_mouth_motion =
+    signal.mouth_motion.size() == input_detections.size();
+  num_analyzed_frames_ = buff_position + 1;
+
+  if (input_lip_landmarks.empty() || input_detections.empty()
+    || input_detections.size() != input_lip_landmarks.size()) 
+    return ::mediapipe::OkStatus();
 
-    if (input_landmark_lists.empty() || input_detections.empty()
-      || input_detections.size() != input_landmark_lists.size()) 
-      continue;
-  
-    std::map<int32, std::deque<float>> cur_face_statistics_inner;
-    std::map<int32, std::deque<float>> cur_face_statistics_outer;
-    std::vector<int32> cur_meta_face_indices;
-    std::vector<float> statistics_inner, statistics_outer;
+  cur_face_statistics_ids_.clear();
+  previous_face_ids_.clear();
+  cur_meta_face_indices_.clear();
 
-    MP_RETURN_IF_ERROR(GetStatistics(input_landmark_lists, kLipLeftInnerCornerIdx, kLipRightInnerCornerIdx,
-    kLipInnerUpperIdx, kLipInnerLowerIdx, &statistics_inner));
-    MP_RETURN_IF_ERROR(GetStatistics(input_landmark_lists, kLipLeftOuterCornerIdx, kLipRightOuterCornerIdx,
-    kLipOuterUpperIdx, kLipOuterLowerIdx, &statistics_outer));
+  if (!signal.has_statistics) {
+    ScopedSceneTimer timer(SceneCounter(&scene_counters_.statistics_ns));
+    ComputeFrameStatistics(&lip_geometry_, &signal);
+  }
 
-    int cur_speaker_id = -1;
+  {
+    ScopedSceneTimer timer(SceneCounter(&scene_counters_.matching_ns));
+    // Check whether the faces appeared before. Each face in last frame is
+    // matched to at most one face, which takes over its statistics.
+    face_association_.Match(input_detections, &previous_face_ids_);
     for (int cur_face_idx = 0; cur_face_idx < input_detections.size(); ++cur_face_idx) {
-      auto& bbox = input_detections[cur_face_idx];
-      // Check whether the face appeared before
-      int previous_face_idx = MatchFace(bbox);
-      cur_face_statistics_inner.insert(std::pair< int32, std::deque<float> >(cur_face_idx, std::deque<float>()));
-      cur_face_statistics_outer.insert(std::pair< int32, std::deque<float> >(cur_face_idx, std::deque<float>()));
-      // If the face appeared, add the new data to the previous deque and update meta_faces.
+      int previous_face_idx = previous_face_ids_[cur_face_idx];
+      int statistics_id = -1;
       if (previous_face_idx != -1) {
-        // Add previous statistics.
-        for (auto& value : face_statistics_inner_[previous_face_idx]) {
-          cur_face_statistics_inner[cur_face_idx].push_back(value);
-        }
-        for (auto& value : face_statistics_outer_[previous_face_idx]) {
-          cur_face_statistics_outer[cur_face_idx].push_back(value);
-        }
-        // Add new statistics.
-        cur_face_statistics_inner[cur_face_idx].push_back(statistics_inner[cur_face_idx]);
-        while (cur_face_statistics_inner[cur_face_idx].size() > options_.variance_history()) {
-          cur_face_statistics_inner[cur_face_idx].pop_front();
-        }
-        cur_face_statistics_outer[cur_face_idx].push_back(statistics_outer[cur_face_idx]);
-        while (cur_face_statistics_outer[cur_face_idx].size() > options_.variance_history()) {
-          cur_face_statistics_outer[cur_face_idx].pop_front();
-        }
-        // Update meta_faces
-        int meta_face_idx = meta_face_indices_[previous_face_idx];
-        meta_faces[meta_face_idx][buff_position] = cur_face_idx;
-        cur_meta_face_indices.push_back(meta_face_idx);
-      }
-      // If the face did not appear, add the new data and update meta_faces.
-      else {
-        // Add new statistics.
-        cur_face_statistics_inner[cur_face_idx].push_back(statistics_inner[cur_face_idx]);
-        cur_face_statistics_outer[cur_face_idx].push_back(statistics_outer[cur_face_idx]);
-        // Update meta_faces
-        meta_faces.insert(std::pair< int32, std::vector<int32> >(meta_face_count, std::vector<int32>()));
-        for (int i = 0; i < signal_buff_.size(); ++i) {
-          meta_faces[meta_face_count].push_back(-1);
-        }
-        meta_faces[meta_face_count][buff_position] = cur_face_idx;
-        cur_meta_face_indices.push_back(meta_face_count);
-        meta_face_count ++;
+        statistics_id = face_statistics_ids_[previous_face_idx];
+        face_statistics_ids_[previous_face_idx] = -1;
+      } else {
+        statistics_id = AcquireTrackStatistics();
       }
-      bool is_active_speaker;
-      MP_RETURN_IF_ERROR(IsActiveSpeaker(cur_face_statistics_inner[cur_face_idx], 
-      cur_face_statistics_outer[cur_face_idx], &is_active_speaker));
-
-      if (is_active_speaker)
-        cur_speaker_id = cur_face_idx;
-    } // end cur_face_idx
-      
-    if (cur_speaker_id != -1) {
-      int meta_face = cur_meta_face_indices[cur_speaker_id];
-      if (num_of_active_speaker.find(meta_face) != num_of_active_speaker.end()) {
-        num_of_active_speaker[meta_face]++;
+      cur_face_statistics_ids_.push_back(statistics_id);
+    }
+    // Statistics of the faces that disappeared are released.
+    for (auto statistics_id : face_statistics_ids_) {
+      if (statistics_id != -1) {
+        free_track_statistics_.push_back(statistics_id);
       }
-      else {
-        num_of_active_speaker.insert(std::pair< int32, int32 >(meta_face, 1));
+    }
+  }
+
+  // The statistics windows and the speaker tests.
+  ScopedSceneTimer timer(SceneCounter(&scene_counters_.statistics_ns));
+  int cur_speaker_id = -1;
+  for (int cur_face_idx = 0; cur_face_idx < input_detections.size(); ++cur_face_idx) {
+    int previous_face_idx = previous_face_ids_[cur_face_idx];
+    auto& face_statistics = track_statistics_[cur_face_statistics_ids_[cur_face_idx]];
+    // Add new statistics. A face whose lips are unknown in this frame
+    // keeps its statistics.
+    if (input_lip_landmarks[cur_face_idx].valid) {
+      face_statistics.inner.Push(signal.statistics_inner[cur_face_idx]);
+      face_statistics.outer.Push(signal.statistics_outer[cur_face_idx]);
+    }
+    // Negative motion is unknown.
+    if (has_mouth_motion && signal.mouth_motion[cur_face_idx] >= 0) {
+      face_statistics.motion.Push(signal.mouth_motion[cur_face_idx]);
+    }
+    // If the face appeared, it continues its meta face. Otherwise, add a
+    // new meta face.
+    int meta_face_idx = previous_face_idx != -1
+      ? meta_face_indices_[previous_face_idx] : meta_faces_.AddTrack();
+    meta_faces_.Add(meta_face_idx, buff_position, cur_face_idx);
+    cur_meta_face_indices_.push_back(meta_face_idx);
+
+    bool is_active_speaker;
+    MP_RETURN_IF_ERROR(IsActiveSpeaker(face_statistics, &is_active_speaker));
+
+    if (is_active_speaker)
+      cur_speaker_id = cur_face_idx;
+  } // end cur_face_idx
+    
+  if (cur_speaker_id != -1) {
+    meta_faces_.Vote(cur_meta_face_indices_[cur_speaker_id]);
+  }
+
+  // Update the history
+  face_statistics_ids_.swap(cur_face_statistics_ids_);
+  speaker_mean_inner_ = 0;
+  speaker_variance_inner_ = 0;
+  speaker_mean_outer_ = 0;
+  speaker_variance_outer_ = 0;
+  speaker_motion_ = 0;
+  meta_face_indices_.swap(cur_meta_face_indices_);
+
+  return ::mediapipe::OkStatus();
+}
+
+void LipTrackCalculator::ResetScene() {
+  signal_buff_.clear();
+  face_association_.Reset();
+  ResetTrackStatistics();
+  meta_face_indices_.clear();
+  meta_faces_.Clear();
+  num_analyzed_frames_ = 0;
+  num_emitted_frames_ = 0;
+}
+
+void LipTrackCalculator::ComputeFrameStatistics(
+    LipGeometry* lip_geometry, LipSignal* signal) const {
+  // Lip statistics of all the faces and both lip contours in one pass.
+  lip_geometry->Gather(signal->lip_landmarks);
+  lip_geometry->ComputeRatios(frame_width_, frame_height_,
+                              &signal->statistics_inner, &signal->statistics_outer);
+  signal->has_statistics = true;
+}
+
+void LipTrackCalculator::ComputeSceneStatistics(int begin, int end) {
+  ScopedSceneTimer timer(SceneCounter(&scene_counters_.statistics_ns));
+  const int num_threads = std::max(1, std::min(statistics_threads_,
+    (end - begin) / kMinFramesPerStatisticsThread));
+  // The frames are split in contiguous ranges, one per thread. The first
+  // range is computed on this thread.
+  auto compute_range = [this, begin, end, num_threads](int thread, LipGeometry* lip_geometry) {
+    const int range_end = begin + (end - begin) * (thread + 1) / num_threads;
+    for (int i = begin + (end - begin) * thread / num_threads; i < range_end; ++i) {
+      if (!signal_buff_[i].lip_landmarks.empty()) {
+        ComputeFrameStatistics(lip_geometry, &signal_buff_[i]);
       }
     }
+  };
+  absl::BlockingCounter ranges_done(num_threads - 1);
+  for (int thread = 1; thread < num_threads; ++thread) {
+    statistics_pool_->Schedule([&compute_range, &ranges_done, thread, this] {
+      compute_range(thread, &thread_lip_geometries_[thread - 1]);
+      ranges_done.DecrementCount();
+    });
+  }
+  compute_range(0, &lip_geometry_);
+  ranges_done.Wait();
+}
 
-    // Update the history
-    face_bbox_ = input_detections;
-    face_statistics_inner_ = cur_face_statistics_inner;
-    face_statistics_outer_ = cur_face_statistics_outer;
-    speaker_mean_inner_ = 0;
-    speaker_variance_inner_ = 0;
-    speaker_mean_outer_ = 0;
-    speaker_variance_outer_ = 0;
-    meta_face_indices_ = cur_meta_face_indices;
-  } // end buff_position
+::mediapipe::Status LipTrackCalculator::AnalyzeScene() {
+  ComputeSceneStatistics(num_analyzed_frames_, signal_buff_.size());
+  // Get the speaker for each frame. The face tracks follow the frames in
+  // order.
+  for (int buff_position = num_analyzed_frames_; buff_position < signal_buff_.size(); ++buff_position){
+    MP_RETURN_IF_ERROR(AnalyzeFrame(buff_position));
+  }
 
   // Find the dominate speaker in the period.
-  int32 dominate_speaker_id = -1;
-  int32 max_num = 0;
-  for (auto it = num_of_active_speaker.begin(); it != num_of_active_speaker.end(); ++it){
-    if (it->second > max_num) {
-      dominate_speaker_id = it->first;
-      max_num = it->second ;
+  scene_dominate_speaker_id_ = meta_faces_.MostVoted();
+  return ::mediapipe::OkStatus();
+}
+
+void LipTrackCalculator::StartSceneAnalysis(bool is_end_of_scene,
+                                            Timestamp scene_timestamp) {
+  scene_in_flight_ = true;
+  scene_in_flight_end_of_scene_ = is_end_of_scene;
+  scene_in_flight_timestamp_ = scene_timestamp;
+  {
+    absl::MutexLock lock(&scene_mutex_);
+    scene_analyzed_ = false;
+  }
+  scene_pool_->Schedule([this] {
+    const ::mediapipe::Status status = AnalyzeScene();
+    absl::MutexLock lock(&scene_mutex_);
+    scene_status_ = status;
+    scene_analyzed_ = true;
+  });
+}
+
+::mediapipe::Status LipTrackCalculator::FinishSceneAnalysis(
+    bool wait, ::mediapipe::CalculatorContext* cc) {
+  if (!scene_in_flight_) {
+    return ::mediapipe::OkStatus();
+  }
+  ::mediapipe::Status status;
+  {
+    absl::MutexLock lock(&scene_mutex_);
+    if (!wait && !scene_analyzed_) {
+      return ::mediapipe::OkStatus();
     }
+    scene_mutex_.Await(absl::Condition(&scene_analyzed_));
+    status = scene_status_;
   }
+  scene_in_flight_ = false;
+  MP_RETURN_IF_ERROR(status);
+  MP_RETURN_IF_ERROR(EmitScene(scene_in_flight_end_of_scene_,
+                               scene_in_flight_timestamp_, cc));
+  // The frames buffered meanwhile are the next scene.
+  signal_buff_.swap(next_signal_buff_);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipTrackCalculator::ProcessScene(
+    bool is_end_of_scene, ::mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(AnalyzeScene());
+  return EmitScene(is_end_of_scene, cc->InputTimestamp(), cc);
+}
+
+::mediapipe::Status LipTrackCalculator::EmitScene(
+    bool is_end_of_scene, Timestamp scene_timestamp,
+    ::mediapipe::CalculatorContext* cc) {
+  int32 dominate_speaker_id = scene_dominate_speaker_id_;
 
   // No dominate speaker.
   if (dominate_speaker_id == -1) {
-    std::vector<NormalizedLandmarkList> empty_landmarklist;
+    std::vector<LipLandmarks> empty_lip_landmarks;
     // Output the shot boundary signal.
-    if (cc->Outputs().HasTag(kOutputShot) && options_.output_shot_boundary()) {
+    if (output_speaker_changes_) {
         if (is_end_of_scene) {
           Transmit(cc, false, signal_buff_[0].timestamp);
-          last_sence_processed_timestamp_ = cc->InputTimestamp();
+          last_sence_processed_timestamp_ = scene_timestamp;
           pre_stop_by_scene_change_ = true;
         }
         else {
@@ -410,31 +923,31 @@ LipTrackCalculator::LipTrackCalculator() {}
           else {
             Transmit(cc, false, signal_buff_[0].timestamp);
           }
-          last_sence_processed_timestamp_ = Timestamp(signal_buff_.end()->timestamp);
+          last_sence_processed_timestamp_ = Timestamp(signal_buff_.back().timestamp);
           pre_stop_by_scene_change_ = false;
         }
     }
 
-    for (int buff_position = 0; buff_position < signal_buff_.size(); ++buff_position) {
-      auto empty_detection = ::absl::make_unique<std::vector<Detection>>();
-      auto& signal = signal_buff_[buff_position];
-
-      // Optionally output the visualization frames of lit contour and related information.
-      if (cc->Outputs().HasTag(kOutputContour)) 
-        MP_RETURN_IF_ERROR(OutputVizFrames(empty_landmarklist, *empty_detection.get(),
-          *empty_detection.get(), signal.frame, cc, signal.timestamp));
-      
-      cc->Outputs().Tag(kOutputROI).Add(empty_detection.release(), Timestamp(signal.timestamp));
+    {
+      ScopedSceneTimer timer(SceneCounter(&scene_counters_.emission_ns));
+      for (int buff_position = 0; buff_position < signal_buff_.size(); ++buff_position) {
+        auto empty_detection = ::absl::make_unique<std::vector<Detection>>();
+        auto& signal = signal_buff_[buff_position];
+
+        // Optionally output the visualization frames of lit contour and related information.
+        if (cc->Outputs().HasTag(kOutputContour)) 
+          MP_RETURN_IF_ERROR(OutputVizFrames(empty_lip_landmarks, *empty_detection.get(),
+            *empty_detection.get(), signal.frame_packet, cc, signal.timestamp));
+        
+        cc->Outputs().Tag(kOutputROI).Add(empty_detection.release(), Timestamp(signal.timestamp));
+      }
     }
 
     //Update history
     pre_dominate_speaker_id_ = dominate_speaker_id;
     pre_dominate_speaker_detection_.clear();
-    signal_buff_.clear();
-    face_bbox_.clear();
-    face_statistics_inner_.clear();
-    face_statistics_outer_.clear();
-    meta_face_indices_.clear();
+    OutputSceneStats(cc);
+    ResetScene();
 
     return ::mediapipe::OkStatus();
   }
@@ -442,24 +955,19 @@ LipTrackCalculator::LipTrackCalculator() {}
   // Dominate speaker is detected.
   // Detetion in the closest frame. 
   std::vector<Detection> dominate_speaker_detection;
-  auto& dominate_speaker = meta_faces[dominate_speaker_id];
-  for (int i = 0; i < dominate_speaker.size(); ++i){
-    auto& face_id = dominate_speaker[i];
-    if (face_id != -1) { 
-      const auto& detection = signal_buff_[i].detections[face_id];
-      dominate_speaker_detection.push_back(detection);
-      break;
-    }
-  }
+  int dominate_speaker_run = meta_faces_.first_run(dominate_speaker_id);
+  const auto& first_run = meta_faces_.run(dominate_speaker_run);
+  dominate_speaker_detection.push_back(
+    signal_buff_[first_run.start].detections[first_run.face_id]);
 
   // Output the shot boundary signal.
-  if (cc->Outputs().HasTag(kOutputShot) && options_.output_shot_boundary()) {
+  if (output_speaker_changes_) {
     // Detect speakers in current frame and no speakers in previous frame.
     if (pre_dominate_speaker_id_ == -1) {
        if (is_end_of_scene) {
           Transmit(cc, true, signal_buff_[0].timestamp);
           last_shot_timestamp_ = Timestamp(signal_buff_[0].timestamp);
-          last_sence_processed_timestamp_ = cc->InputTimestamp();
+          last_sence_processed_timestamp_ = scene_timestamp;
           pre_stop_by_scene_change_ = true;
         }
         else {
@@ -470,7 +978,7 @@ LipTrackCalculator::LipTrackCalculator() {}
             Transmit(cc, true, signal_buff_[0].timestamp);
             last_shot_timestamp_ = Timestamp(signal_buff_[0].timestamp);
           }
-          last_sence_processed_timestamp_ = Timestamp(signal_buff_.end()->timestamp);
+          last_sence_processed_timestamp_ = Timestamp(signal_buff_.back().timestamp);
           pre_stop_by_scene_change_ = false;
         }
     }
@@ -482,7 +990,7 @@ LipTrackCalculator::LipTrackCalculator() {}
         if (is_end_of_scene) {
           Transmit(cc, true, signal_buff_[0].timestamp);
           last_shot_timestamp_ = Timestamp(signal_buff_[0].timestamp);
-          last_sence_processed_timestamp_ = cc->InputTimestamp();
+          last_sence_processed_timestamp_ = scene_timestamp;
           pre_stop_by_scene_change_ = true;
         }
         else if (is_speaker_change) {
@@ -493,7 +1001,7 @@ LipTrackCalculator::LipTrackCalculator() {}
             Transmit(cc, true, signal_buff_[0].timestamp);
             last_shot_timestamp_ = Timestamp(signal_buff_[0].timestamp);
           }
-          last_sence_processed_timestamp_ = Timestamp(signal_buff_.end()->timestamp);
+          last_sence_processed_timestamp_ = Timestamp(signal_buff_.back().timestamp);
           pre_stop_by_scene_change_ = false;
         }
       }
@@ -501,91 +1009,240 @@ LipTrackCalculator::LipTrackCalculator() {}
   }
 
   // Output ROI.
-  for (int buff_position = 0; buff_position < signal_buff_.size(); ++buff_position) {
-    auto& signal = signal_buff_[buff_position];
-    auto& landmark_lists = signal.landmark_lists;
-    auto& detections = signal.detections;
-    int face_id = dominate_speaker[buff_position];
-    auto output_detection = ::absl::make_unique<std::vector<Detection>>();
+  {
+    ScopedSceneTimer timer(SceneCounter(&scene_counters_.emission_ns));
+    for (int buff_position = 0; buff_position < signal_buff_.size(); ++buff_position) {
+      auto& signal = signal_buff_[buff_position];
+      auto& lip_landmarks = signal.lip_landmarks;
+      auto& detections = signal.detections;
+      // Walks the runs of the dominate speaker along the frames.
+      while (dominate_speaker_run != -1
+        && meta_faces_.run(dominate_speaker_run).end() <= buff_position) {
+        dominate_speaker_run = meta_faces_.run(dominate_speaker_run).next;
+      }
+      int face_id = -1;
+      if (dominate_speaker_run != -1
+        && meta_faces_.run(dominate_speaker_run).start <= buff_position) {
+        face_id = meta_faces_.run(dominate_speaker_run).face_id;
+      }
+      auto output_detection = ::absl::make_unique<std::vector<Detection>>();
+
+      // Dominate speaker apears in this frame
+      if (face_id != -1) {
+        output_detection->push_back(detections[face_id]);
+        // Optionally output the visualization frames of lit contour and related information.
+        if (cc->Outputs().HasTag(kOutputContour)) 
+          MP_RETURN_IF_ERROR(OutputVizFrames(lip_landmarks, detections, *output_detection.get(), signal.frame_packet, cc, signal.timestamp));
+        // Update dominate_speaker_detection.
+        dominate_speaker_detection[0] = detections[face_id];
+      }
+      else { // Dominate speaker does not appear in this frame
+        output_detection->push_back(dominate_speaker_detection[0]);
+        std::vector<LipLandmarks> empty_lip_landmarks;
+        std::vector<Detection> empty_detecton;
+        // Optionally output the visualization frames of lit contour and related information.
+        if (cc->Outputs().HasTag(kOutputContour)) 
+          MP_RETURN_IF_ERROR(OutputVizFrames(empty_lip_landmarks, 
+            empty_detecton, empty_detecton, signal.frame_packet, cc, signal.timestamp));
+      }
 
-    // Dominate speaker apears in this frame
-    if (face_id != -1) {
-      output_detection->push_back(detections[face_id]);
-      // Optionally output the visualization frames of lit contour and related information.
-      if (cc->Outputs().HasTag(kOutputContour)) 
-        MP_RETURN_IF_ERROR(OutputVizFrames(landmark_lists, detections, *output_detection.get(), signal.frame, cc, signal.timestamp));
-      // Update dominate_speaker_detection.
-      dominate_speaker_detection[0] = detections[face_id];
-    }
-    else { // Dominate speaker does not appear in this frame
-      output_detection->push_back(dominate_speaker_detection[0]);
-      std::vector<NormalizedLandmarkList> empty_landmarklist;
-      std::vector<Detection> empty_detecton;
-      // Optionally output the visualization frames of lit contour and related information.
-      if (cc->Outputs().HasTag(kOutputContour)) 
-        MP_RETURN_IF_ERROR(OutputVizFrames(empty_landmarklist, 
-          empty_detecton, empty_detecton, signal.frame, cc, signal.timestamp));
+      cc->Outputs().Tag(kOutputROI).Add(output_detection.release(), Timestamp(signal.timestamp));
     }
-
-    cc->Outputs().Tag(kOutputROI).Add(output_detection.release(), Timestamp(signal.timestamp));
   }
 
   //Update history
   pre_dominate_speaker_id_ = dominate_speaker_id;
   pre_dominate_speaker_detection_.clear();
   pre_dominate_speaker_detection_.push_back(dominate_speaker_detection[0]);
-  signal_buff_.clear();
-  face_bbox_.clear();
-  face_statistics_inner_.clear();
-  face_statistics_outer_.clear();
-  meta_face_indices_.clear();
+  OutputSceneStats(cc);
+  ResetScene();
 
   return ::mediapipe::OkStatus(); 
 } 
 
-float LipTrackCalculator::GetDistance(const NormalizedLandmark& mark_1,
-                                      const NormalizedLandmark& mark_2) {                            
-  return std::sqrt(std::pow((mark_1.x()-mark_2.x())*frame_width_, 2) 
-  + std::pow((mark_1.y()-mark_2.y())*frame_height_, 2)
-  + std::pow(mark_1.z()-mark_2.z(), 2));
+::mediapipe::Status LipTrackCalculator::EmitStreamingFrames(
+    int end_position, ::mediapipe::CalculatorContext* cc) {
+  ScopedSceneTimer timer(SceneCounter(&scene_counters_.emission_ns));
+  // The dominate speaker is revised with every analyzed frame.
+  const int32 dominate_speaker_id = meta_faces_.MostVoted();
+  for (; num_emitted_frames_ < end_position; ++num_emitted_frames_) {
+    const int buff_position = num_emitted_frames_;
+    const auto& signal = signal_buff_[buff_position];
+    auto output_detection = ::absl::make_unique<std::vector<Detection>>();
+    int face_id = -1;
+    if (dominate_speaker_id != -1) {
+      face_id = meta_faces_.FaceId(dominate_speaker_id, buff_position);
+      if (face_id != -1) {
+        output_detection->push_back(signal.detections[face_id]);
+      } else {
+        // Dominate speaker does not appear in this frame, use its detection
+        // in the closest analyzed frame.
+        int closest_position = -1, closest_face_id = -1;
+        if (meta_faces_.FindClosest(dominate_speaker_id, buff_position,
+                                    &closest_position, &closest_face_id)) {
+          output_detection->push_back(
+            signal_buff_[closest_position].detections[closest_face_id]);
+        }
+      }
+    } else if (!pre_dominate_speaker_detection_.empty()) {
+      // No speaker is found in this scene yet, keep the speaker of the
+      // previous scene.
+      output_detection->push_back(pre_dominate_speaker_detection_[0]);
+    }
+
+    // Output the speaker change signal.
+    if (output_speaker_changes_) {
+      bool is_speaker_change = false;
+      if (!output_detection->empty()) {
+        is_speaker_change = streaming_speaker_detection_.empty() ||
+          GetIOU(streaming_speaker_detection_[0], (*output_detection)[0]) <= options_.iou_threshold();
+      }
+      Transmit(cc, is_speaker_change, signal.timestamp);
+      if (is_speaker_change) {
+        last_shot_timestamp_ = Timestamp(signal.timestamp);
+      }
+    }
+    streaming_speaker_detection_ = *output_detection;
+
+    // Optionally output the visualization frames of lit contour and related information.
+    if (cc->Outputs().HasTag(kOutputContour)) {
+      if (face_id != -1) {
+        MP_RETURN_IF_ERROR(OutputVizFrames(signal.lip_landmarks, signal.detections,
+          *output_detection.get(), signal.frame_packet, cc, signal.timestamp));
+      } else {
+        std::vector<LipLandmarks> empty_lip_landmarks;
+        std::vector<Detection> empty_detecton;
+        MP_RETURN_IF_ERROR(OutputVizFrames(empty_lip_landmarks,
+          empty_detecton, empty_detecton, signal.frame_packet, cc, signal.timestamp));
+      }
+    }
+
+    cc->Outputs().Tag(kOutputROI).Add(output_detection.release(), Timestamp(signal.timestamp));
+  }
+  return ::mediapipe::OkStatus();
 }
 
-::mediapipe::Status LipTrackCalculator::GetStatistics(const std::vector<NormalizedLandmarkList>& landmark_lists, 
-                    int lip_left_corner, int lip_right_corner, const std::vector<int32>& lip_upper,
-                    const std::vector<int32>& lip_lower, std::vector<float>* lip_statistics) {
-  float mouth_width = 0.0f, mouth_height = 0.0f;
-  for (const auto& landmark_list : landmark_lists) {
-    if (landmark_list.landmark_size() < kFaceMeshLandmarks){
-      continue;
+::mediapipe::Status LipTrackCalculator::FlushStreamingScene(
+    bool is_end_of_scene, ::mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(EmitStreamingFrames(signal_buff_.size(), cc));
+
+  // The speaker is carried over to the next scene until a new speaker is
+  // found, unless the scene ends with a shot boundary.
+  const int32 dominate_speaker_id = meta_faces_.MostVoted();
+  pre_dominate_speaker_detection_.clear();
+  if (is_end_of_scene) {
+    streaming_speaker_detection_.clear();
+  } else if (dominate_speaker_id != -1) {
+    pre_dominate_speaker_detection_ = streaming_speaker_detection_;
+  }
+  pre_dominate_speaker_id_ = dominate_speaker_id;
+  OutputSceneStats(cc);
+  ResetScene();
+
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipTrackCalculator::WarmUpScene(bool is_end_of_scene) {
+  for (int buff_position = num_analyzed_frames_; buff_position < signal_buff_.size(); ++buff_position) {
+    MP_RETURN_IF_ERROR(AnalyzeFrame(buff_position));
+  }
+
+  // The speaker history is updated as ProcessScene() and
+  // FlushStreamingScene() do, with the detection of the dominate speaker in
+  // the last frame it appears.
+  const int32 dominate_speaker_id = meta_faces_.MostVoted();
+  pre_dominate_speaker_detection_.clear();
+  if (dominate_speaker_id != -1) {
+    int last_run = meta_faces_.first_run(dominate_speaker_id);
+    while (meta_faces_.run(last_run).next != -1) {
+      last_run = meta_faces_.run(last_run).next;
     }
-    mouth_width = GetDistance(landmark_list.landmark(lip_left_corner),
-                              landmark_list.landmark(lip_right_corner));
-    for (auto i = 0; i < lip_upper.size(); ++i) {
-      mouth_height += GetDistance(landmark_list.landmark(lip_upper[i]),
-                              landmark_list.landmark(lip_lower[i]));
+    const auto& run = meta_faces_.run(last_run);
+    pre_dominate_speaker_detection_.push_back(
+      signal_buff_[run.end() - 1].detections[run.face_id]);
+  }
+  if (options_.streaming_mode()) {
+    if (is_end_of_scene) {
+      pre_dominate_speaker_detection_.clear();
     }
-    // Average the height is better since it may need more points in the future.
-    mouth_height /= (float)lip_upper.size();
-    lip_statistics->push_back(mouth_height / mouth_width);
+    streaming_speaker_detection_ = pre_dominate_speaker_detection_;
   }
+  pre_dominate_speaker_id_ = dominate_speaker_id;
+  // The next scene starts after the warm-up, so its speaker change is
+  // not moved back into the warm-up.
+  last_sence_processed_timestamp_ = Timestamp(signal_buff_.back().timestamp);
+  pre_stop_by_scene_change_ = false;
+  scene_counters_ = LipTrackSceneCounters();
+  ResetScene();
 
   return ::mediapipe::OkStatus();
 }
 
-int LipTrackCalculator::MatchFace(const Detection& face_bbox) {
-  int32 idx = -1;
-  float iou = 0, maxi_iou = 0;
-  for (auto i = 0; i < face_bbox_.size(); ++i) {
-    auto& bbox = face_bbox_[i];
-    iou = GetIOU(bbox, face_bbox);
-    if (iou < options_.iou_threshold())
-      continue;
-    if (iou > maxi_iou) {
-      maxi_iou = iou;
-      idx = i;
+::mediapipe::Status LipTrackCalculator::FinishWarmUp(bool is_end_of_scene) {
+  if (!signal_buff_.empty()) {
+    MP_RETURN_IF_ERROR(WarmUpScene(is_end_of_scene));
+  }
+  warm_up_ = false;
+  if (!has_initial_state_) {
+    return ::mediapipe::OkStatus();
+  }
+
+  // The speaker of the previous chunk is kept when the warm-up finds no
+  // speaker or the same one, so that the seam is not a speaker change.
+  // Otherwise the speaker of the warm-up, which is closer, wins.
+  if (initial_state_.has_speaker_detection()) {
+    if (pre_dominate_speaker_detection_.empty()) {
+      pre_dominate_speaker_id_ = initial_state_.dominate_speaker_id();
+      pre_dominate_speaker_detection_.push_back(initial_state_.speaker_detection());
+    } else if (GetIOU(pre_dominate_speaker_detection_[0],
+                      initial_state_.speaker_detection()) > options_.iou_threshold()) {
+      pre_dominate_speaker_detection_[0] = initial_state_.speaker_detection();
     }
   }
-  return idx;
+  // In streaming mode, a shot boundary on the first output frame starts
+  // without speaker, as in FlushStreamingScene().
+  if (initial_state_.has_streaming_speaker_detection() && !is_end_of_scene) {
+    if (streaming_speaker_detection_.empty()) {
+      streaming_speaker_detection_.push_back(initial_state_.streaming_speaker_detection());
+    } else if (GetIOU(streaming_speaker_detection_[0],
+                      initial_state_.streaming_speaker_detection()) > options_.iou_threshold()) {
+      streaming_speaker_detection_[0] = initial_state_.streaming_speaker_detection();
+    }
+  }
+  // The warm-up outputs no speaker change, so the last one is still the one
+  // of the previous chunk.
+  last_shot_timestamp_ = Timestamp(initial_state_.last_shot_timestamp());
+
+  return ::mediapipe::OkStatus();
+}
+
+void LipTrackCalculator::ImportState(const LipTrackState& state) {
+  pre_dominate_speaker_id_ = state.dominate_speaker_id();
+  pre_dominate_speaker_detection_.clear();
+  if (state.has_speaker_detection()) {
+    pre_dominate_speaker_detection_.push_back(state.speaker_detection());
+  }
+  streaming_speaker_detection_.clear();
+  if (state.has_streaming_speaker_detection()) {
+    streaming_speaker_detection_.push_back(state.streaming_speaker_detection());
+  }
+  last_shot_timestamp_ = Timestamp(state.last_shot_timestamp());
+  last_sence_processed_timestamp_ = Timestamp(state.last_scene_processed_timestamp());
+  pre_stop_by_scene_change_ = state.stopped_by_scene_change();
+}
+
+void LipTrackCalculator::ExportState(LipTrackState* state) {
+  state->set_last_timestamp(last_frame_timestamp_);
+  state->set_dominate_speaker_id(pre_dominate_speaker_id_);
+  if (!pre_dominate_speaker_detection_.empty()) {
+    *state->mutable_speaker_detection() = pre_dominate_speaker_detection_[0];
+  }
+  if (!streaming_speaker_detection_.empty()) {
+    *state->mutable_streaming_speaker_detection() = streaming_speaker_detection_[0];
+  }
+  state->set_last_shot_timestamp(last_shot_timestamp_.Value());
+  state->set_last_scene_processed_timestamp(last_sence_processed_timestamp_.Value());
+  state->set_stopped_by_scene_change(pre_stop_by_scene_change_);
 }
 
 cv::Rect2f LipTrackCalculator::DetectionToRect(const Detection& bbox) {
@@ -608,45 +1265,79 @@ float LipTrackCalculator::GetIOU(const Detection& bbox_1, const Detection& bbox_
   return intersecting_region.area() / union_region.area();
 }
 
-void LipTrackCalculator::GetMeanAndVariance(const std::deque<float>& face_lip_statistics,
-                      float* mean, float* variance) {
-  *mean = 0.0f;
-  *variance = 0.0f;                      
-  if (face_lip_statistics.size() < options_.mean_history()) {
-    *mean = face_lip_statistics[0];
-  }
-  else {
-    for (int i = face_lip_statistics.size()-options_.mean_history(); i < face_lip_statistics.size(); ++i) {
-      *mean += face_lip_statistics[i];
+void LipTrackCalculator::OutputSceneStats(CalculatorContext* cc) {
+  if (!output_stats_ || signal_buff_.empty()) return;
+  auto stats = absl::make_unique<LipTrackSceneStats>();
+  stats->set_start_timestamp(signal_buff_.front().timestamp);
+  stats->set_end_timestamp(signal_buff_.back().timestamp);
+  stats->set_buffered_frames(signal_buff_.size());
+  int64 buffered_bytes = signal_buff_.capacity() * sizeof(LipSignal);
+  for (const auto& signal : signal_buff_) {
+    buffered_bytes += signal.lip_landmarks.capacity() * sizeof(LipLandmarks);
+    for (const auto& detection : signal.detections) {
+      buffered_bytes += detection.SpaceUsedLong();
     }
-    *mean /= (float)options_.mean_history();
+    buffered_bytes += (signal.mouth_motion.capacity() + signal.statistics_inner.capacity()
+      + signal.statistics_outer.capacity()) * sizeof(float);
+    stats->add_faces_per_frame(signal.detections.size());
+  }
+  stats->set_buffered_bytes(buffered_bytes);
+  stats->set_tracks_created(meta_faces_.num_tracks());
+  for (int track_id = 0; track_id < meta_faces_.num_tracks(); ++track_id) {
+    stats->add_speaker_votes(meta_faces_.votes(track_id));
+  }
+  stats->set_dominate_speaker(meta_faces_.MostVoted());
+  stats->set_statistics_time_us(scene_counters_.statistics_ns / 1000);
+  stats->set_matching_time_us(scene_counters_.matching_ns / 1000);
+  stats->set_emission_time_us(scene_counters_.emission_ns / 1000);
+  scene_counters_ = LipTrackSceneCounters();
+
+  cc->Outputs().Tag(kOutputStats).Add(stats.release(),
+                                      Timestamp(signal_buff_.back().timestamp));
+}
+
+int LipTrackCalculator::AcquireTrackStatistics() {
+  if (!free_track_statistics_.empty()) {
+    int statistics_id = free_track_statistics_.back();
+    free_track_statistics_.pop_back();
+    track_statistics_[statistics_id].inner.Clear();
+    track_statistics_[statistics_id].outer.Clear();
+    track_statistics_[statistics_id].motion.Clear();
+    return statistics_id;
+  }
+  track_statistics_.emplace_back();
+  auto& statistics = track_statistics_.back();
+  statistics.inner.Reset(options_.variance_history(), options_.mean_history());
+  statistics.outer.Reset(options_.variance_history(), options_.mean_history());
+  statistics.motion.Reset(options_.variance_history(), options_.mean_history());
+  return track_statistics_.size() - 1;
+}
+
+void LipTrackCalculator::ResetTrackStatistics() {
+  face_statistics_ids_.clear();
+  free_track_statistics_.clear();
+  for (int i = 0; i < track_statistics_.size(); ++i) {
+    free_track_statistics_.push_back(i);
   }
-  float mean_full = 0.0f;
-  for (auto& value : face_lip_statistics)
-    mean_full += value;
-  mean_full /= (float)face_lip_statistics.size();
-  for (auto& value : face_lip_statistics) 
-    *variance += std::pow(value - mean_full, 2);
-  *variance /= (float)face_lip_statistics.size();
 }
 
 ::mediapipe::Status LipTrackCalculator::IsActiveSpeaker(
-  const std::deque<float>& face_lip_statistics_inner,
-  const std::deque<float>& face_lip_statistics_outer, bool* is_speaker) {
+  const LipTrackStatistics& face_lip_statistics, bool* is_speaker) {
+  const auto& face_lip_statistics_inner = face_lip_statistics.inner;
+  const auto& face_lip_statistics_outer = face_lip_statistics.outer;
   RET_CHECK_EQ(face_lip_statistics_inner.size(), face_lip_statistics_outer.size())
     << "Statistics is not correct.";
-  // If a face only appears in a few frames, it's not an active speaker. 
-  if (face_lip_statistics_inner.size() <= options_.variance_history() / 2) {
-    *is_speaker = false;
-    return ::mediapipe::OkStatus();
-  }
-
-  float mean_inner = 0.0f, variance_inner = 0.0,
-        mean_outer = 0.0f, variance_outer = 0.0;
-  GetMeanAndVariance(face_lip_statistics_inner, &mean_inner, &variance_inner);
-  GetMeanAndVariance(face_lip_statistics_outer, &mean_outer, &variance_outer);
+  // If a face only appears in a few frames, its lip statistics do not tell
+  // whether it speaks.
+  const bool has_lip_history =
+    face_lip_statistics_inner.size() > options_.variance_history() / 2;
+  const float mean_inner = face_lip_statistics_inner.RecentMean();
+  const float variance_inner = face_lip_statistics_inner.Variance();
+  const float mean_outer = face_lip_statistics_outer.RecentMean();
+  const float variance_outer = face_lip_statistics_outer.Variance();
   
-  if ((mean_inner >= options_.lip_inner_mean_threshold_big_mouth() // Inner lip
+  const bool is_lip_speaker = has_lip_history &&
+    ((mean_inner >= options_.lip_inner_mean_threshold_big_mouth() // Inner lip
     && variance_inner >= options_.lip_inner_variance_threshold_big_mouth()
     && mean_inner > speaker_mean_inner_)
     || 
@@ -660,34 +1351,78 @@ void LipTrackCalculator::GetMeanAndVariance(const std::deque<float>& face_lip_st
     || 
     (mean_outer >= options_.lip_outer_mean_threshold_small_mouth()
     && variance_outer >= options_.lip_outer_variance_threshold_small_mouth()
-    && variance_outer > speaker_variance_outer_)
-    ) {
+    && variance_outer > speaker_variance_outer_));
+
+  // With the mouth motion, a still mouth does not speak, and the mouth that
+  // moves the most speaks even before it has enough lip statistics.
+  const auto& face_lip_statistics_motion = face_lip_statistics.motion;
+  const bool has_motion = face_lip_statistics_motion.size() > 0;
+  const float mean_motion = has_motion ? face_lip_statistics_motion.RecentMean() : 0;
+  if (has_motion) {
+    *is_speaker = mean_motion >= options_.mouth_motion_threshold()
+      && (is_lip_speaker || mean_motion > speaker_motion_);
+  } else {
+    *is_speaker = is_lip_speaker;
+  }
+
+  if (*is_speaker) {
+    if (has_lip_history) {
       speaker_mean_inner_ = mean_inner;
       speaker_variance_inner_ = variance_inner;
       speaker_mean_outer_ = mean_outer;
       speaker_variance_outer_ = variance_outer;
-      *is_speaker = true;
-      return ::mediapipe::OkStatus();
     }
-
-  *is_speaker = false;
+    speaker_motion_ = std::max(speaker_motion_, mean_motion);
+  }
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status LipTrackCalculator::OutputVizFrames(
-    const std::vector<NormalizedLandmarkList>& input_landmark_lists,
+    const std::vector<LipLandmarks>& input_lip_landmarks,
     const std::vector<Detection>& detected_bbox,
     const std::vector<Detection>& active_speaker_bbox, 
-    const cv::Mat& scene_frame, CalculatorContext* cc,
+    const Packet& frame_packet, CalculatorContext* cc,
     int64 timestamp) {
-  auto viz_frame = absl::make_unique<ImageFrame>(
-    frame_format_, scene_frame.cols, scene_frame.rows);
-  cv::Mat viz_mat = formats::MatView(viz_frame.get());
+  RET_CHECK(!frame_packet.IsEmpty()) << "No frame kept for visualization.";
+  if (viz_render_queue_) {
+    // The render thread gets its own copy of the small per frame data, and
+    // shares the frame through the packet.
+    viz_render_queue_->Push(timestamp,
+      [this, input_lip_landmarks, detected_bbox, active_speaker_bbox, frame_packet]() {
+        std::unique_ptr<ImageFrame> viz_frame;
+        auto status = RenderVizFrame(input_lip_landmarks, detected_bbox,
+                                     active_speaker_bbox, frame_packet, &viz_frame);
+        if (!status.ok()) {
+          LOG(ERROR) << "Failed to render visualization frame: " << status;
+          return std::unique_ptr<ImageFrame>();
+        }
+        return viz_frame;
+      });
+    return ::mediapipe::OkStatus();
+  }
+
+  std::unique_ptr<ImageFrame> viz_frame;
+  MP_RETURN_IF_ERROR(RenderVizFrame(input_lip_landmarks, detected_bbox,
+                                    active_speaker_bbox, frame_packet, &viz_frame));
+  cc->Outputs().Tag(kOutputContour).Add(viz_frame.release(), Timestamp(timestamp));
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipTrackCalculator::RenderVizFrame(
+    const std::vector<LipLandmarks>& input_lip_landmarks,
+    const std::vector<Detection>& detected_bbox,
+    const std::vector<Detection>& active_speaker_bbox,
+    const Packet& frame_packet, std::unique_ptr<ImageFrame>* viz_frame) {
+  // The frame is materialized only here, when it is drawn on.
+  const auto& scene_frame = frame_packet.Get<ImageFrame>();
+  *viz_frame = absl::make_unique<ImageFrame>(
+    frame_format_, scene_frame.Width(), scene_frame.Height());
+  cv::Mat viz_mat = formats::MatView(viz_frame->get());
   
-  scene_frame.copyTo(viz_mat);
+  formats::MatView(&scene_frame).copyTo(viz_mat);
 
-  if (!input_landmark_lists.empty()) {
-    MP_RETURN_IF_ERROR(DrawLandMarksAndInfor(input_landmark_lists, 
+  if (!input_lip_landmarks.empty()) {
+    MP_RETURN_IF_ERROR(DrawLandMarksAndInfor(input_lip_landmarks, 
               kGreen, kBlue, &viz_mat));
     // Draw input face bbox
     if (!detected_bbox.empty())
@@ -697,35 +1432,35 @@ void LipTrackCalculator::GetMeanAndVariance(const std::deque<float>& face_lip_st
       MP_RETURN_IF_ERROR(DrawBBox(active_speaker_bbox, true, kRed, &viz_mat));
   }
 
-  cc->Outputs().Tag(kOutputContour).Add(viz_frame.release(), Timestamp(timestamp));
   return ::mediapipe::OkStatus();
 }
 
+void LipTrackCalculator::EmitRenderedVizFrames(CalculatorContext* cc) {
+  if (!viz_render_queue_) return;
+  viz_render_queue_->PopRendered(&rendered_viz_frames_);
+  for (auto& rendered : rendered_viz_frames_) {
+    cc->Outputs().Tag(kOutputContour).Add(rendered.second.release(),
+                                          Timestamp(rendered.first));
+  }
+  rendered_viz_frames_.clear();
+}
+
 cv::Point2f LipTrackCalculator::LandmarkToPoint(const int idx, 
-                const NormalizedLandmarkList& landmark_list) {
-  return cv::Point2f(landmark_list.landmark(idx).x()*frame_width_, 
-                    landmark_list.landmark(idx).y()*frame_height_);
+                const LipLandmarks& lip_landmarks) {
+  return cv::Point2f(lip_landmarks.x[idx]*frame_width_, 
+                    lip_landmarks.y[idx]*frame_height_);
 }
 
 ::mediapipe::Status LipTrackCalculator::DrawLandMarksAndInfor(
-      const std::vector<NormalizedLandmarkList>& landmark_lists,
+      const std::vector<LipLandmarks>& lip_landmarks,
       const cv::Scalar& landmark_color, 
       const cv::Scalar& contour_color, cv::Mat* viz_mat) {
-  for (int i = 0; i < landmark_lists.size(); ++i) {
-    auto& landmark_list = landmark_lists[i];
-    std::vector<cv::Point2f> vertices;
-    for (auto& idx : kLipInnerContourIdx)
-      vertices.push_back(LandmarkToPoint(idx, landmark_list));
-    for (int j = 0; j < 8; ++j) {
-      // Draw lip landmarks
-      cv::circle(*viz_mat, vertices[j], 1, landmark_color, CV_FILLED);
-    }
-    vertices.clear();
-    for (auto& idx : kLipOuterContourIdx)
-      vertices.push_back(LandmarkToPoint(idx, landmark_list));
-    for (int j = 0; j < 8; ++j) {
-      // Draw lip landmarks
-      cv::circle(*viz_mat, vertices[j], 1, landmark_color, CV_FILLED);
+  for (const auto& face_lip_landmarks : lip_landmarks) {
+    if (!face_lip_landmarks.valid) continue;
+    // Draw the inner and outer lip landmarks
+    for (int j = 0; j < kNumLipLandmarks; ++j) {
+      cv::circle(*viz_mat, LandmarkToPoint(j, face_lip_landmarks), 1,
+                 landmark_color, CV_FILLED);
     }
   }
 
@@ -759,6 +1494,25 @@ void LipTrackCalculator::Transmit(mediapipe::CalculatorContext* cc,
       && (Timestamp(timestamp) - last_shot_timestamp_).Seconds() < options_.min_shot_span()) {
     is_speaker_change = false;
   }
+  // A scene may be emitted at the timestamp of the previous one.
+  if (cc->Outputs().HasTag(kOutputSegment) &&
+      Timestamp(timestamp) > segment_builder_.last_timestamp()) {
+    ShotSegment segment;
+    // A speaker change is certain.
+    if (segment_builder_.AddFrame(Timestamp(timestamp), is_speaker_change,
+                                  /*confidence=*/1.0f, &segment)) {
+      cc->Outputs().Tag(kOutputSegment).AddPacket(
+          MakePacket<ShotSegment>(segment).At(
+              Timestamp(segment.start_timestamp_us())));
+    }
+    // The next shot is output at the start of the current one at the
+    // earliest.
+    cc->Outputs().Tag(kOutputSegment).SetNextTimestampBound(
+        segment_builder_.current_start());
+  }
+  if (!cc->Outputs().HasTag(kOutputShot)) {
+    return;
+  }
   if (is_speaker_change) {
     LOG(INFO) << "Speakers change at: " << Timestamp(timestamp).Seconds()
               << " seconds.";
@@ -12,8 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/lip_track_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
@@ -39,13 +41,19 @@ namespace {
 
 constexpr char kInputVideo[] = "VIDEO";
 constexpr char kInputLandmark[] = "LANDMARKS";
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
 constexpr char kInputROI[] = "DETECTIONS";
+constexpr char kInputMouthMotion[] = "MOUTH_MOTION";
 constexpr char kOutputROI[] = "DETECTIONS_SPEAKERS";
 constexpr char kOutputShot[] = "IS_SPEAKER_CHANGE";
+constexpr char kOutputSegment[] = "SEGMENT";
+constexpr char kOutputContour[] = "CONTOUR_INFORMATION_FRAME";
+constexpr char kOutputStats[] = "STATS";
+constexpr char kInputState[] = "INITIAL_STATE";
+constexpr char kOutputState[] = "STATE";
 
 const int32 kImagewidth = 800; 
 const int32 kImageheight = 600;
-const int32 kFaceMeshLandmarks = 468;
 
 // Lip contour landmarks.
 // Lip left inner corner: 78, lip right inner corner: 308.
@@ -68,6 +76,9 @@ const std::vector<std::vector<float>> kRoiValueTwoDiff{{0.4, 0.1, 0.2, 0.6}, {0.
 // Time stamp
 const std::vector<int64> kTimeStampOne{2000};
 const std::vector<int64> kTimeStampTwo{2000, 4000};
+const std::vector<int64> kTimeStampFour{2000, 4000, 6000, 8000};
+const std::vector<int64> kTimeStampLastTwo{6000, 8000};
+const std::vector<int64> kTimeStampLastThree{4000, 6000, 8000};
 
 constexpr char kConfig[] = R"(
     calculator: "LipTrackCalculator"
@@ -93,6 +104,28 @@ constexpr char kConfig[] = R"(
       }
     })";
 
+constexpr char kConfigWithContour[] = R"(
+    calculator: "LipTrackCalculator"
+    input_stream: "VIDEO:input_video"
+    input_stream: "LANDMARKS:multi_face_landmarks"
+    input_stream: "DETECTIONS:face_detections"
+    output_stream: "DETECTIONS_SPEAKERS:active_speakers_detections"
+    output_stream: "CONTOUR_INFORMATION_FRAME:contour_information_frames"
+    options: {
+      [mediapipe.autoflip.LipTrackCalculatorOptions.ext]: {
+        iou_threshold: 0.2
+        lip_inner_mean_threshold_big_mouth: 0.3
+        lip_inner_variance_threshold_big_mouth: 0.0
+        lip_inner_mean_threshold_small_mouth: 0.2
+        lip_inner_variance_threshold_small_mouth: 0.0
+        lip_outer_mean_threshold_big_mouth: 0.3
+        lip_outer_variance_threshold_big_mouth: 0.0
+        lip_outer_mean_threshold_small_mouth: 0.2
+        lip_outer_variance_threshold_small_mouth: 0.0
+        min_speaker_span: 0
+      }
+    })";
+
 NormalizedLandmark CreateLandmark(const float x, const float y, const float z) {
   NormalizedLandmark landmark;
   landmark.set_x(x);
@@ -146,8 +179,21 @@ CalculatorGraphConfig::Node MakeConfig(const std::string base_config, const int3
   return config;
 }
 
+CalculatorGraphConfig::Node MakeStreamingConfig(const std::string base_config, const int32 history,
+        const int64 min_speaker_span, const int32 look_ahead_frames) {
+  auto config = MakeConfig(base_config, history, min_speaker_span);
+  config.mutable_options()
+    ->MutableExtension(LipTrackCalculatorOptions::ext)
+    ->set_streaming_mode(true);
+  config.mutable_options()
+    ->MutableExtension(LipTrackCalculatorOptions::ext)
+    ->set_look_ahead_frames(look_ahead_frames);
+  return config;
+}
+
 void AddScene(const std::vector<float>& landmark_value, const int64 time_ms, 
-              const std::vector<float>& roi_value, CalculatorRunner::StreamContentsSet* inputs) {
+              const std::vector<float>& roi_value, CalculatorRunner::StreamContentsSet* inputs,
+              const bool lip_landmarks = false) {
   // Each scene contains one input frame, one landmarkList and one ROI.
   Timestamp timestamp(time_ms);
   // Setup video
@@ -157,12 +203,19 @@ void AddScene(const std::vector<float>& landmark_value, const int64 time_ms,
     Adopt(input_frame.release()).At(timestamp));
 
   // Setup landmarks
-  auto vec_landmarks_list = absl::make_unique<std::vector<NormalizedLandmarkList>>();
   NormalizedLandmarkList landmarks_list;
   CreateLandmarkList(landmark_value, &landmarks_list);
-  vec_landmarks_list->push_back(landmarks_list);
-  inputs->Tag(kInputLandmark).packets.push_back(
-      Adopt(vec_landmarks_list.release()).At(timestamp));
+  if (lip_landmarks) {
+    auto vec_lip_landmarks = absl::make_unique<std::vector<LipLandmarks>>();
+    vec_lip_landmarks->push_back(ExtractLipLandmarks(landmarks_list));
+    inputs->Tag(kInputLipLandmark).packets.push_back(
+        Adopt(vec_lip_landmarks.release()).At(timestamp));
+  } else {
+    auto vec_landmarks_list = absl::make_unique<std::vector<NormalizedLandmarkList>>();
+    vec_landmarks_list->push_back(landmarks_list);
+    inputs->Tag(kInputLandmark).packets.push_back(
+        Adopt(vec_landmarks_list.release()).At(timestamp));
+  }
 
   // Setup ROIS
   auto vec_roi = absl::make_unique<std::vector<Detection>>();
@@ -175,9 +228,10 @@ void AddScene(const std::vector<float>& landmark_value, const int64 time_ms,
 void SetInputs(const std::vector<std::vector<float>>& landmark_values,
               const std::vector<int64>& time_stamps_ms, 
               const std::vector<std::vector<float>>& roi_values,
-              CalculatorRunner* runner) {
+              CalculatorRunner* runner, const bool lip_landmarks = false) {
   for (int i = 0; i < landmark_values.size(); ++i){
-    AddScene(landmark_values[i], time_stamps_ms[i], roi_values[i], runner->MutableInputs());
+    AddScene(landmark_values[i], time_stamps_ms[i], roi_values[i], runner->MutableInputs(),
+             lip_landmarks);
   }
 }
 
@@ -269,6 +323,89 @@ TEST(LipTrackCalculatorTest, TwofacesOneSpeaker) {
   CheckOutputs(scene_num, gt_output_nums, kRoiValueTwoSame, runner.get());
 }
 
+// Four frames, one face whose history is longer than variance_history,
+// one speaker
+TEST(LipTrackCalculatorTest, LongHistoryOneSpeaker) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeConfig(kConfig, 2, 10000));
+  int32 scene_num = 4;
+  std::vector<int32> gt_output_nums{1, 1, 1, 1};
+  const std::vector<std::vector<float>> landmark_values(
+      scene_num, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(scene_num, kRoiValueOne[0]);
+  SetInputs(landmark_values, kTimeStampFour, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(scene_num, gt_output_nums, roi_values, runner.get());
+}
+
+// Same as TwofacesOneSpeaker, with the lip landmarks extracted upstream.
+TEST(LipTrackCalculatorTest, LipLandmarksOneSpeaker) {
+  const std::string config = absl::StrReplaceAll(kConfig,
+    {{"LANDMARKS:multi_face_landmarks", "LIP_LANDMARKS:multi_face_lip_landmarks"}});
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeConfig(config, 2, 3000));
+  int32 scene_num = 2;
+  std::vector<int32> gt_output_nums{1, 1};
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoSame, runner.get(),
+            /* lip_landmarks = */ true);
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(scene_num, gt_output_nums, kRoiValueTwoSame, runner.get());
+}
+
+// Streaming mode. Four frames, one face, one speaker. Each frame is output
+// once the next frame is analyzed, before the scene ends.
+TEST(LipTrackCalculatorTest, StreamingOneSpeaker) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+    MakeStreamingConfig(kConfig, 2, 10000, 1));
+  int32 scene_num = 4;
+  std::vector<int32> gt_output_nums{1, 1, 1, 1};
+  const std::vector<std::vector<float>> landmark_values(
+      scene_num, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(scene_num, kRoiValueOne[0]);
+  SetInputs(landmark_values, kTimeStampFour, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(scene_num, gt_output_nums, roi_values, runner.get());
+
+  // Only the first speaker detection is a speaker change.
+  const std::vector<Packet>& output_shot_boundary = 
+      runner.get()->Outputs().Tag(kOutputShot).packets;
+  ASSERT_EQ(1, output_shot_boundary.size());
+  EXPECT_EQ(Timestamp(kTimeStampFour[0]), output_shot_boundary[0].Timestamp());
+}
+
+// Streaming mode with the speaker changes as shots: the four frames of
+// StreamingOneSpeaker are one shot instead of four bool packets.
+TEST(LipTrackCalculatorTest, StreamingSpeakerSegment) {
+  const std::string config = absl::StrReplaceAll(kConfig,
+    {{"IS_SPEAKER_CHANGE:speaker_change", "SEGMENT:speaker_segment"}});
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+    MakeStreamingConfig(config, 2, 10000, 1));
+  const std::vector<std::vector<float>> landmark_values(
+      4, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(4, kRoiValueOne[0]);
+  SetInputs(landmark_values, kTimeStampFour, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const std::vector<Packet>& segments =
+      runner->Outputs().Tag(kOutputSegment).packets;
+  ASSERT_EQ(1, segments.size());
+  EXPECT_EQ(Timestamp(kTimeStampFour[0]), segments[0].Timestamp());
+  const auto& segment = segments[0].Get<ShotSegment>();
+  EXPECT_EQ(kTimeStampFour[0], segment.start_timestamp_us());
+  EXPECT_EQ(kTimeStampFour[3] + 1, segment.end_timestamp_us());
+  EXPECT_TRUE(segment.starts_with_shot_change());
+  EXPECT_EQ(ShotSegment::SPEAKER_CHANGE, segment.source());
+}
+
+// Streaming mode. Two frames, one face, no speaker
+TEST(LipTrackCalculatorTest, StreamingNoSpeaker) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+    MakeStreamingConfig(kConfig, 2, 10000, 1));
+  int32 scene_num = 2;
+  std::vector<int32> gt_output_nums{0, 0};
+  SetInputs(kLandmaksValueTwoDiff, kTimeStampTwo, kRoiValueTwoSame, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(scene_num, gt_output_nums, kRoiValueTwoSame, runner.get());
+}
+
 // Check shot boundary output. Two frames, two landmarksLists (faces),
 // two speakers
 TEST(LipTrackCalculatorTest, ShotBoundary) {
@@ -297,6 +434,267 @@ TEST(LipTrackCalculatorTest, SpeakerSpanAndClose) {
   CheckOutputs(scene_num, gt_output_nums, output, runner.get());
 }
 
+// Check the visualization output. The frames are kept by reference and
+// only rendered when CONTOUR_INFORMATION_FRAME is connected.
+TEST(LipTrackCalculatorTest, ContourInformationFrame) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeConfig(kConfigWithContour, 1));
+  int32 scene_num = 2;
+  std::vector<int32> gt_output_nums{1, 1};
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoDiff, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(scene_num, gt_output_nums, kRoiValueTwoDiff, runner.get());
+
+  const std::vector<Packet>& output_frames = 
+      runner.get()->Outputs().Tag(kOutputContour).packets;
+  ASSERT_EQ(scene_num, output_frames.size());
+  for (int i = 0; i < scene_num; ++i) {
+    const auto& frame = output_frames[i].Get<ImageFrame>();
+    EXPECT_EQ(kImagewidth, frame.Width());
+    EXPECT_EQ(kImageheight, frame.Height());
+    EXPECT_EQ(Timestamp(kTimeStampTwo[i]), output_frames[i].Timestamp());
+  }
+}
+
+// Same as ContourInformationFrame, with the frames drawn on the render
+// thread.
+TEST(LipTrackCalculatorTest, QueuedContourInformationFrame) {
+  auto config = MakeConfig(kConfigWithContour, 1);
+  config.mutable_options()
+    ->MutableExtension(LipTrackCalculatorOptions::ext)
+    ->set_visualization_queue_size(16);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  int32 scene_num = 2;
+  std::vector<int32> gt_output_nums{1, 1};
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoDiff, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(scene_num, gt_output_nums, kRoiValueTwoDiff, runner.get());
+
+  const std::vector<Packet>& output_frames = 
+      runner.get()->Outputs().Tag(kOutputContour).packets;
+  ASSERT_EQ(scene_num, output_frames.size());
+  for (int i = 0; i < scene_num; ++i) {
+    EXPECT_EQ(Timestamp(kTimeStampTwo[i]), output_frames[i].Timestamp());
+  }
+}
+
+// Check the STATS output of a scene with one face in two frames.
+TEST(LipTrackCalculatorTest, SceneStats) {
+  const std::string config = absl::StrReplaceAll(kConfig,
+    {{"output_stream: \"IS_SPEAKER_CHANGE:speaker_change\"",
+      "output_stream: \"IS_SPEAKER_CHANGE:speaker_change\"\n"
+      "    output_stream: \"STATS:lip_track_stats\""}});
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeConfig(config, 2, 3000));
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoSame, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const std::vector<Packet>& stats_packets =
+      runner->Outputs().Tag(kOutputStats).packets;
+  ASSERT_EQ(1, stats_packets.size());
+  EXPECT_EQ(Timestamp(kTimeStampTwo[1]), stats_packets[0].Timestamp());
+  const auto& stats = stats_packets[0].Get<LipTrackSceneStats>();
+  EXPECT_EQ(kTimeStampTwo[0], stats.start_timestamp());
+  EXPECT_EQ(kTimeStampTwo[1], stats.end_timestamp());
+  EXPECT_EQ(2, stats.buffered_frames());
+  EXPECT_GT(stats.buffered_bytes(), 0);
+  EXPECT_THAT(stats.faces_per_frame(), testing::ElementsAre(1, 1));
+  EXPECT_EQ(1, stats.tracks_created());
+  ASSERT_EQ(1, stats.speaker_votes_size());
+  EXPECT_GT(stats.speaker_votes(0), 0);
+  EXPECT_EQ(0, stats.dominate_speaker());
+  EXPECT_GE(stats.statistics_time_us(), 0);
+  EXPECT_GE(stats.matching_time_us(), 0);
+  EXPECT_GE(stats.emission_time_us(), 0);
+}
+
+// Adds the side packets of the chunk state to the config.
+CalculatorGraphConfig::Node MakeChunkConfig(const bool initial_state,
+        const int64 output_start_timestamp = -1) {
+  auto config = MakeConfig(kConfig, 1);
+  if (initial_state) {
+    config.add_input_side_packet("INITIAL_STATE:initial_state");
+  }
+  config.add_output_side_packet("STATE:state");
+  if (output_start_timestamp >= 0) {
+    config.mutable_options()
+      ->MutableExtension(LipTrackCalculatorOptions::ext)
+      ->set_output_start_timestamp(output_start_timestamp);
+  }
+  return config;
+}
+
+// Runs the first chunk, two frames of one speaker, and returns its state.
+LipTrackState RunFirstChunk() {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeChunkConfig(false));
+  const std::vector<std::vector<float>> landmark_values(2, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(2, kRoiValueOne[0]);
+  SetInputs(landmark_values, kTimeStampTwo, roi_values, runner.get());
+  MP_EXPECT_OK(runner->Run());
+  return runner->OutputSidePackets().Tag(kOutputState).Get<LipTrackState>();
+}
+
+// The state of a chunk is exported when it closes.
+TEST(LipTrackCalculatorTest, ExportState) {
+  const LipTrackState state = RunFirstChunk();
+  EXPECT_EQ(kTimeStampTwo[1], state.last_timestamp());
+  EXPECT_EQ(0, state.dominate_speaker_id());
+  ASSERT_TRUE(state.has_speaker_detection());
+  const auto& bbox = state.speaker_detection().location_data().relative_bounding_box();
+  EXPECT_FLOAT_EQ(kRoiValueOne[0][0], bbox.xmin());
+  EXPECT_FLOAT_EQ(kRoiValueOne[0][2], bbox.width());
+  EXPECT_EQ(kTimeStampTwo[0], state.last_shot_timestamp());
+  EXPECT_FALSE(state.stopped_by_scene_change());
+}
+
+// The second chunk resumes from the state of the first one. The same
+// speaker is not a speaker change, as in one run over both chunks.
+TEST(LipTrackCalculatorTest, ImportState) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeChunkConfig(true));
+  runner->MutableSidePackets()->Tag(kInputState) =
+      MakePacket<LipTrackState>(RunFirstChunk());
+  const std::vector<std::vector<float>> landmark_values(2, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(2, kRoiValueOne[0]);
+  SetInputs(landmark_values, kTimeStampLastTwo, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(2, {1, 1}, roi_values, runner.get());
+  EXPECT_TRUE(runner->Outputs().Tag(kOutputShot).packets.empty());
+  EXPECT_EQ(kTimeStampLastTwo[1],
+            runner->OutputSidePackets().Tag(kOutputState).Get<LipTrackState>()
+              .last_timestamp());
+}
+
+// The second chunk starts with an overlap of one frame, which is not
+// output. The overlap finds another speaker than the imported state, and
+// this speaker wins.
+TEST(LipTrackCalculatorTest, StitchChunks) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+    MakeChunkConfig(true, kTimeStampLastTwo[0]));
+  runner->MutableSidePackets()->Tag(kInputState) =
+      MakePacket<LipTrackState>(RunFirstChunk());
+  const std::vector<std::vector<float>> landmark_values(3, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(3, kRoiValueTwoDiff[1]);
+  SetInputs(landmark_values, kTimeStampLastThree, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  const std::vector<Packet>& output_packets =
+      runner->Outputs().Tag(kOutputROI).packets;
+  ASSERT_EQ(2, output_packets.size());
+  EXPECT_EQ(Timestamp(kTimeStampLastTwo[0]), output_packets[0].Timestamp());
+  CheckOutputs(2, {1, 1}, roi_values, runner.get());
+  EXPECT_TRUE(runner->Outputs().Tag(kOutputShot).packets.empty());
+}
+
+// Without overlap, the same chunk starts with a speaker change.
+TEST(LipTrackCalculatorTest, ImportStateSpeakerChange) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeChunkConfig(true));
+  runner->MutableSidePackets()->Tag(kInputState) =
+      MakePacket<LipTrackState>(RunFirstChunk());
+  const std::vector<std::vector<float>> landmark_values(2, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(2, kRoiValueTwoDiff[1]);
+  SetInputs(landmark_values, kTimeStampLastTwo, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  const std::vector<Packet>& output_shot_boundary =
+      runner->Outputs().Tag(kOutputShot).packets;
+  ASSERT_EQ(1, output_shot_boundary.size());
+  EXPECT_EQ(Timestamp(kTimeStampLastTwo[0]), output_shot_boundary[0].Timestamp());
+}
+
+CalculatorGraphConfig::Node MakeMouthMotionConfig(const int32 history) {
+  const std::string config = absl::StrReplaceAll(kConfig,
+    {{"input_stream: \"DETECTIONS:face_detections\"",
+      "input_stream: \"DETECTIONS:face_detections\"\n"
+      "    input_stream: \"MOUTH_MOTION:mouth_motion\""}});
+  return MakeConfig(config, history);
+}
+
+// Adds the mouth motion of the only face of every frame.
+void SetMouthMotion(const std::vector<float>& motion_values,
+                    const std::vector<int64>& time_stamps_ms, CalculatorRunner* runner) {
+  for (int i = 0; i < motion_values.size(); ++i) {
+    runner->MutableInputs()->Tag(kInputMouthMotion).packets.push_back(
+        Adopt(new std::vector<float>({motion_values[i]}))
+          .At(Timestamp(time_stamps_ms[i])));
+  }
+}
+
+// The lips are open, but the mouth does not move between the frames of the
+// face mesh, so the face does not speak.
+TEST(LipTrackCalculatorTest, StillMouthIsNoSpeaker) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeMouthMotionConfig(1));
+  SetInputs(kLandmaksValueOneOpen, kTimeStampOne, kRoiValueOne, runner.get());
+  SetMouthMotion({0.0f}, kTimeStampOne, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(1, {0}, kRoiValueOne, runner.get());
+}
+
+// Unknown mouth motion falls back to the lip statistics.
+TEST(LipTrackCalculatorTest, UnknownMouthMotion) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeMouthMotionConfig(1));
+  SetInputs(kLandmaksValueOneOpen, kTimeStampOne, kRoiValueOne, runner.get());
+  SetMouthMotion({-1.0f}, kTimeStampOne, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(1, {1}, kRoiValueOne, runner.get());
+}
+
+// Every frame is a scene, so the lip statistics never span variance_history
+// frames. The mouth motion alone follows the face starting and stopping to
+// speak.
+TEST(LipTrackCalculatorTest, MouthMotionFollowsTurns) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(MakeMouthMotionConfig(2));
+  const std::vector<std::vector<float>> landmark_values(4, kLandmaksValueOneOpen[0]);
+  const std::vector<std::vector<float>> roi_values(4, kRoiValueOne[0]);
+  SetInputs(landmark_values, kTimeStampFour, roi_values, runner.get());
+  SetMouthMotion({0.1f, 0.1f, 0.0f, 0.0f}, kTimeStampFour, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(4, {1, 1, 0, 0}, roi_values, runner.get());
+
+  // Without the mouth motion, there is no speaker.
+  runner = ::absl::make_unique<CalculatorRunner>(MakeConfig(kConfig, 2));
+  SetInputs(landmark_values, kTimeStampFour, roi_values, runner.get());
+  MP_ASSERT_OK(runner->Run());
+  CheckOutputs(4, {0, 0, 0, 0}, roi_values, runner.get());
+}
+
+// Runs 120 frames of one speaker who moves to another place after 50
+// frames, in scenes of 50 frames.
+std::unique_ptr<CalculatorRunner> RunLongScenes(const bool async_scene_processing,
+                                                const int32 statistics_threads) {
+  auto config = MakeConfig(kConfig, 2, 100000);
+  auto* options = config.mutable_options()->MutableExtension(LipTrackCalculatorOptions::ext);
+  options->set_async_scene_processing(async_scene_processing);
+  options->set_statistics_threads(statistics_threads);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  for (int i = 0; i < 120; ++i) {
+    AddScene(kLandmaksValueOneOpen[0], 2000 * (i + 1),
+             kRoiValueTwoDiff[i < 50 ? 0 : 1], runner->MutableInputs());
+  }
+  MP_EXPECT_OK(runner->Run());
+  return runner;
+}
+
+// The scenes analyzed on the worker, with the lip statistics computed in
+// parallel, give the same outputs as the synchronous processing.
+TEST(LipTrackCalculatorTest, AsyncSceneProcessing) {
+  const auto sync_runner = RunLongScenes(false, 1);
+  const auto async_runner = RunLongScenes(true, 4);
+  for (const char* tag : {kOutputROI, kOutputShot}) {
+    const auto& expected = sync_runner->Outputs().Tag(tag).packets;
+    const auto& packets = async_runner->Outputs().Tag(tag).packets;
+    ASSERT_EQ(expected.size(), packets.size());
+    for (int i = 0; i < packets.size(); ++i) {
+      EXPECT_EQ(expected[i].Timestamp(), packets[i].Timestamp());
+    }
+  }
+  const auto& packets = async_runner->Outputs().Tag(kOutputROI).packets;
+  ASSERT_EQ(120, packets.size());
+  for (int i = 0; i < packets.size(); ++i) {
+    const auto& detections = packets[i].Get<std::vector<Detection>>();
+    ASSERT_EQ(1, detections.size());
+    EXPECT_FLOAT_EQ(kRoiValueTwoDiff[i < 50 ? 0 : 1][0],
+                    detections[0].location_data().relative_bounding_box().xmin());
+  }
+  // The speaker is found in the first scene, and moves in the second one.
+  EXPECT_EQ(2, async_runner->Outputs().Tag(kOutputShot).packets.size());
+}
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
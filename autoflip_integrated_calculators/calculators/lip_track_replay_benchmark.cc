@@ -0,0 +1,226 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays a lip trace (see lip_trace.h) through LipTrackCalculator as fast
+// as possible, and reports the frames per second, the p50 and p99 latency of
+// LipTrackCalculator::Process and the peak RSS of the process. Without
+// --trace_path, a synthetic trace of --num_faces faces is generated, so
+// that the speaker logic can be compared from 1 to 30 faces:
+//
+// bazel build -c opt --define MEDIAPIPE_DISABLE_GPU=1 \
+//   mediapipe/examples/desktop/autoflip/calculators:lip_track_replay_benchmark
+// for faces in 1 2 4 8 16 30; do
+//   bazel-bin/mediapipe/examples/desktop/autoflip/calculators/lip_track_replay_benchmark \
+//     --num_faces=${faces}
+// done
+//
+// A trace of a real video is recorded with LipTraceRecorderCalculator.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_trace.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_track_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(trace_path, "",
+              "The lip trace to replay. A synthetic trace is generated if "
+              "empty.");
+DEFINE_int32(num_faces, 4, "Number of faces of the synthetic trace.");
+DEFINE_int32(num_frames, 3000, "Number of frames of the synthetic trace.");
+DEFINE_string(synthetic_trace_path, "/tmp/synthetic_lip_trace",
+              "Where the synthetic trace is written.");
+DEFINE_bool(streaming_mode, false, "Runs LipTrackCalculator in streaming mode.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// The Process latency histogram has 10 us buckets up to 100 ms.
+constexpr char kGraphConfig[] = R"(
+    input_stream: "input_video"
+    input_stream: "lip_landmarks"
+    input_stream: "face_detections"
+    input_stream: "shot_change"
+    node {
+      calculator: "LipTrackCalculator"
+      input_stream: "VIDEO:input_video"
+      input_stream: "LIP_LANDMARKS:lip_landmarks"
+      input_stream: "DETECTIONS:face_detections"
+      input_stream: "SHOT_BOUNDARIES:shot_change"
+      output_stream: "DETECTIONS_SPEAKERS:active_speakers_detections"
+      output_stream: "IS_SPEAKER_CHANGE:speaker_change"
+      options: {
+        [mediapipe.autoflip.LipTrackCalculatorOptions.ext]: {}
+      }
+    }
+    profiler_config {
+      enable_profiler: true
+      histogram_interval_size_usec: 10
+      num_histogram_intervals: 10000
+    })";
+
+// Upper bound (in microseconds) of the histogram bucket of a quantile.
+int64 Percentile(const TimeHistogram& histogram, double quantile) {
+  int64 total = 0;
+  for (const int64 count : histogram.count()) {
+    total += count;
+  }
+  const int64 rank = std::max<int64>(1, std::ceil(quantile * total));
+  int64 cumulative = 0;
+  for (int i = 0; i < histogram.count_size(); ++i) {
+    cumulative += histogram.count(i);
+    if (cumulative >= rank) {
+      return (i + 1) * histogram.interval_size_usec();
+    }
+  }
+  return histogram.count_size() * histogram.interval_size_usec();
+}
+
+// Peak resident set size of the process, in MB.
+double PeakRssMb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in KB on Linux.
+  return usage.ru_maxrss / 1024.0;
+}
+
+::mediapipe::Status ReplayTrace(const LipTrace& trace) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraphConfig);
+  config.mutable_node(0)
+      ->mutable_options()
+      ->MutableExtension(LipTrackCalculatorOptions::ext)
+      ->set_streaming_mode(FLAGS_streaming_mode);
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  int64 num_outputs = 0;
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      "active_speakers_detections", [&num_outputs](const Packet& packet) {
+        ++num_outputs;
+        return ::mediapipe::OkStatus();
+      }));
+
+  // LipTrackCalculator only reads the dimensions of the frames, so all the
+  // frames share one.
+  const Packet video = MakePacket<ImageFrame>(
+      ImageFormat::SRGB, trace.frame_width(), trace.frame_height());
+  int64 num_faces = 0;
+  const absl::Time start = absl::Now();
+  MP_RETURN_IF_ERROR(graph.StartRun({}));
+  for (int i = 0; i < trace.num_frames(); ++i) {
+    const LipTraceFrame& frame = trace.frame(i);
+    const Timestamp timestamp(frame.timestamp);
+    if (frame.flags & kLipTraceHasVideo) {
+      MP_RETURN_IF_ERROR(
+          graph.AddPacketToInputStream("input_video", video.At(timestamp)));
+    }
+    if (frame.num_faces > 0) {
+      auto lip_landmarks = absl::make_unique<std::vector<LipLandmarks>>();
+      auto detections = absl::make_unique<std::vector<Detection>>();
+      const LipTraceFace* faces = trace.faces(frame);
+      for (int face = 0; face < frame.num_faces; ++face) {
+        lip_landmarks->push_back(ToLipLandmarks(faces[face]));
+        detections->push_back(ToDetection(faces[face]));
+      }
+      num_faces += frame.num_faces;
+      MP_RETURN_IF_ERROR(graph.AddPacketToInputStream(
+          "lip_landmarks", Adopt(lip_landmarks.release()).At(timestamp)));
+      MP_RETURN_IF_ERROR(graph.AddPacketToInputStream(
+          "face_detections", Adopt(detections.release()).At(timestamp)));
+    }
+    if (frame.flags & kLipTraceHasShotBoundary) {
+      MP_RETURN_IF_ERROR(graph.AddPacketToInputStream(
+          "shot_change",
+          MakePacket<bool>((frame.flags & kLipTraceShotBoundary) != 0)
+              .At(timestamp)));
+    }
+  }
+  MP_RETURN_IF_ERROR(graph.CloseAllInputStreams());
+  MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+  const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+
+  std::vector<CalculatorProfile> profiles;
+  MP_RETURN_IF_ERROR(graph.profiler()->GetCalculatorProfiles(&profiles));
+  const CalculatorProfile* profile = nullptr;
+  for (const auto& calculator_profile : profiles) {
+    if (calculator_profile.name() == "LipTrackCalculator") {
+      profile = &calculator_profile;
+    }
+  }
+  RET_CHECK(profile != nullptr) << "No profile of LipTrackCalculator.";
+
+  std::cout << "Frames: " << trace.num_frames() << " (" << num_outputs
+            << " output), faces per frame: "
+            << static_cast<double>(num_faces) /
+                   std::max(trace.num_frames(), 1)
+            << std::endl;
+  std::cout << "Throughput: " << trace.num_frames() / seconds << " frames/s"
+            << std::endl;
+  std::cout << "Process latency: p50 "
+            << Percentile(profile->process_runtime(), 0.5) << " us, p99 "
+            << Percentile(profile->process_runtime(), 0.99) << " us"
+            << std::endl;
+  std::cout << "Peak RSS: " << PeakRssMb() << " MB" << std::endl;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status RunBenchmark() {
+  std::string trace_path = FLAGS_trace_path;
+  if (trace_path.empty()) {
+    RET_CHECK(FLAGS_num_faces >= 1 && FLAGS_num_faces <= 30)
+        << "Synthetic traces have 1 to 30 faces.";
+    SyntheticLipTraceOptions options;
+    options.num_faces = FLAGS_num_faces;
+    options.num_frames = FLAGS_num_frames;
+    trace_path = FLAGS_synthetic_trace_path;
+    MP_RETURN_IF_ERROR(WriteSyntheticLipTrace(options, trace_path));
+  }
+  LipTrace trace;
+  MP_RETURN_IF_ERROR(trace.Open(trace_path));
+  return ReplayTrace(trace);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::Status run_status = ::mediapipe::autoflip::RunBenchmark();
+  if (!run_status.ok()) {
+    LOG(ERROR) << "Failed to run the benchmark: " << run_status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
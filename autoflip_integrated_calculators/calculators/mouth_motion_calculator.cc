@@ -0,0 +1,158 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_landmark_tracking.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/mouth_motion_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Frames at the full frame rate.
+constexpr char kInputVideo[] = "VIDEO";
+// Lip landmarks of the faces at a lower frame rate, whose timestamps are
+// timestamps of VIDEO.
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
+// (Optional) The frames before a shot boundary are not compared with the
+// frames after it.
+constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+constexpr char kOutputMouthMotion[] = "MOUTH_MOTION";
+
+// This calculator measures the motion of the mouths at the full frame rate,
+// while the face mesh locating them runs at a lower rate. It is much cheaper
+// than the face mesh: it only compares the pixels of small mouth crops from
+// one frame to the next (see MouthMotion).
+//
+// For every LIP_LANDMARKS packet, MOUTH_MOTION holds one value per face, in
+// the same order: the mean motion of the mouth crop over the VIDEO frames
+// since the previous LIP_LANDMARKS packet, up to the current frame. The
+// crops are taken from the current lip landmarks. Faces whose lips are
+// invalid, or without a previous frame, get -1. The output can be passed to
+// LipTrackCalculator with the lip landmarks, to fuse the lip statistics of
+// the face mesh with the motion seen in between.
+//
+// Example:
+//    calculator: "MouthMotionCalculator"
+//    input_stream: "VIDEO:video_frames_scaled"
+//    input_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+//    input_stream: "SHOT_BOUNDARIES:shot_change"
+//    output_stream: "MOUTH_MOTION:mouth_motion"
+class MouthMotionCalculator : public CalculatorBase {
+ public:
+  MouthMotionCalculator() {}
+  ~MouthMotionCalculator() override {}
+  MouthMotionCalculator(const MouthMotionCalculator&) = delete;
+  MouthMotionCalculator& operator=(const MouthMotionCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  MouthMotionCalculatorOptions options_;
+  // Gray frames since the last LIP_LANDMARKS packet, the oldest first. Only
+  // the first num_frames_ are used, the others keep their storage for reuse.
+  std::vector<GrayFrame> frames_;
+  int num_frames_ = 0;
+};
+REGISTER_CALCULATOR(MouthMotionCalculator);
+
+::mediapipe::Status MouthMotionCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputVideo).Set<ImageFrame>();
+  cc->Inputs().Tag(kInputLipLandmark).Set<std::vector<LipLandmarks>>();
+  if (cc->Inputs().HasTag(kInputShotBoundaries)) {
+    cc->Inputs().Tag(kInputShotBoundaries).Set<bool>();
+  }
+  cc->Outputs().Tag(kOutputMouthMotion).Set<std::vector<float>>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status MouthMotionCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  options_ = cc->Options<MouthMotionCalculatorOptions>();
+  RET_CHECK_GE(options_.max_shift(), 0);
+  RET_CHECK_GE(options_.max_buffered_frames(), 1);
+  // The frame of the last LIP_LANDMARKS packet is kept in addition.
+  frames_.resize(options_.max_buffered_frames() + 1);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status MouthMotionCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  if (cc->Inputs().HasTag(kInputShotBoundaries) &&
+      !cc->Inputs().Tag(kInputShotBoundaries).IsEmpty() &&
+      cc->Inputs().Tag(kInputShotBoundaries).Get<bool>()) {
+    num_frames_ = 0;
+  }
+  if (!cc->Inputs().Tag(kInputVideo).IsEmpty()) {
+    const auto& image_frame = cc->Inputs().Tag(kInputVideo).Get<ImageFrame>();
+    // Frames of different sizes are not compared.
+    if (num_frames_ > 0 &&
+        (frames_[num_frames_ - 1].width != image_frame.Width() ||
+         frames_[num_frames_ - 1].height != image_frame.Height())) {
+      num_frames_ = 0;
+    }
+    if (num_frames_ == frames_.size()) {
+      std::rotate(frames_.begin(), frames_.begin() + 1, frames_.end());
+      --num_frames_;
+    }
+    frames_[num_frames_++].Assign(image_frame);
+  }
+  if (cc->Inputs().Tag(kInputLipLandmark).IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+
+  const auto& lips =
+      cc->Inputs().Tag(kInputLipLandmark).Get<std::vector<LipLandmarks>>();
+  auto motion = absl::make_unique<std::vector<float>>(lips.size(), -1.0f);
+  if (num_frames_ >= 2) {
+    const GrayFrame& frame = frames_[num_frames_ - 1];
+    for (int i = 0; i < lips.size(); ++i) {
+      MouthCrop crop;
+      if (!GetMouthCrop(lips[i], frame.width, frame.height,
+                        options_.crop_margin(), options_.max_shift(), &crop)) {
+        continue;
+      }
+      float sum = 0.0f;
+      for (int j = 1; j < num_frames_; ++j) {
+        sum += MouthMotion(frames_[j - 1], frames_[j], crop,
+                           options_.max_shift());
+      }
+      (*motion)[i] = sum / (num_frames_ - 1);
+    }
+  }
+  // The current frame starts the next interval.
+  if (num_frames_ > 0) {
+    std::swap(frames_[0], frames_[num_frames_ - 1]);
+    num_frames_ = 1;
+  }
+  cc->Outputs()
+      .Tag(kOutputMouthMotion)
+      .Add(motion.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,139 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_geometry.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputLipLandmark[] = "LIP_LANDMARKS";
+constexpr char kInputShotBoundaries[] = "SHOT_BOUNDARIES";
+constexpr char kOutputMouthMotion[] = "MOUTH_MOTION";
+
+const int kFrameWidth = 200;
+const int kFrameHeight = 160;
+
+const char kConfig[] = R"(
+    calculator: "MouthMotionCalculator"
+    input_stream: "VIDEO:input_video"
+    input_stream: "LIP_LANDMARKS:multi_face_lip_landmarks"
+    input_stream: "SHOT_BOUNDARIES:shot_change"
+    output_stream: "MOUTH_MOTION:mouth_motion"
+    )";
+
+// Textured SRGB frame, moved right by dx pixels. With an open mouth, the
+// mouth at (130, 60) has a dark hole.
+ImageFrame* CreateFrame(int dx, bool open_mouth) {
+  auto* frame = new ImageFrame(ImageFormat::SRGB, kFrameWidth, kFrameHeight);
+  for (int y = 0; y < kFrameHeight; ++y) {
+    uint8* row = frame->MutablePixelData() + y * frame->WidthStep();
+    for (int x = 0; x < kFrameWidth; ++x) {
+      const unsigned int u = x - dx;
+      uint8 value = (u * 7919u ^ y * 104729u) * 2654435761u >> 24;
+      if (open_mouth && x >= 132 && x < 140 && y >= 64 && y < 68) {
+        value = 0;
+      }
+      row[3 * x] = row[3 * x + 1] = row[3 * x + 2] = value;
+    }
+  }
+  return frame;
+}
+
+// Lips on a 4 x 4 grid of pixels around (x, y).
+LipLandmarks CreateLips(int x, int y) {
+  LipLandmarks lips;
+  for (int i = 0; i < kNumLipLandmarks; ++i) {
+    lips.x[i] = static_cast<float>(x + 4 * (i % 4)) / kFrameWidth;
+    lips.y[i] = static_cast<float>(y + 4 * (i / 4)) / kFrameHeight;
+    lips.z[i] = 0;
+  }
+  lips.valid = true;
+  return lips;
+}
+
+// The face mesh runs on every other frame. The first mouth is still while
+// the head moves a little, and the second one opens and closes on the
+// frames in between.
+TEST(MouthMotionCalculatorTest, MeasuresTheMotionBetweenMeshFrames) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  for (int i = 0; i < 5; ++i) {
+    runner.MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(CreateFrame(0, /* open_mouth = */ i % 2 == 1))
+            .At(Timestamp(i * 1000)));
+  }
+  LipLandmarks invalid_lips = CreateLips(80, 100);
+  invalid_lips.valid = false;
+  for (int i = 0; i < 5; i += 2) {
+    runner.MutableInputs()->Tag(kInputLipLandmark).packets.push_back(
+        Adopt(new std::vector<LipLandmarks>(
+                  {CreateLips(30, 60), CreateLips(130, 60), invalid_lips}))
+            .At(Timestamp(i * 1000)));
+  }
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputMouthMotion).packets;
+  ASSERT_EQ(3, packets.size());
+  // Nothing to compare the first frame with.
+  EXPECT_THAT(packets[0].Get<std::vector<float>>(),
+              ::testing::ElementsAre(-1.0f, -1.0f, -1.0f));
+  for (int i = 1; i < 3; ++i) {
+    EXPECT_EQ(Timestamp(i * 2000), packets[i].Timestamp());
+    const auto& motion = packets[i].Get<std::vector<float>>();
+    ASSERT_EQ(3, motion.size());
+    EXPECT_EQ(0.0f, motion[0]);
+    EXPECT_GT(motion[1], 0.01f);
+    EXPECT_EQ(-1.0f, motion[2]);
+  }
+}
+
+// The frames before a shot boundary are not compared with the frames after
+// it, and the head moves are compensated.
+TEST(MouthMotionCalculatorTest, RestartsOnShotBoundaries) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  for (int i = 0; i < 4; ++i) {
+    runner.MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(CreateFrame(i < 2 ? i : 50 + i, /* open_mouth = */ false))
+            .At(Timestamp(i * 1000)));
+    runner.MutableInputs()->Tag(kInputLipLandmark).packets.push_back(
+        Adopt(new std::vector<LipLandmarks>({CreateLips(30, 60)}))
+            .At(Timestamp(i * 1000)));
+  }
+  runner.MutableInputs()->Tag(kInputShotBoundaries).packets.push_back(
+      Adopt(new bool(true)).At(Timestamp(2000)));
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputMouthMotion).packets;
+  ASSERT_EQ(4, packets.size());
+  const float expected[] = {-1.0f, 0.0f, -1.0f, 0.0f};
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_THAT(packets[i].Get<std::vector<float>>(),
+                ::testing::ElementsAre(expected[i]));
+  }
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -12,10 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/types/span.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lapped_windows.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/pad_lapped_tensor_buffer_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/port/ret_check.h"
@@ -23,7 +27,6 @@
 #include "mediapipe/framework/profiler/circular_buffer.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
-#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/status.h"
 
@@ -33,7 +36,6 @@ const char kBufferSize[] = "BUFFER_SIZE";
 const char kOverlap[] = "OVERLAP";
 const char kTimestampOffset[] = "TIMESTAMP_OFFSET";
 const char kCalculatorOptions[] = "CALCULATOR_OPTIONS";
-const int kNumOfPadding = 25;
 const int kPaddingAdjust = 50;
 
 namespace tf = tensorflow;
@@ -55,7 +57,28 @@ namespace tf = tensorflow;
 //
 // Original lapped_tensor_buffer_calculator does not have padding function. This
 // calculator has the padding setting. It will pad before the video with the first
-// frame and pad after the video with the last frame. 
+// frame and pad after the video with the last frame. The padding frames are
+// not buffered: the windows are materialized with their frame indices clamped
+// to the real frames. An optional third output gives the ranges of the real
+// frames in the windows, as [begin, end) positions.
+//
+// With windows_per_batch larger than 1, the windows are output in batches
+// along a new first dimension, for offline jobs where throughput matters more
+// than latency. The timestamp vectors of the windows of a batch are
+// concatenated.
+//
+// Each input tensor is copied once into a window buffer holding several
+// consecutive windows, and the output tensors are views of this buffer, so
+// the overlapping windows share their frames instead of being concatenated.
+// When a buffer is full, the frames of the next window are copied into
+// another buffer, which is reused once all its windows have been released
+// downstream.
+//
+// With convert_to_float, the input tensors are DT_UINT8 and stay so in the
+// buffers, and the windows are converted to DT_FLOAT when they are output.
+// This divides the buffer memory and the copies by 4. The output tensors
+// which are copies rather than views, such as the DT_FLOAT windows and the
+// batches, are also kept and reused once released downstream.
 //
 // Example config:
 // node {
@@ -63,6 +86,7 @@ namespace tf = tensorflow;
 //   input_stream: "input_tensor"
 //   output_stream: "output_tensor"
 //   output_stream: "output_timestamp"
+//   output_stream: "output_frame_range"
 //   options {
 //     [mediapipe.LappedTensorBufferCalculatorOptions.ext] {
 //       buffer_size: 100
@@ -85,16 +109,55 @@ class PadLappedTensorBufferCalculator : public CalculatorBase {
   // Adds a batch dimension to the input tensor if specified in the 
   // calculator options.
   ::mediapipe::Status AddBatchDimension(tf::Tensor* input_tensor);
+  // Outputs the next window, or adds it to the pending batch.
   ::mediapipe::Status ProcessBuffer(CalculatorContext* cc);
+  // Outputs the pending batch of windows.
+  ::mediapipe::Status OutputBatch(CalculatorContext* cc);
+  // Allocates the first window buffer for frames like the given one.
+  ::mediapipe::Status InitializeWindowBuffers(const tf::Tensor& frame);
+  // Copies a frame at the end of the current window buffer.
+  ::mediapipe::Status AppendFrame(const tf::Tensor& frame);
+  // Moves to another window buffer, starting with the frames of the pending
+  // window.
+  void SwitchWindowBuffer();
+  // Returns the window, whose real frames are the last ones of the current
+  // window buffer. The frames outside of the video are copies of the first or
+  // last frame. The returned tensor may not be aligned.
+  tf::Tensor MaterializeWindow(const LappedWindow& window) const;
+  // Returns an output tensor to copy the windows into, reusing one which
+  // is released downstream when possible.
+  tf::Tensor AllocateOutputTensor(tf::DataType dtype,
+                                  const tf::TensorShape& shape);
 
-  int steps_until_output_;
+  std::unique_ptr<LappedWindows> windows_;
   int buffer_size_;
   int overlap_;
   int timestamp_offset_;
   int num_of_frames_;
 
   std::unique_ptr<CircularBuffer<Timestamp>> timestamp_buffer_;
-  std::unique_ptr<CircularBuffer<tf::Tensor>> buffer_;
+  // Timestamp of the first frame, also used for the padding before it.
+  Timestamp first_timestamp_;
+  // Shape of the input tensors, after the batch dimension is added.
+  tf::TensorShape frame_shape_;
+  tf::DataType frame_dtype_;
+  int64 frame_bytes_;
+  // Number of frames a window buffer holds.
+  int buffer_capacity_;
+  // The window buffers, the output tensors are slices of them. A buffer is
+  // free when it is only referenced here.
+  std::vector<tf::Tensor> window_buffers_;
+  int current_buffer_;
+  // Number of frames in the current window buffer.
+  int num_buffered_frames_;
+  // The windows of the pending batch, with their concatenated timestamps and
+  // their ranges of real frames.
+  std::vector<tf::Tensor> batch_windows_;
+  // Output tensors kept for reuse, at most num_window_buffers.
+  std::vector<tf::Tensor> output_tensors_;
+  std::unique_ptr<std::vector<Timestamp>> batch_timestamps_;
+  std::unique_ptr<std::vector<std::pair<int, int>>> batch_frame_ranges_;
+  Timestamp batch_timestamp_;
   PadLappedTensorBufferCalculatorOptions options_;
 };
 
@@ -107,8 +170,9 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   cc->Inputs().Index(0).Set<tf::Tensor>(
       // tensorflow::Tensor stream.
   );
-  RET_CHECK_EQ(cc->Outputs().NumEntries(), 2)
-      << "Only two outputs stream is supported.";
+  RET_CHECK(cc->Outputs().NumEntries() == 2 ||
+            cc->Outputs().NumEntries() == 3)
+      << "Only two or three output streams are supported.";
 
   if (cc->InputSidePackets().HasTag(kBufferSize)) {
     cc->InputSidePackets().Tag(kBufferSize).Set<int>();
@@ -130,6 +194,11 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   cc->Outputs().Index(1).Set<std::vector<Timestamp>>(
       // Output timestamp stream with possibly overlapping steps.
   );
+  if (cc->Outputs().NumEntries() == 3) {
+    cc->Outputs().Index(2).Set<std::vector<std::pair<int, int>>>(
+        // Output [begin, end) positions of the real frames in the windows.
+    );
+  }
   return ::mediapipe::OkStatus();
 }
 
@@ -154,14 +223,24 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   }
 
   RET_CHECK_LT(overlap_, buffer_size_);
+  RET_CHECK_GE(options_.num_padding(), 0)
+      << "Negative num_padding is not allowed.";
+  RET_CHECK_GT(buffer_size_, options_.num_padding())
+      << "buffer_size has to be larger than the padding.";
+  RET_CHECK_GE(options_.windows_per_buffer(), 1);
+  RET_CHECK_GE(options_.num_window_buffers(), 1);
+  RET_CHECK_GE(options_.windows_per_batch(), 1);
   RET_CHECK_GE(timestamp_offset_, 0)
       << "Negative timestamp_offset is not allowed.";
   RET_CHECK_LT(timestamp_offset_, buffer_size_)
       << "output_frame_num_offset has to be less than buffer_size.";
   timestamp_buffer_ =
       absl::make_unique<CircularBuffer<Timestamp>>(buffer_size_);
-  buffer_ = absl::make_unique<CircularBuffer<tf::Tensor>>(buffer_size_);
-  steps_until_output_ = buffer_size_ - kNumOfPadding;
+  buffer_capacity_ = buffer_size_ + (options_.windows_per_buffer() - 1) *
+                                        (buffer_size_ - overlap_);
+  windows_ =
+      absl::make_unique<LappedWindows>(buffer_size_, overlap_,
+                                       options_.num_padding());
   num_of_frames_ = 0;
 
   return ::mediapipe::OkStatus();
@@ -175,48 +254,34 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   if (options_.add_batch_dim_to_tensors()) {
     RET_CHECK_OK(AddBatchDimension(&input_tensor));
   }
-  // Pad frames at the beginning with the first frame.
   if (num_of_frames_ == 0) {
-    for (int i = 0; i < kNumOfPadding; ++i) {
-      buffer_->push_back(input_tensor);
-      timestamp_buffer_->push_back(cc->InputTimestamp());
-    }
+    MP_RETURN_IF_ERROR(InitializeWindowBuffers(input_tensor));
+    first_timestamp_ = cc->InputTimestamp();
   }
-  
-  buffer_->push_back(input_tensor);
+
+  MP_RETURN_IF_ERROR(AppendFrame(input_tensor));
   timestamp_buffer_->push_back(cc->InputTimestamp());
-  --steps_until_output_;
+  num_of_frames_ ++;
 
-  if (steps_until_output_ <= 0) {
+  // The window is output as soon as its last frame is received.
+  if (windows_->IsNextWindowComplete(num_of_frames_)) {
     MP_RETURN_IF_ERROR(ProcessBuffer(cc));
   }
 
-  num_of_frames_ ++;
-
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status PadLappedTensorBufferCalculator::Close(
     CalculatorContext* cc) {
-    if (num_of_frames_ == 0)
-      return ::mediapipe::OkStatus();
-    
-    int last_frame = buffer_size_ - steps_until_output_ - 1;
-    const auto& pad_frame = buffer_->Get(last_frame);
-    for (int i = 0; i < steps_until_output_; ++i) {
-      buffer_->push_back(pad_frame);
-      timestamp_buffer_->push_back(cc->InputTimestamp());
-    }
-    MP_RETURN_IF_ERROR(ProcessBuffer(cc));
-
-    if (overlap_ < num_of_frames_ 
-      && num_of_frames_ < buffer_size_ - kNumOfPadding) {
-      for (int i = 0; i < overlap_; ++i) {
-        buffer_->push_back(pad_frame);
-        timestamp_buffer_->push_back(cc->InputTimestamp());
-      }
+    // Outputs the windows padded after the video, until the decoded part
+    // of a window, after its first num_padding frames, covers the last
+    // frame.
+    while (windows_->IsNextWindowNeeded(num_of_frames_)) {
       MP_RETURN_IF_ERROR(ProcessBuffer(cc));
     }
+    if (!batch_windows_.empty()) {
+      MP_RETURN_IF_ERROR(OutputBatch(cc));
+    }
 
     return ::mediapipe::OkStatus();
 }
@@ -235,28 +300,199 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status PadLappedTensorBufferCalculator::InitializeWindowBuffers(
+    const tf::Tensor& frame) {
+  RET_CHECK(tf::DataTypeCanUseMemcpy(frame.dtype()))
+      << "Unsupported tensor type: " << tf::DataTypeString(frame.dtype());
+  RET_CHECK(!options_.convert_to_float() || frame.dtype() == tf::DT_UINT8)
+      << "convert_to_float requires DT_UINT8 input tensors.";
+  RET_CHECK_GE(frame.dims(), 1)
+      << "Tensors are concatenated along their first dimension.";
+  frame_shape_ = frame.shape();
+  frame_dtype_ = frame.dtype();
+  frame_bytes_ = frame.TotalBytes();
+  tf::TensorShape buffer_shape(frame_shape_);
+  buffer_shape.set_dim(0, frame_shape_.dim_size(0) * buffer_capacity_);
+  window_buffers_.assign(1, tf::Tensor(frame_dtype_, buffer_shape));
+  current_buffer_ = 0;
+  num_buffered_frames_ = 0;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTensorBufferCalculator::AppendFrame(
+    const tf::Tensor& frame) {
+  RET_CHECK(frame.dtype() == frame_dtype_ && frame.shape() == frame_shape_)
+      << "All the input tensors must have the same type and shape. Expected: "
+      << frame_shape_.DebugString() << " got: " << frame.shape().DebugString();
+  if (num_buffered_frames_ == buffer_capacity_) {
+    SwitchWindowBuffer();
+  }
+  char* buffer_data =
+      const_cast<char*>(window_buffers_[current_buffer_].tensor_data().data());
+  std::memcpy(buffer_data + num_buffered_frames_ * frame_bytes_,
+              frame.tensor_data().data(), frame_bytes_);
+  ++num_buffered_frames_;
+  return ::mediapipe::OkStatus();
+}
+
+void PadLappedTensorBufferCalculator::SwitchWindowBuffer() {
+  // A shallow copy, the current buffer may be replaced below.
+  const tf::Tensor previous_buffer = window_buffers_[current_buffer_];
+  int next_buffer = -1;
+  for (int i = 0; i < window_buffers_.size(); ++i) {
+    if (i != current_buffer_ && window_buffers_[i].RefCountIsOne()) {
+      next_buffer = i;
+      break;
+    }
+  }
+  if (next_buffer < 0) {
+    if (window_buffers_.size() < options_.num_window_buffers()) {
+      window_buffers_.emplace_back(frame_dtype_, previous_buffer.shape());
+      next_buffer = window_buffers_.size() - 1;
+    } else {
+      // All the buffers are still in use downstream. The replaced buffer is
+      // released with its last window.
+      next_buffer = (current_buffer_ + 1) % window_buffers_.size();
+      window_buffers_[next_buffer] =
+          tf::Tensor(frame_dtype_, previous_buffer.shape());
+    }
+  }
+  // The frames already received of the pending window.
+  const int num_carried_frames =
+      num_of_frames_ - windows_->first_needed_frame();
+  std::memcpy(
+      const_cast<char*>(window_buffers_[next_buffer].tensor_data().data()),
+      previous_buffer.tensor_data().data() +
+          (num_buffered_frames_ - num_carried_frames) * frame_bytes_,
+      num_carried_frames * frame_bytes_);
+  current_buffer_ = next_buffer;
+  num_buffered_frames_ = num_carried_frames;
+}
+
+tf::Tensor PadLappedTensorBufferCalculator::MaterializeWindow(
+    const LappedWindow& window) const {
+  const int64 rows = frame_shape_.dim_size(0);
+  const tf::Tensor real_frames = window_buffers_[current_buffer_].Slice(
+      (num_buffered_frames_ - (window.real_end - window.real_begin)) * rows,
+      num_buffered_frames_ * rows);
+  if (window.real_begin == window.begin && window.real_end == window.end) {
+    return real_frames;
+  }
+  tf::TensorShape window_shape(frame_shape_);
+  window_shape.set_dim(0, rows * buffer_size_);
+  tf::Tensor padded_window(frame_dtype_, window_shape);
+  char* window_data = const_cast<char*>(padded_window.tensor_data().data());
+  const char* first_frame = real_frames.tensor_data().data();
+  const char* last_frame =
+      first_frame + (window.real_end - window.real_begin - 1) * frame_bytes_;
+  for (int i = window.begin; i < window.real_begin; ++i) {
+    std::memcpy(window_data, first_frame, frame_bytes_);
+    window_data += frame_bytes_;
+  }
+  std::memcpy(window_data, first_frame, real_frames.TotalBytes());
+  window_data += real_frames.TotalBytes();
+  for (int i = window.real_end; i < window.end; ++i) {
+    std::memcpy(window_data, last_frame, frame_bytes_);
+    window_data += frame_bytes_;
+  }
+  return padded_window;
+}
+
+tf::Tensor PadLappedTensorBufferCalculator::AllocateOutputTensor(
+    tf::DataType dtype, const tf::TensorShape& shape) {
+  // The last batch may be smaller, so the shape is checked as well.
+  for (const tf::Tensor& tensor : output_tensors_) {
+    if (tensor.RefCountIsOne() && tensor.dtype() == dtype &&
+        tensor.shape() == shape) {
+      return tensor;
+    }
+  }
+  tf::Tensor tensor(dtype, shape);
+  if (output_tensors_.size() < options_.num_window_buffers()) {
+    output_tensors_.push_back(tensor);
+  }
+  return tensor;
+}
+
 // Process buffer
 ::mediapipe::Status PadLappedTensorBufferCalculator::ProcessBuffer(
   CalculatorContext* cc) {
-    auto concatenated = ::absl::make_unique<tf::Tensor>();
-    auto output_timestamp = ::absl::make_unique<std::vector<Timestamp>>();
-
-    const tf::Status concat_status = tf::tensor::Concat(
-        std::vector<tf::Tensor>(buffer_->begin(), buffer_->end()),
-        concatenated.get());
-    RET_CHECK(concat_status.ok()) << concat_status.ToString();
-
-    // Output cancatenated tensor.
-    cc->Outputs().Index(0).Add(concatenated.release(),
-                               timestamp_buffer_->Get(timestamp_offset_));
-
-    // Output timestamp vector.
-    *output_timestamp = std::vector<Timestamp>(timestamp_buffer_->begin(), timestamp_buffer_->end());
-    RET_CHECK_EQ(output_timestamp->size(), buffer_size_)
-      << "Output timestamp size is not correct.";
-    cc->Outputs().Index(1).Add(output_timestamp.release(),
-                               timestamp_buffer_->Get(timestamp_offset_));
-    steps_until_output_ = buffer_size_ - overlap_;
+    const LappedWindow window = windows_->PopWindow(num_of_frames_);
+    RET_CHECK_EQ(window.real_end, num_of_frames_);
+
+    if (batch_windows_.empty()) {
+      batch_timestamps_ = ::absl::make_unique<std::vector<Timestamp>>();
+      batch_frame_ranges_ =
+          ::absl::make_unique<std::vector<std::pair<int, int>>>();
+    }
+    batch_windows_.push_back(MaterializeWindow(window));
+
+    AppendWindowTimestamps(window, first_timestamp_,
+                           std::vector<Timestamp>(timestamp_buffer_->begin(),
+                                                  timestamp_buffer_->end()),
+                           batch_timestamps_.get());
+    batch_frame_ranges_->emplace_back(window.real_begin - window.begin,
+                                      window.real_end - window.begin);
+    // The batch is output at the timestamp of its first window.
+    if (batch_windows_.size() == 1) {
+      batch_timestamp_ = (*batch_timestamps_)[timestamp_offset_];
+    }
+
+    if (batch_windows_.size() == options_.windows_per_batch()) {
+      MP_RETURN_IF_ERROR(OutputBatch(cc));
+    }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTensorBufferCalculator::OutputBatch(
+    CalculatorContext* cc) {
+  std::unique_ptr<tf::Tensor> concatenated;
+  // A single window is passed through as a view of the window buffer when
+  // its dtype is kept, e.g. DT_UINT8 frames for a model taking uint8, and
+  // the view is aligned, as kernels expect. The view is aligned when the
+  // offset of the window, a multiple of the frame size, is a multiple of
+  // the alignment. Otherwise, and always with convert_to_float or batches,
+  // the windows are copied into an output tensor, converting each DT_UINT8
+  // pixel to DT_FLOAT on the way with convert_to_float.
+  if (options_.windows_per_batch() == 1 && !options_.convert_to_float() &&
+      batch_windows_[0].IsAligned()) {
+    concatenated = ::absl::make_unique<tf::Tensor>(batch_windows_[0]);
+  } else {
+    tf::TensorShape batch_shape(batch_windows_[0].shape());
+    if (options_.windows_per_batch() > 1) {
+      batch_shape.InsertDim(0, batch_windows_.size());
+    }
+    concatenated = ::absl::make_unique<tf::Tensor>(AllocateOutputTensor(
+        options_.convert_to_float() ? tf::DT_FLOAT : frame_dtype_,
+        batch_shape));
+    char* batch_data = const_cast<char*>(concatenated->tensor_data().data());
+    for (const tf::Tensor& batch_window : batch_windows_) {
+      if (options_.convert_to_float()) {
+        const uint8* pixels =
+            reinterpret_cast<const uint8*>(batch_window.tensor_data().data());
+        std::copy(pixels, pixels + batch_window.NumElements(),
+                  reinterpret_cast<float*>(batch_data));
+        batch_data += batch_window.NumElements() * sizeof(float);
+      } else {
+        std::memcpy(batch_data, batch_window.tensor_data().data(),
+                    batch_window.TotalBytes());
+        batch_data += batch_window.TotalBytes();
+      }
+    }
+  }
+  batch_windows_.clear();
+
+  // Output cancatenated tensor.
+  cc->Outputs().Index(0).Add(concatenated.release(), batch_timestamp_);
+
+  // Output timestamp vector.
+  cc->Outputs().Index(1).Add(batch_timestamps_.release(), batch_timestamp_);
+
+  // Output ranges of the real frames.
+  if (cc->Outputs().NumEntries() == 3) {
+    cc->Outputs().Index(2).Add(batch_frame_ranges_.release(),
+                               batch_timestamp_);
+  }
   return ::mediapipe::OkStatus();
 }
 
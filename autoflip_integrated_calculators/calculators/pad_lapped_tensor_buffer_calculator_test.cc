@@ -33,24 +33,30 @@ namespace tf = ::tensorflow;
 
 class PadLappedTensorBufferCalculatorTest : public ::testing::Test {
  protected:
-  void SetUpCalculator() {
+  void SetUpCalculator(bool output_frame_range = false,
+                       int windows_per_batch = 1) {
     CalculatorGraphConfig::Node config;
     config.set_calculator("PadLappedTensorBufferCalculator");
     config.add_input_stream("input_tensor");
     config.add_output_stream("output_tensor");
     config.add_output_stream("output_timestamp");
+    if (output_frame_range) {
+      config.add_output_stream("output_frame_range");
+    }
     auto options = config.mutable_options()->MutableExtension(
         PadLappedTensorBufferCalculatorOptions::ext);
+    options->set_windows_per_batch(windows_per_batch);
     runner_ = ::absl::make_unique<CalculatorRunner>(config);
   }
   std::unique_ptr<CalculatorRunner> runner_;
 };
 
-void SetupInputs(const int num_timesteps, CalculatorRunner* runner) {
+void SetupInputs(const int num_timesteps, CalculatorRunner* runner,
+                 const int frame_size = 1) {
     for (int i = 0; i < num_timesteps; ++i) {
     auto input = ::absl::make_unique<tensorflow::Tensor>(
-        tensorflow::DT_FLOAT, tensorflow::TensorShape({1}));
-    input->tensor<float, 1>()(0) = i;
+        tensorflow::DT_FLOAT, tensorflow::TensorShape({frame_size}));
+    input->flat<float>().setConstant(i);
     runner->MutableInputs()->Index(0).packets.push_back(
         Adopt(input.release()).At(Timestamp(i)));
   }
@@ -179,6 +185,170 @@ TEST_F(PadLappedTensorBufferCalculatorTest, OneToTwoWithRemainderLarge) {
   CheckOutputs(num_output, runner_.get());
 }
 
+TEST_F(PadLappedTensorBufferCalculatorTest, OneToThreeWithRemainder) {
+  SetUpCalculator();
+  int num_timesteps = 110;
+  int num_output = num_timesteps / kFramesPerProcess
+      + (num_timesteps % kFramesPerProcess != 0);
+
+  SetupInputs(num_timesteps, runner_.get());
+
+  ASSERT_TRUE(runner_->Run().ok());
+
+  CheckOutputs(num_output, runner_.get());
+}
+
+TEST_F(PadLappedTensorBufferCalculatorTest, FrameRange) {
+  SetUpCalculator(/*output_frame_range=*/true);
+  int num_timesteps = 60;
+
+  SetupInputs(num_timesteps, runner_.get());
+
+  ASSERT_TRUE(runner_->Run().ok());
+
+  CheckOutputs(2, runner_.get());
+  const std::vector<Packet>& output_range_packets =
+      runner_->Outputs().Index(2).packets;
+  ASSERT_EQ(2, output_range_packets.size());
+  // The first window is padded before the video, and both are padded after.
+  using FrameRanges = std::vector<std::pair<int, int>>;
+  EXPECT_EQ(FrameRanges({{kNumOfPadding, kNumOfPadding + num_timesteps}}),
+            output_range_packets[0].Get<FrameRanges>());
+  EXPECT_EQ(FrameRanges({{0, num_timesteps - kNumOfPadding}}),
+            output_range_packets[1].Get<FrameRanges>());
+  // The padding repeats the first and the last frame.
+  const auto& window =
+      runner_->Outputs().Index(0).packets[1].Get<tf::Tensor>();
+  const float last_value = window.tensor<float, 2>()(99, 0);
+  EXPECT_EQ(num_timesteps - 1, last_value);
+}
+
+TEST_F(PadLappedTensorBufferCalculatorTest, ReducedOverlap) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("PadLappedTensorBufferCalculator");
+  config.add_input_stream("input_tensor");
+  config.add_output_stream("output_tensor");
+  config.add_output_stream("output_timestamp");
+  config.add_output_stream("output_frame_range");
+  auto* options = config.mutable_options()->MutableExtension(
+      PadLappedTensorBufferCalculatorOptions::ext);
+  options->set_overlap(24);
+  options->set_num_padding(10);
+  options->set_timestamp_offset(10);
+  CalculatorRunner runner(config);
+  const int num_timesteps = 200;
+  SetupInputs(num_timesteps, &runner);
+
+  ASSERT_TRUE(runner.Run().ok());
+
+  // The windows start every 76 frames, from 10 frames before the video, and
+  // the last one decodes the last frame after its first 10 frames.
+  const std::vector<Packet>& output_tensor_packets =
+      runner.Outputs().Index(0).packets;
+  const std::vector<Packet>& output_range_packets =
+      runner.Outputs().Index(2).packets;
+  ASSERT_EQ(3, output_tensor_packets.size());
+  ASSERT_EQ(3, output_range_packets.size());
+  using FrameRanges = std::vector<std::pair<int, int>>;
+  const FrameRanges expected_ranges[] = {{{10, 100}}, {{0, 100}}, {{0, 58}}};
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(expected_ranges[i], output_range_packets[i].Get<FrameRanges>());
+    const auto values =
+        output_tensor_packets[i].Get<tf::Tensor>().tensor<float, 2>();
+    EXPECT_EQ(i * 76, values(10, 0));
+    EXPECT_EQ(Timestamp(i * 76), output_tensor_packets[i].Timestamp());
+  }
+}
+
+TEST_F(PadLappedTensorBufferCalculatorTest, BatchesOfWindows) {
+  SetUpCalculator(/*output_frame_range=*/true, /*windows_per_batch=*/4);
+  int num_timesteps = 260;
+
+  SetupInputs(num_timesteps, runner_.get());
+
+  ASSERT_TRUE(runner_->Run().ok());
+
+  // Six windows, in a full batch and a partial one.
+  const std::vector<Packet>& output_tensor_packets =
+      runner_->Outputs().Index(0).packets;
+  const std::vector<Packet>& output_timestamp_packets =
+      runner_->Outputs().Index(1).packets;
+  const std::vector<Packet>& output_range_packets =
+      runner_->Outputs().Index(2).packets;
+  ASSERT_EQ(2, output_tensor_packets.size());
+  ASSERT_EQ(2, output_timestamp_packets.size());
+  ASSERT_EQ(2, output_range_packets.size());
+  const int batch_sizes[] = {4, 2};
+  for (int batch = 0; batch < 2; ++batch) {
+    const auto& tensor = output_tensor_packets[batch].Get<tf::Tensor>();
+    const auto& time =
+        output_timestamp_packets[batch].Get<std::vector<Timestamp>>();
+    const auto& ranges = output_range_packets[batch]
+                             .Get<std::vector<std::pair<int, int>>>();
+    EXPECT_EQ(tf::TensorShape({batch_sizes[batch], 100, 1}), tensor.shape());
+    ASSERT_EQ(batch_sizes[batch] * 100, time.size());
+    ASSERT_EQ(batch_sizes[batch], ranges.size());
+    const auto values = tensor.tensor<float, 3>();
+    for (int i = 0; i < batch_sizes[batch]; ++i) {
+      const int window = batch * 4 + i;
+      for (int j = 0; j < kFramesPerProcess; ++j) {
+        const int position = j + kNumOfPadding;
+        const int frame = window * kFramesPerProcess + j;
+        if (frame >= num_timesteps) {
+          EXPECT_EQ(Timestamp::Done(), time[i * 100 + position]);
+          continue;
+        }
+        ASSERT_NEAR(frame, values(i, position, 0), 0.0001);
+        EXPECT_EQ(Timestamp(frame), time[i * 100 + position]);
+      }
+    }
+  }
+  EXPECT_EQ(Timestamp(0), output_tensor_packets[0].Timestamp());
+  EXPECT_EQ(Timestamp(200), output_tensor_packets[1].Timestamp());
+}
+
+TEST_F(PadLappedTensorBufferCalculatorTest, ConvertsToFloat) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("PadLappedTensorBufferCalculator");
+  config.add_input_stream("input_tensor");
+  config.add_output_stream("output_tensor");
+  config.add_output_stream("output_timestamp");
+  config.mutable_options()
+      ->MutableExtension(PadLappedTensorBufferCalculatorOptions::ext)
+      ->set_convert_to_float(true);
+  CalculatorRunner runner(config);
+  int num_timesteps = 300;
+  for (int i = 0; i < num_timesteps; ++i) {
+    auto input = ::absl::make_unique<tensorflow::Tensor>(
+        tensorflow::DT_UINT8, tensorflow::TensorShape({3}));
+    input->flat<uint8>().setConstant(i % 256);
+    runner.MutableInputs()->Index(0).packets.push_back(
+        Adopt(input.release()).At(Timestamp(i)));
+  }
+
+  ASSERT_TRUE(runner.Run().ok());
+
+  const std::vector<Packet>& output_tensor_packets =
+      runner.Outputs().Index(0).packets;
+  ASSERT_EQ(6, output_tensor_packets.size());
+  for (int i = 0; i < output_tensor_packets.size(); ++i) {
+    const auto& tensor = output_tensor_packets[i].Get<tf::Tensor>();
+    ASSERT_EQ(tf::DT_FLOAT, tensor.dtype());
+    EXPECT_EQ(tf::TensorShape({100, 3}), tensor.shape());
+    const auto values = tensor.tensor<float, 2>();
+    for (int j = 0; j < kFramesPerProcess; ++j) {
+      const int frame = i * kFramesPerProcess + j;
+      ASSERT_EQ(frame % 256, values(j + kNumOfPadding, 2));
+    }
+  }  // The DT_FLOAT tensors are reused only once released downstream, and the
+  // runner keeps them all.
+  for (int i = 1; i < output_tensor_packets.size(); ++i) {
+    const auto& previous = output_tensor_packets[i - 1].Get<tf::Tensor>();
+    EXPECT_FALSE(previous.SharesBufferWith(
+        output_tensor_packets[i].Get<tf::Tensor>()));
+  }
+}
+
 TEST_F(PadLappedTensorBufferCalculatorTest, LargeInput) {
   SetUpCalculator();
   int num_timesteps = 999;
@@ -192,5 +362,30 @@ TEST_F(PadLappedTensorBufferCalculatorTest, LargeInput) {
   CheckOutputs(num_output, runner_.get());
 }
 
+TEST_F(PadLappedTensorBufferCalculatorTest, WindowsShareTheirFrames) {
+  SetUpCalculator();
+  // 16 floats per frame, so that every window is aligned.
+  int num_timesteps = 500;
+  int num_output = num_timesteps / kFramesPerProcess
+      + (num_timesteps % kFramesPerProcess != 0);
+
+  SetupInputs(num_timesteps, runner_.get(), 16);
+
+  ASSERT_TRUE(runner_->Run().ok());
+
+  CheckOutputs(num_output, runner_.get());
+  // The windows without padding are views of a few buffers, which are not
+  // overwritten while the windows are in use.
+  const std::vector<Packet>& output_tensor_packets =
+      runner_->Outputs().Index(0).packets;
+  EXPECT_TRUE(output_tensor_packets[1].Get<tf::Tensor>().SharesBufferWith(
+      output_tensor_packets[2].Get<tf::Tensor>()));
+  EXPECT_FALSE(output_tensor_packets[1].Get<tf::Tensor>().SharesBufferWith(
+      output_tensor_packets[num_output - 2].Get<tf::Tensor>()));
+  for (const Packet& packet : output_tensor_packets) {
+    EXPECT_EQ(tf::TensorShape({100, 16}), packet.Get<tf::Tensor>().shape());
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,382 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lapped_windows.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/pad_lapped_tensor_buffer_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/resource_util.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/model.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kTensorsTag[] = "TENSORS";
+constexpr char kTimeTag[] = "TIME";
+constexpr char kFrameRangeTag[] = "FRAME_RANGE";
+constexpr int kNumChannels = 3;
+
+}  // namespace
+
+// TensorFlow Lite counterpart of PadLappedTensorBufferCalculator, which feeds
+// TransNetV2 https://github.com/soCzech/TransNetV2 through
+// TfLiteInferenceCalculator, without the TensorFlow runtime.
+//
+// The SRGB input frames are buffered as they are, in a ring of buffer_size
+// frames, and each output window is written into the output tensor. The
+// windows are scheduled and padded like in PadLappedTensorBufferCalculator:
+// the padding before the video repeats the first frame, the padding after it
+// repeats the last frame, and a window is output as soon as its last frame is
+// received.
+//
+// TENSORS holds one tensor of shape
+// [windows_per_batch, buffer_size, height, width, 3], the input shape of the
+// converted model. With convert_to_float, the tensor is kTfLiteFloat32, for
+// the float32 and float16 models. Otherwise it is kTfLiteUInt8, for the int8
+// models with a uint8 input. The pixels are then quantized with the scale and
+// zero point of the input of the model at model_path, which must be the model
+// run on TENSORS, and copied as they are when the scale is 1 and the zero
+// point 0. Without model_path, the model must take the raw pixel values.
+// Since the model has a fixed batch size, the last batch is completed with
+// copies of its last window, and TIME and FRAME_RANGE only cover the real
+// windows of a batch. TIME and FRAME_RANGE are the same as the second and
+// third outputs of PadLappedTensorBufferCalculator.
+//
+// Like TfLiteConverterCalculator, the memory of the output tensors is owned
+// by the calculator. It rotates between num_window_buffers tensors, so an
+// output tensor must be consumed before num_window_buffers more batches are
+// output. TfLiteInferenceCalculator copies its inputs, so it is enough to
+// connect it directly. The windows_per_buffer option is ignored.
+//
+// Example config:
+// node {
+//   calculator: "PadLappedTfLiteTensorBufferCalculator"
+//   input_stream: "IMAGE:transformed_input_video"
+//   output_stream: "TENSORS:lapped_feature_tensors"
+//   output_stream: "TIME:time_stamp"
+//   output_stream: "FRAME_RANGE:frame_range"
+//   options {
+//     [mediapipe.PadLappedTensorBufferCalculatorOptions.ext] {
+//       buffer_size: 100
+//       overlap: 50
+//       timestamp_offset: 25
+//       convert_to_float: true
+//     }
+//   }
+// }
+class PadLappedTfLiteTensorBufferCalculator : public CalculatorBase {
+ public:
+  static ::mediapipe::Status GetContract(CalculatorContract* cc);
+
+  ::mediapipe::Status Open(CalculatorContext* cc) override;
+  ::mediapipe::Status Process(CalculatorContext* cc) override;
+  ::mediapipe::Status Close(CalculatorContext* cc) override;
+
+ private:
+  // Allocates the frame ring and the output tensors for frames like the
+  // given one.
+  ::mediapipe::Status Initialize(const ImageFrame& frame);
+  // Copies a frame into the ring.
+  ::mediapipe::Status AppendFrame(const ImageFrame& frame);
+  // Writes the next window into the pending batch, and outputs the batch
+  // when it is full.
+  ::mediapipe::Status ProcessWindow(CalculatorContext* cc);
+  // Outputs the pending batch of windows.
+  ::mediapipe::Status OutputBatch(CalculatorContext* cc);
+  // Reads the quantization of the uint8 input of the model at model_path,
+  // and fills quantized_pixels_ if the pixels need to be quantized.
+  ::mediapipe::Status ReadInputQuantization();
+
+  PadLappedTensorBufferCalculatorOptions options_;
+  std::unique_ptr<LappedWindows> windows_;
+  int num_of_frames_ = 0;
+  // Timestamp of the first frame, also used for the padding before it.
+  Timestamp first_timestamp_;
+  // The timestamps of the last buffer_size frames, the oldest first.
+  std::vector<Timestamp> recent_timestamps_;
+
+  int frame_width_;
+  int frame_height_;
+  // Number of values of a frame.
+  int frame_size_;
+  // Size of the values of the output tensors.
+  int value_bytes_;
+  // The last buffer_size frames, frame i is at i % buffer_size.
+  std::vector<uint8> frames_;
+  // The quantized value of each pixel value for the uint8 input of the
+  // model, or empty when the pixels are copied as they are.
+  std::vector<uint8> quantized_pixels_;
+
+  // The output tensors are allocated by interpreters, as in
+  // TfLiteConverterCalculator. They are used in turn.
+  std::vector<std::unique_ptr<tflite::Interpreter>> tensor_allocators_;
+  int current_tensor_ = 0;
+  // Number of windows written into the current tensor.
+  int num_batch_windows_ = 0;
+  std::unique_ptr<std::vector<Timestamp>> batch_timestamps_;
+  std::unique_ptr<std::vector<std::pair<int, int>>> batch_frame_ranges_;
+  Timestamp batch_timestamp_;
+};
+
+REGISTER_CALCULATOR(PadLappedTfLiteTensorBufferCalculator);
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::GetContract(
+    CalculatorContract* cc) {
+  cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+  cc->Outputs().Tag(kTensorsTag).Set<std::vector<TfLiteTensor>>();
+  cc->Outputs().Tag(kTimeTag).Set<std::vector<Timestamp>>();
+  if (cc->Outputs().HasTag(kFrameRangeTag)) {
+    cc->Outputs().Tag(kFrameRangeTag).Set<std::vector<std::pair<int, int>>>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::Open(
+    CalculatorContext* cc) {
+  options_ = cc->Options<PadLappedTensorBufferCalculatorOptions>();
+  RET_CHECK_LT(options_.overlap(), options_.buffer_size());
+  RET_CHECK_GE(options_.num_padding(), 0)
+      << "Negative num_padding is not allowed.";
+  RET_CHECK_GT(options_.buffer_size(), options_.num_padding())
+      << "buffer_size has to be larger than the padding.";
+  RET_CHECK_GE(options_.timestamp_offset(), 0)
+      << "Negative timestamp_offset is not allowed.";
+  RET_CHECK_LT(options_.timestamp_offset(), options_.buffer_size())
+      << "timestamp_offset has to be less than buffer_size.";
+  RET_CHECK_GE(options_.windows_per_batch(), 1);
+  RET_CHECK_GE(options_.num_window_buffers(), 1);
+  windows_ = absl::make_unique<LappedWindows>(
+      options_.buffer_size(), options_.overlap(), options_.num_padding());
+  if (!options_.convert_to_float() && options_.has_model_path()) {
+    MP_RETURN_IF_ERROR(ReadInputQuantization());
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status
+PadLappedTfLiteTensorBufferCalculator::ReadInputQuantization() {
+  ASSIGN_OR_RETURN(const std::string model_path,
+                   PathToResourceAsFile(options_.model_path()));
+  const auto model =
+      tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+  RET_CHECK(model) << "Failed to load the model at " << model_path;
+  const tflite::Model* flatbuffer = model->GetModel();
+  RET_CHECK(flatbuffer->subgraphs() != nullptr &&
+            flatbuffer->subgraphs()->size() > 0);
+  const tflite::SubGraph* subgraph = flatbuffer->subgraphs()->Get(0);
+  RET_CHECK(subgraph->inputs() != nullptr && subgraph->inputs()->size() > 0);
+  const tflite::Tensor* input =
+      subgraph->tensors()->Get(subgraph->inputs()->Get(0));
+  RET_CHECK_EQ(input->type(), tflite::TensorType_UINT8)
+      << "Without convert_to_float, the model input must be uint8.";
+
+  float scale = 1.0f;
+  int64 zero_point = 0;
+  const tflite::QuantizationParameters* quantization = input->quantization();
+  if (quantization != nullptr && quantization->scale() != nullptr &&
+      quantization->scale()->size() > 0) {
+    RET_CHECK_EQ(quantization->scale()->size(), 1)
+        << "The model input must be quantized per tensor.";
+    scale = quantization->scale()->Get(0);
+    if (quantization->zero_point() != nullptr &&
+        quantization->zero_point()->size() > 0) {
+      zero_point = quantization->zero_point()->Get(0);
+    }
+  }
+  RET_CHECK_GT(scale, 0.0f);
+  quantized_pixels_.clear();
+  if (scale == 1.0f && zero_point == 0) {
+    return ::mediapipe::OkStatus();
+  }
+  quantized_pixels_.resize(256);
+  for (int pixel = 0; pixel < 256; ++pixel) {
+    const int64 quantized = std::llround(pixel / scale) + zero_point;
+    quantized_pixels_[pixel] = static_cast<uint8>(
+        std::min<int64>(std::max<int64>(quantized, 0), 255));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::Process(
+    CalculatorContext* cc) {
+  const auto& frame = cc->Inputs().Tag(kImageTag).Get<ImageFrame>();
+  if (num_of_frames_ == 0) {
+    MP_RETURN_IF_ERROR(Initialize(frame));
+    first_timestamp_ = cc->InputTimestamp();
+  }
+  MP_RETURN_IF_ERROR(AppendFrame(frame));
+  if (recent_timestamps_.size() == options_.buffer_size()) {
+    recent_timestamps_.erase(recent_timestamps_.begin());
+  }
+  recent_timestamps_.push_back(cc->InputTimestamp());
+  ++num_of_frames_;
+
+  // The window is output as soon as its last frame is received.
+  if (windows_->IsNextWindowComplete(num_of_frames_)) {
+    MP_RETURN_IF_ERROR(ProcessWindow(cc));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::Close(
+    CalculatorContext* cc) {
+  while (windows_->IsNextWindowNeeded(num_of_frames_)) {
+    MP_RETURN_IF_ERROR(ProcessWindow(cc));
+  }
+  if (num_batch_windows_ > 0) {
+    MP_RETURN_IF_ERROR(OutputBatch(cc));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::Initialize(
+    const ImageFrame& frame) {
+  RET_CHECK_EQ(frame.Format(), ImageFormat::SRGB)
+      << "Only SRGB frames are supported.";
+  frame_width_ = frame.Width();
+  frame_height_ = frame.Height();
+  frame_size_ = frame_width_ * frame_height_ * kNumChannels;
+  frames_.resize(static_cast<size_t>(options_.buffer_size()) * frame_size_);
+
+  const std::vector<int> shape = {options_.windows_per_batch(),
+                                  options_.buffer_size(), frame_height_,
+                                  frame_width_, kNumChannels};
+  const TfLiteType type =
+      options_.convert_to_float() ? kTfLiteFloat32 : kTfLiteUInt8;
+  value_bytes_ = options_.convert_to_float() ? sizeof(float) : sizeof(uint8);
+  tensor_allocators_.clear();
+  for (int i = 0; i < options_.num_window_buffers(); ++i) {
+    auto interpreter = absl::make_unique<tflite::Interpreter>();
+    interpreter->AddTensors(1);
+    interpreter->SetInputs({0});
+    interpreter->SetTensorParametersReadWrite(0, type, "", shape,
+                                              TfLiteQuantization());
+    RET_CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+    tensor_allocators_.push_back(std::move(interpreter));
+  }
+  current_tensor_ = 0;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::AppendFrame(
+    const ImageFrame& frame) {
+  RET_CHECK(frame.Format() == ImageFormat::SRGB &&
+            frame.Width() == frame_width_ && frame.Height() == frame_height_)
+      << "All the input frames must have the same format and size.";
+  uint8* dst = &frames_[static_cast<size_t>(num_of_frames_ %
+                                            options_.buffer_size()) *
+                        frame_size_];
+  const int row_size = frame_width_ * kNumChannels;
+  for (int y = 0; y < frame_height_; ++y) {
+    std::memcpy(dst + y * row_size,
+                frame.PixelData() + y * frame.WidthStep(), row_size);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::ProcessWindow(
+    CalculatorContext* cc) {
+  const LappedWindow window = windows_->PopWindow(num_of_frames_);
+  RET_CHECK_EQ(window.real_end, num_of_frames_);
+
+  if (num_batch_windows_ == 0) {
+    batch_timestamps_ = absl::make_unique<std::vector<Timestamp>>();
+    batch_frame_ranges_ =
+        absl::make_unique<std::vector<std::pair<int, int>>>();
+  }
+  TfLiteTensor* tensor = tensor_allocators_[current_tensor_]->tensor(0);
+  char* window_data = static_cast<char*>(tensor->data.raw) +
+                      static_cast<size_t>(num_batch_windows_) *
+                          options_.buffer_size() * frame_size_ * value_bytes_;
+  for (int i = window.begin; i < window.end; ++i) {
+    // The padding frames are copies of the first or last frame.
+    const int frame_index =
+        std::min(std::max(i, window.real_begin), window.real_end - 1);
+    const uint8* pixels = &frames_[static_cast<size_t>(
+                                       frame_index % options_.buffer_size()) *
+                                   frame_size_];
+    if (options_.convert_to_float()) {
+      std::copy(pixels, pixels + frame_size_,
+                reinterpret_cast<float*>(window_data));
+    } else if (!quantized_pixels_.empty()) {
+      uint8* quantized = reinterpret_cast<uint8*>(window_data);
+      for (int j = 0; j < frame_size_; ++j) {
+        quantized[j] = quantized_pixels_[pixels[j]];
+      }
+    } else {
+      std::memcpy(window_data, pixels, frame_size_);
+    }
+    window_data += frame_size_ * value_bytes_;
+  }
+  ++num_batch_windows_;
+
+  AppendWindowTimestamps(window, first_timestamp_, recent_timestamps_,
+                         batch_timestamps_.get());
+  batch_frame_ranges_->emplace_back(window.real_begin - window.begin,
+                                    window.real_end - window.begin);
+  // The batch is output at the timestamp of its first window.
+  if (num_batch_windows_ == 1) {
+    batch_timestamp_ = (*batch_timestamps_)[options_.timestamp_offset()];
+  }
+
+  if (num_batch_windows_ == options_.windows_per_batch()) {
+    MP_RETURN_IF_ERROR(OutputBatch(cc));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTfLiteTensorBufferCalculator::OutputBatch(
+    CalculatorContext* cc) {
+  TfLiteTensor* tensor = tensor_allocators_[current_tensor_]->tensor(0);
+  // The model has a fixed batch size: the batch is completed with copies of
+  // its last window.
+  const size_t window_bytes =
+      static_cast<size_t>(options_.buffer_size()) * frame_size_ * value_bytes_;
+  char* data = static_cast<char*>(tensor->data.raw);
+  for (int i = num_batch_windows_; i < options_.windows_per_batch(); ++i) {
+    std::memcpy(data + i * window_bytes,
+                data + (num_batch_windows_ - 1) * window_bytes, window_bytes);
+  }
+  num_batch_windows_ = 0;
+  current_tensor_ = (current_tensor_ + 1) % tensor_allocators_.size();
+
+  auto output_tensors = absl::make_unique<std::vector<TfLiteTensor>>();
+  output_tensors->emplace_back(*tensor);
+  cc->Outputs().Tag(kTensorsTag).Add(output_tensors.release(),
+                                     batch_timestamp_);
+  cc->Outputs().Tag(kTimeTag).Add(batch_timestamps_.release(),
+                                  batch_timestamp_);
+  if (cc->Outputs().HasTag(kFrameRangeTag)) {
+    cc->Outputs().Tag(kFrameRangeTag).Add(batch_frame_ranges_.release(),
+                                          batch_timestamp_);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,354 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/pad_lapped_tensor_buffer_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace mediapipe {
+
+namespace {
+
+namespace tf = ::tensorflow;
+
+// The rows of the frames are padded in the ImageFrame, but not in the
+// tensors.
+const int kWidth = 5;
+const int kHeight = 3;
+const int kFrameSize = kWidth * kHeight * 3;
+const int kWindowSize = 100 * kFrameSize;
+
+// Both buffer calculators read the same frames, as ImageFrame and as the
+// DT_UINT8 tensors of ImageFrameToTensorCalculator.
+constexpr char kGraphConfig[] = R"(
+    input_stream: "image"
+    input_stream: "image_tensor"
+    node {
+      calculator: "PadLappedTensorBufferCalculator"
+      input_stream: "image_tensor"
+      output_stream: "tf_windows"
+      output_stream: "tf_time"
+      output_stream: "tf_frame_range"
+      options {
+        [mediapipe.PadLappedTensorBufferCalculatorOptions.ext] {
+          convert_to_float: true
+        }
+      }
+    }
+    node {
+      calculator: "PadLappedTfLiteTensorBufferCalculator"
+      input_stream: "IMAGE:image"
+      output_stream: "TENSORS:tflite_windows"
+      output_stream: "TIME:tflite_time"
+      output_stream: "FRAME_RANGE:tflite_frame_range"
+      options {
+        [mediapipe.PadLappedTensorBufferCalculatorOptions.ext] {
+          convert_to_float: true
+        }
+      }
+    })";
+
+struct Windows {
+  // The windows of every batch, flattened, and the shape of the batches.
+  std::vector<std::vector<float>> batches;
+  std::vector<std::vector<int>> shapes;
+  std::vector<Timestamp> batch_timestamps;
+  std::vector<std::vector<Timestamp>> times;
+  std::vector<std::vector<std::pair<int, int>>> frame_ranges;
+  // The types and the addresses of the TfLite tensors.
+  std::vector<TfLiteType> types;
+  std::vector<const void*> data;
+};
+
+uint8 Pixel(int frame, int i) { return (frame * 7 + i * 13) % 256; }
+
+// Writes a model with only an input tensor of the type, quantized with the
+// scale and zero point if scale is positive, and returns its path.
+std::string WriteInputModel(tflite::TensorType type, float scale,
+                            int64 zero_point) {
+  flatbuffers::FlatBufferBuilder builder;
+  flatbuffers::Offset<tflite::QuantizationParameters> quantization;
+  if (scale > 0) {
+    quantization = tflite::CreateQuantizationParameters(
+        builder, /*min=*/0, /*max=*/0, builder.CreateVector<float>({scale}),
+        builder.CreateVector<int64_t>({zero_point}));
+  }
+  const auto tensor = tflite::CreateTensor(
+      builder, builder.CreateVector<int32_t>({1, 100, kHeight, kWidth, 3}),
+      type, /*buffer=*/0, /*name=*/0, quantization);
+  const auto subgraph = tflite::CreateSubGraph(
+      builder,
+      builder.CreateVector(
+          std::vector<flatbuffers::Offset<tflite::Tensor>>({tensor})),
+      builder.CreateVector<int32_t>({0}), builder.CreateVector<int32_t>({0}));
+  const auto model = tflite::CreateModel(
+      builder, TFLITE_SCHEMA_VERSION, /*operator_codes=*/0,
+      builder.CreateVector(
+          std::vector<flatbuffers::Offset<tflite::SubGraph>>({subgraph})),
+      /*description=*/0,
+      builder.CreateVector(std::vector<flatbuffers::Offset<tflite::Buffer>>(
+          {tflite::CreateBuffer(builder)})));
+  tflite::FinishModelBuffer(builder, model);
+  const std::string path = ::testing::TempDir() + "/input_model.tflite";
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+             builder.GetSize());
+  return path;
+}
+
+// Runs both calculators on num_frames frames. The TensorFlow windows are
+// always converted to float.
+void RunBufferCalculators(int num_frames, int windows_per_batch,
+                          int num_window_buffers, Windows* tf_windows,
+                          Windows* tflite_windows,
+                          bool convert_to_float = true,
+                          const std::string& model_path = "") {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraphConfig);
+  for (auto& node : *config.mutable_node()) {
+    auto* options = node.mutable_options()->MutableExtension(
+        PadLappedTensorBufferCalculatorOptions::ext);
+    options->set_windows_per_batch(windows_per_batch);
+    options->set_num_window_buffers(num_window_buffers);
+  }
+  config.mutable_node(1)
+      ->mutable_options()
+      ->MutableExtension(PadLappedTensorBufferCalculatorOptions::ext)
+      ->set_convert_to_float(convert_to_float);
+  if (!model_path.empty()) {
+    config.mutable_node(1)
+        ->mutable_options()
+        ->MutableExtension(PadLappedTensorBufferCalculatorOptions::ext)
+        ->set_model_path(model_path);
+  }
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "tf_windows", [tf_windows](const Packet& packet) {
+        const auto& tensor = packet.Get<tf::Tensor>();
+        const float* values = tensor.flat<float>().data();
+        tf_windows->batches.emplace_back(values,
+                                         values + tensor.NumElements());
+        std::vector<int> shape;
+        for (int i = 0; i < tensor.dims(); ++i) {
+          shape.push_back(tensor.dim_size(i));
+        }
+        tf_windows->shapes.push_back(shape);
+        tf_windows->batch_timestamps.push_back(packet.Timestamp());
+        return ::mediapipe::OkStatus();
+      }));
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "tflite_windows",
+      [tflite_windows](const Packet& packet) -> ::mediapipe::Status {
+        // The tensor is only valid until a few more batches are output.
+        const auto& tensors = packet.Get<std::vector<TfLiteTensor>>();
+        RET_CHECK_EQ(1, tensors.size());
+        if (tensors[0].type == kTfLiteFloat32) {
+          const float* values = tensors[0].data.f;
+          tflite_windows->batches.emplace_back(
+              values, values + tensors[0].bytes / sizeof(float));
+        } else {
+          RET_CHECK_EQ(kTfLiteUInt8, tensors[0].type);
+          const uint8* values = tensors[0].data.uint8;
+          tflite_windows->batches.emplace_back(values,
+                                               values + tensors[0].bytes);
+        }
+        tflite_windows->types.push_back(tensors[0].type);
+        tflite_windows->shapes.emplace_back(
+            tensors[0].dims->data,
+            tensors[0].dims->data + tensors[0].dims->size);
+        tflite_windows->batch_timestamps.push_back(packet.Timestamp());
+        tflite_windows->data.push_back(tensors[0].data.raw);
+        return ::mediapipe::OkStatus();
+      }));
+  const std::vector<std::pair<std::string, Windows*>> time_streams = {
+      {"tf", tf_windows}, {"tflite", tflite_windows}};
+  for (const auto& stream : time_streams) {
+    Windows* windows = stream.second;
+    MP_ASSERT_OK(graph.ObserveOutputStream(
+        stream.first + "_time", [windows](const Packet& packet) {
+          windows->times.push_back(packet.Get<std::vector<Timestamp>>());
+          return ::mediapipe::OkStatus();
+        }));
+    MP_ASSERT_OK(graph.ObserveOutputStream(
+        stream.first + "_frame_range", [windows](const Packet& packet) {
+          windows->frame_ranges.push_back(
+              packet.Get<std::vector<std::pair<int, int>>>());
+          return ::mediapipe::OkStatus();
+        }));
+  }
+
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int frame = 0; frame < num_frames; ++frame) {
+    auto image = absl::make_unique<ImageFrame>(ImageFormat::SRGB, kWidth,
+                                               kHeight);
+    auto tensor = absl::make_unique<tf::Tensor>(
+        tf::DT_UINT8, tf::TensorShape({kHeight, kWidth, 3}));
+    uint8* tensor_data = tensor->flat<uint8>().data();
+    for (int y = 0; y < kHeight; ++y) {
+      for (int x = 0; x < kWidth * 3; ++x) {
+        const int i = y * kWidth * 3 + x;
+        image->MutablePixelData()[y * image->WidthStep() + x] =
+            Pixel(frame, i);
+        tensor_data[i] = Pixel(frame, i);
+      }
+    }
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "image", Adopt(image.release()).At(Timestamp(frame))));
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "image_tensor", Adopt(tensor.release()).At(Timestamp(frame))));
+  }
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+// Checks that both buffer calculators feed the same window contents, TIME
+// and FRAME_RANGE to their models. This does not run any model: the
+// accuracy of the TfLite boundaries is measured by
+// shot_boundary_backend_benchmark on a real video.
+void ExpectTheWindowBuffersOfTheTensorFlowPath(bool convert_to_float) {
+  for (const int num_frames : {1, 60, 99, 100, 260}) {
+    for (const int windows_per_batch : {1, 4}) {
+      Windows tf_windows;
+      Windows tflite_windows;
+      RunBufferCalculators(num_frames, windows_per_batch,
+                           /*num_window_buffers=*/2, &tf_windows,
+                           &tflite_windows, convert_to_float);
+      ASSERT_FALSE(tf_windows.batches.empty());
+      EXPECT_THAT(tflite_windows.types,
+                  ::testing::Each(convert_to_float ? kTfLiteFloat32
+                                                   : kTfLiteUInt8));
+      ASSERT_EQ(tf_windows.batches.size(), tflite_windows.batches.size());
+      EXPECT_EQ(tf_windows.batch_timestamps, tflite_windows.batch_timestamps);
+      EXPECT_EQ(tf_windows.times, tflite_windows.times);
+      EXPECT_EQ(tf_windows.frame_ranges, tflite_windows.frame_ranges);
+      for (int batch = 0; batch < tf_windows.batches.size(); ++batch) {
+        const std::vector<int> expected_shape = {windows_per_batch, 100,
+                                                 kHeight, kWidth, 3};
+        EXPECT_EQ(expected_shape, tflite_windows.shapes[batch]);
+        // The last batch of the TensorFlow path may have fewer windows.
+        const std::vector<float>& expected = tf_windows.batches[batch];
+        const std::vector<float>& windows = tflite_windows.batches[batch];
+        ASSERT_EQ(0, expected.size() % kWindowSize);
+        ASSERT_LE(expected.size(), windows.size());
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(),
+                               windows.begin()))
+            << num_frames << " frames, batch " << batch;
+      }
+    }
+  }
+}
+
+TEST(PadLappedTfLiteTensorBufferCalculatorTest, FloatWindowBuffersMatch) {
+  ExpectTheWindowBuffersOfTheTensorFlowPath(/*convert_to_float=*/true);
+}
+
+TEST(PadLappedTfLiteTensorBufferCalculatorTest, Uint8WindowBuffersMatch) {
+  ExpectTheWindowBuffersOfTheTensorFlowPath(/*convert_to_float=*/false);
+}
+
+TEST(PadLappedTfLiteTensorBufferCalculatorTest, CompletesTheLastBatch) {
+  Windows tf_windows;
+  Windows tflite_windows;
+  // Six windows, in a full batch and a partial one.
+  RunBufferCalculators(/*num_frames=*/260, /*windows_per_batch=*/4,
+                       /*num_window_buffers=*/2, &tf_windows, &tflite_windows);
+  ASSERT_EQ(2, tflite_windows.batches.size());
+  ASSERT_EQ(200, tflite_windows.times[1].size());
+  ASSERT_EQ(2, tflite_windows.frame_ranges[1].size());
+  const std::vector<float>& batch = tflite_windows.batches[1];
+  ASSERT_EQ(4 * kWindowSize, batch.size());
+  for (int window = 2; window < 4; ++window) {
+    EXPECT_TRUE(std::equal(batch.begin() + kWindowSize,
+                           batch.begin() + 2 * kWindowSize,
+                           batch.begin() + window * kWindowSize));
+  }
+}
+
+TEST(PadLappedTfLiteTensorBufferCalculatorTest, RotatesTheOutputTensors) {
+  Windows tf_windows;
+  Windows tflite_windows;
+  RunBufferCalculators(/*num_frames=*/500, /*windows_per_batch=*/1,
+                       /*num_window_buffers=*/3, &tf_windows, &tflite_windows);
+  const std::vector<const void*>& data = tflite_windows.data;
+  ASSERT_EQ(10, data.size());
+  for (int i = 0; i + 3 < data.size(); ++i) {
+    EXPECT_NE(data[i], data[i + 1]);
+    EXPECT_NE(data[i], data[i + 2]);
+    EXPECT_EQ(data[i], data[i + 3]);
+  }
+}
+
+// The uint8 windows of an int8 model are quantized with its input parameters.
+TEST(PadLappedTfLiteTensorBufferCalculatorTest, QuantizesTheUint8Windows) {
+  const float kScale = 0.5f;
+  const int64 kZeroPoint = 10;
+  const std::string model_path =
+      WriteInputModel(tflite::TensorType_UINT8, kScale, kZeroPoint);
+  Windows tf_windows;
+  Windows tflite_windows;
+  RunBufferCalculators(/*num_frames=*/150, /*windows_per_batch=*/1,
+                       /*num_window_buffers=*/2, &tf_windows, &tflite_windows,
+                       /*convert_to_float=*/false, model_path);
+  ASSERT_EQ(tf_windows.batches.size(), tflite_windows.batches.size());
+  for (int batch = 0; batch < tf_windows.batches.size(); ++batch) {
+    const std::vector<float>& pixels = tf_windows.batches[batch];
+    const std::vector<float>& quantized = tflite_windows.batches[batch];
+    ASSERT_EQ(pixels.size(), quantized.size());
+    for (int i = 0; i < pixels.size(); ++i) {
+      const float expected =
+          std::min(255.0f, std::round(pixels[i] / kScale) + kZeroPoint);
+      ASSERT_EQ(expected, quantized[i]) << "batch " << batch << ", value " << i;
+    }
+  }
+}
+
+TEST(PadLappedTfLiteTensorBufferCalculatorTest, RejectsAFloatModelInput) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+    calculator: "PadLappedTfLiteTensorBufferCalculator"
+    input_stream: "IMAGE:image"
+    output_stream: "TENSORS:tensors"
+    output_stream: "TIME:time"
+  )");
+  config.mutable_options()
+      ->MutableExtension(PadLappedTensorBufferCalculatorOptions::ext)
+      ->set_model_path(WriteInputModel(tflite::TensorType_FLOAT32, 0, 0));
+  CalculatorRunner runner(config);
+  runner.MutableInputs()->Tag("IMAGE").packets.push_back(
+      Adopt(new ImageFrame(ImageFormat::SRGB, kWidth, kHeight))
+          .At(Timestamp(0)));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,262 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs the shot boundary detection subgraphs on the frames of a video, and
+// reports for each backend the initialization time, the frames per second
+// and the peak RSS of the process. The backends are the TensorFlow model
+// (tf), and its TensorFlow Lite conversions in float32 (tflite), float16
+// (fp16) and int8 (int8), the TensorFlow model on windows with less
+// overlap (overlap), and the TensorFlow model on the windows which the frame
+// change scores gate (cascade). The shot boundaries of each backend are compared
+// with those of the first one, the float32 reference, as precision, recall
+// and F1 score within --tolerance_frames frames:
+//
+// bazel build -c opt --define MEDIAPIPE_DISABLE_GPU=1 \
+//   mediapipe/examples/desktop/autoflip/calculators:shot_boundary_backend_benchmark
+// bazel-bin/mediapipe/examples/desktop/autoflip/calculators/shot_boundary_backend_benchmark \
+//   --input_video_path=/absolute/path/to/the/local/video/file
+//
+// Without --input_video_path, the frames are a labelled synthetic sequence
+// of cuts and dissolves (see synthetic_shots.h), and the boundaries of every
+// backend are also scored against the labels. The cascade runs the model
+// less on long shots, for example:
+//   --backends=tf,cascade --num_synthetic_shots=4 --min_shot_frames=1000 \
+//   --max_shot_frames=2000
+//
+// The frames are decoded and scaled to 48x27 before the graphs run, so that
+// only the detection is measured. The peak RSS only grows during a process:
+// run the backends one at a time with --backends to compare their memory.
+
+#include <sys/resource.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_shots.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/opencv_video_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(input_video_path, "",
+              "The video to detect the shots of. A synthetic sequence is "
+              "generated if empty.");
+DEFINE_string(backends, "tf,tflite,fp16,int8",
+              "Comma-separated backends to run, among tf, tflite, fp16, int8, "
+              "overlap and cascade. The first one is the reference of the "
+              "comparison.");
+DEFINE_int32(max_frames, 0, "If positive, only the first frames are read.");
+DEFINE_int32(tolerance_frames, 2,
+             "Boundaries at most this many frames apart are the same.");
+DEFINE_int32(num_synthetic_shots, 100,
+             "Number of shots of the synthetic sequence.");
+DEFINE_int32(min_shot_frames, 40,
+             "Minimum number of frames of the synthetic shots.");
+DEFINE_int32(max_shot_frames, 160,
+             "Maximum number of frames of the synthetic shots.");
+DEFINE_double(dissolve_fraction, 0.3,
+              "Fraction of the synthetic transitions which are dissolves.");
+DEFINE_int32(seed, 0, "Seed of the synthetic sequence.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kGraphConfig[] = R"(
+    input_stream: "input_video"
+    output_stream: "shot_change"
+    node {
+      calculator: "$SUBGRAPH"
+      input_stream: "VIDEO:input_video"
+      output_stream: "IS_SHOT_CHANGE:shot_change"
+    })";
+
+const std::map<std::string, std::string>& Subgraphs() {
+  static const auto* subgraphs = new std::map<std::string, std::string>{
+      {"tf", "AutoFlipShotBoundaryDetectionSubgraph"},
+      {"tflite", "AutoFlipShotBoundaryDetectionTfLiteSubgraph"},
+      {"fp16", "AutoFlipShotBoundaryDetectionFp16Subgraph"},
+      {"int8", "AutoFlipShotBoundaryDetectionInt8Subgraph"},
+      {"overlap", "AutoFlipShotBoundaryDetectionReducedOverlapSubgraph"},
+      {"cascade", "AutoFlipShotBoundaryDetectionCascadeSubgraph"}};
+  return *subgraphs;
+}
+
+// Peak resident set size of the process, in MB.
+double PeakRssMb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in KB on Linux.
+  return usage.ru_maxrss / 1024.0;
+}
+
+// Decodes the frames of the video, scaled to the input size of TransNetV2.
+::mediapipe::Status ReadFrames(const std::string& path,
+                               std::vector<Packet>* frames) {
+  cv::VideoCapture capture(path);
+  RET_CHECK(capture.isOpened()) << "Cannot open " << path;
+  const double fps = capture.get(cv::CAP_PROP_FPS);
+  RET_CHECK_GT(fps, 0.0) << "Unknown frame rate.";
+  cv::Mat bgr;
+  while ((FLAGS_max_frames <= 0 || frames->size() < FLAGS_max_frames) &&
+         capture.read(bgr)) {
+    auto frame = absl::make_unique<ImageFrame>(ImageFormat::SRGB, 48, 27);
+    cv::Mat rgb = formats::MatView(frame.get());
+    cv::Mat scaled;
+    cv::resize(bgr, scaled, rgb.size(), 0, 0, cv::INTER_LINEAR);
+    cv::cvtColor(scaled, rgb, cv::COLOR_BGR2RGB);
+    const Timestamp timestamp(std::llround(frames->size() * 1e6 / fps));
+    frames->push_back(Adopt(frame.release()).At(timestamp));
+  }
+  RET_CHECK(!frames->empty()) << "No frame in " << path;
+  return ::mediapipe::OkStatus();
+}
+
+// Generates the frames of a synthetic sequence at 30 frames per second.
+void GenerateFrames(std::vector<Packet>* frames,
+                    std::vector<ShotTransition>* transitions) {
+  SyntheticShotOptions options;
+  options.num_shots = FLAGS_num_synthetic_shots;
+  options.min_shot_frames = FLAGS_min_shot_frames;
+  options.max_shot_frames = FLAGS_max_shot_frames;
+  options.dissolve_fraction = FLAGS_dissolve_fraction;
+  options.seed = FLAGS_seed;
+  std::vector<ImageFrame> images;
+  GenerateSyntheticShots(options, &images, transitions);
+  for (ImageFrame& image : images) {
+    const Timestamp timestamp(std::llround(frames->size() * 1e6 / 30.0));
+    frames->push_back(Adopt(new ImageFrame(std::move(image))).At(timestamp));
+  }
+}
+
+// Runs a backend on the frames, and returns the indices of the frames
+// starting a shot.
+::mediapipe::Status RunBackend(const std::string& backend,
+                               const std::vector<Packet>& frames,
+                               std::vector<int>* boundaries) {
+  const auto subgraph = Subgraphs().find(backend);
+  RET_CHECK(subgraph != Subgraphs().end()) << "Unknown backend " << backend;
+  std::string config_text = kGraphConfig;
+  config_text.replace(config_text.find("$SUBGRAPH"), 9, subgraph->second);
+
+  std::map<int64, int> frame_indices;
+  for (int i = 0; i < frames.size(); ++i) {
+    frame_indices[frames[i].Timestamp().Value()] = i;
+  }
+  const absl::Time start = absl::Now();
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(
+      ParseTextProtoOrDie<CalculatorGraphConfig>(config_text)));
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      "shot_change", [&](const Packet& packet) {
+        if (packet.Get<bool>()) {
+          boundaries->push_back(frame_indices[packet.Timestamp().Value()]);
+        }
+        return ::mediapipe::OkStatus();
+      }));
+  MP_RETURN_IF_ERROR(graph.StartRun({}));
+  const absl::Time started = absl::Now();
+  for (const Packet& frame : frames) {
+    MP_RETURN_IF_ERROR(graph.AddPacketToInputStream("input_video", frame));
+  }
+  MP_RETURN_IF_ERROR(graph.CloseAllInputStreams());
+  MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+  const absl::Time done = absl::Now();
+
+  std::cout << backend << ": initialization "
+            << absl::ToDoubleMilliseconds(started - start) << " ms, "
+            << frames.size() / absl::ToDoubleSeconds(done - started)
+            << " frames/s, " << boundaries->size()
+            << " boundaries, peak RSS " << PeakRssMb() << " MB" << std::endl;
+  return ::mediapipe::OkStatus();
+}
+
+void PrintScore(const std::string& backend, const std::string& reference,
+                const BoundaryScore& score) {
+  std::cout << backend << " against " << reference << ": precision "
+            << score.precision << ", recall " << score.recall << ", F1 "
+            << score.f1 << std::endl;
+}
+
+::mediapipe::Status RunBenchmark() {
+  std::vector<Packet> frames;
+  std::vector<ShotTransition> labels;
+  const bool synthetic = FLAGS_input_video_path.empty();
+  if (synthetic) {
+    GenerateFrames(&frames, &labels);
+    std::cout << "Synthetic transitions: " << labels.size() << std::endl;
+  } else {
+    MP_RETURN_IF_ERROR(ReadFrames(FLAGS_input_video_path, &frames));
+  }
+  std::cout << "Frames: " << frames.size() << std::endl;
+
+  const std::vector<std::string> backends =
+      absl::StrSplit(FLAGS_backends, ',', absl::SkipEmpty());
+  std::vector<ShotTransition> reference;
+  for (int i = 0; i < backends.size(); ++i) {
+    std::vector<int> boundaries;
+    MP_RETURN_IF_ERROR(RunBackend(backends[i], frames, &boundaries));
+    if (synthetic) {
+      PrintScore(backends[i], "the labels",
+                 ScoreBoundaries(labels, boundaries, FLAGS_tolerance_frames));
+    }
+    if (i == 0) {
+      // Boundaries of consecutive frames are one transition of the reference.
+      for (const int boundary : boundaries) {
+        if (!reference.empty() && reference.back().end + 1 == boundary) {
+          reference.back().end = boundary;
+        } else {
+          reference.push_back({boundary, boundary});
+        }
+      }
+    } else {
+      PrintScore(backends[i], backends[0],
+                 ScoreBoundaries(reference, boundaries,
+                                 FLAGS_tolerance_frames));
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::Status run_status = ::mediapipe::autoflip::RunBenchmark();
+  if (!run_status.ok()) {
+    LOG(ERROR) << "Failed to run the benchmark: " << run_status.message();
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -12,39 +12,98 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <vector>
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
 
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_decoder_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_segment.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/timestamp.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/lite/interpreter.h"
 
 // IO labels.
 constexpr char kInputPrediction[] = "PREDICTION";
+constexpr char kInputTensor[] = "TENSOR";
+constexpr char kInputTensors[] = "TENSORS";
 constexpr char kInputTimestamp[] = "TIME";
+constexpr char kInputFrameRange[] = "FRAME_RANGE";
 constexpr char kOutputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kOutputSegment[] = "SEGMENT";
 
-const int kPredictionBegin = 25;
-const int kPredictionEnd = 75;
 const int kInputSize = 100;
 
 namespace mediapipe {
 namespace autoflip {
 
+namespace tf = tensorflow;
+
 // This calculator decodes the output of TransNetV2 and output the shot
 // change. Settings to control the shot change logic are presented in the
 // options proto.
 // 
 // The details of TransNetV2: https://github.com/soCzech/TransNetV2. 
 //
+// The inputs may hold a batch of windows, whose predictions and timestamps
+// are concatenated. The optional FRAME_RANGE input gives the [begin, end)
+// positions of the real frames in each window, see
+// PadLappedTensorBufferCalculator. Without it, the padding after the video is
+// found from its Timestamp::Done() TIME.
+//
+// The predictions are read from exactly one of:
+// PREDICTION: the predictions as a std::vector<float>.
+// TENSOR: the single-frame prediction tensor of TensorFlowInferenceCalculator
+//   as it is, a DT_FLOAT tf::Tensor of any shape, e.g. [1, 100, 1].
+// TENSORS: the output tensors of TfLiteInferenceCalculator, whose
+//   prediction_tensor_index tensor holds the single-frame predictions, as
+//   float32, or uint8 or int8 for a model with quantized outputs. The model
+//   has a fixed batch size, so the tensor may hold more windows than TIME,
+//   whose extra windows are ignored (see
+//   PadLappedTfLiteTensorBufferCalculator).
+//
+// A TIME packet without predictions is decoded as without shot boundary, for
+// the static windows which ShotBoundaryGateCalculator does not send to the
+// model.
+//
+// The predictions are logits. Instead of the sigmoid of every prediction,
+// they are compared with the logit of the threshold, computed once, or with
+// its quantized value.
+//
+// The first and last num_edge_frames predictions of each window are not
+// decoded. By default, the windows overlap by twice this number of frames, so
+// every frame is decoded in exactly one window. With a merge_mode, the windows
+// may overlap more, and the predictions of a frame decoded in several windows
+// are merged. The windows then overlap less than 50 frames with fewer edge
+// frames, which runs the model on fewer windows, e.g. 24 frames of overlap
+// with 10 edge frames. A frame is decoded once the next window arrives, or
+// at the end of the stream.
+//
+// The shot changes are output on at least one of:
+// IS_SHOT_CHANGE: a bool per decoded frame, or only true at the shot changes
+//   with output_only_on_change.
+// SEGMENT: a ShotSegment per shot, at the timestamp of its first frame, once
+//   the next shot change or the end of the stream ends it. The confidence is
+//   the sigmoid of the prediction of the shot change. On long shots, this is
+//   far fewer packets than one bool per frame. The timestamp bound of
+//   SEGMENT follows the start of the current shot, so a consumer which is
+//   synchronized with SEGMENT waits for each shot to end. IS_SHOT_CHANGE
+//   has no such latency.
+//
 // Example config:
 // node {
 //   calculator: "ShotBoundaryDecoderCalculator"
-//   input_stream: "PREDICTION:prediction_vector"
+//   input_stream: "TENSOR:prediction_tensor_single_frame"
 //   input_stream: "TIME:time_stamp"
+//   input_stream: "FRAME_RANGE:frame_range"
 //   output_stream: "IS_SHOT_CHANGE:is_shot"
+//   output_stream: "SEGMENT:shot_segment"
 //   options {
 //     [mediapipe.ShotBoundaryDecoderCalculatorOptions.ext] {
 //       threshold: 0.5
@@ -58,50 +117,267 @@ class ShotBoundaryDecoderCalculator : public CalculatorBase {
 
   ::mediapipe::Status Open(CalculatorContext* cc) override;
   ::mediapipe::Status Process(CalculatorContext* cc) override;
+  ::mediapipe::Status Close(CalculatorContext* cc) override;
 
  private:
-  double Sigmoid(float output);
-  // Transmits signal to next calculator.
+  // The predictions of a frame in the overlapping windows.
+  struct MergedPrediction {
+    double max_logit = -std::numeric_limits<double>::infinity();
+    double sum_logits = 0.0;
+    int count = 0;
+  };
+
+  // Decodes the windows of the predictions, whose real values are
+  // scale * (prediction - zero_point). Without predictions, the windows have
+  // no shot boundary.
+  template <typename T>
+  void DecodeWindows(CalculatorContext* cc, const T* input_predictions,
+                     float scale, int zero_point,
+                     const std::vector<Timestamp>& input_timestamps,
+                     const std::vector<std::pair<int, int>>* frame_ranges);
+  // Decodes the predictions [prediction_begin, prediction_end) of one window
+  // where a prediction above threshold is a shot change.
+  template <typename T>
+  void DecodeWindow(CalculatorContext* cc, const T* input_predictions,
+                    float scale, int zero_point, double threshold,
+                    const Timestamp* input_timestamps, int prediction_begin,
+                    int prediction_end);
+  // Merges the predictions [prediction_begin, prediction_end) of one window
+  // into pending_predictions_, after decoding the frames before them.
+  template <typename T>
+  void MergeWindow(CalculatorContext* cc, const T* input_predictions,
+                   float scale, int zero_point,
+                   const Timestamp* input_timestamps, int prediction_begin,
+                   int prediction_end);
+  // Decodes the pending predictions before end.
+  void DecodePendingPredictions(CalculatorContext* cc, Timestamp end);
+  // Transmits signal to next calculator. The logit of the prediction is only
+  // used for a shot change.
   void Transmit(mediapipe::CalculatorContext* cc, 
-              bool is_shot_change, Timestamp time);
+              bool is_shot_change, double logit, Timestamp time);
 
   ShotBoundaryDecoderCalculatorOptions options_;
+  // The logit of the threshold.
+  double logit_threshold_;
+  // Timestamp of the last decoded prediction.
+  Timestamp last_decoded_timestamp_;
+  // With a merge_mode, the predictions of the frames which the next window
+  // may overlap, by output timestamp.
+  std::map<Timestamp, MergedPrediction> pending_predictions_;
   // Last time a shot was detected.
   Timestamp last_shot_timestamp_;
+  // The shots of the SEGMENT output.
+  ShotSegmentBuilder segment_builder_{ShotSegment::SHOT_BOUNDARY_DETECTION};
 };
 
 REGISTER_CALCULATOR(ShotBoundaryDecoderCalculator);
 
 ::mediapipe::Status ShotBoundaryDecoderCalculator::GetContract(
     CalculatorContract* cc) {
-  cc->Inputs().Tag(kInputPrediction).Set<std::vector<float>>();
+  RET_CHECK_EQ(cc->Inputs().HasTag(kInputPrediction) +
+                   cc->Inputs().HasTag(kInputTensor) +
+                   cc->Inputs().HasTag(kInputTensors),
+               1)
+      << "Exactly one of PREDICTION, TENSOR and TENSORS must be set.";
+  if (cc->Inputs().HasTag(kInputPrediction)) {
+    cc->Inputs().Tag(kInputPrediction).Set<std::vector<float>>();
+  } else if (cc->Inputs().HasTag(kInputTensor)) {
+    cc->Inputs().Tag(kInputTensor).Set<tf::Tensor>();
+  } else {
+    cc->Inputs().Tag(kInputTensors).Set<std::vector<TfLiteTensor>>();
+  }
   cc->Inputs().Tag(kInputTimestamp).Set<std::vector<Timestamp>>();
+  if (cc->Inputs().HasTag(kInputFrameRange)) {
+    cc->Inputs().Tag(kInputFrameRange).Set<std::vector<std::pair<int, int>>>();
+  }
 
-  cc->Outputs().Tag(kOutputShotChange).Set<bool>();
+  RET_CHECK(cc->Outputs().HasTag(kOutputShotChange) ||
+            cc->Outputs().HasTag(kOutputSegment))
+      << "At least one of IS_SHOT_CHANGE and SEGMENT must be set.";
+  if (cc->Outputs().HasTag(kOutputShotChange)) {
+    cc->Outputs().Tag(kOutputShotChange).Set<bool>();
+  }
+  if (cc->Outputs().HasTag(kOutputSegment)) {
+    cc->Outputs().Tag(kOutputSegment).Set<ShotSegment>();
+  }
 
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status ShotBoundaryDecoderCalculator::Open(CalculatorContext* cc) {
   options_ = cc->Options<ShotBoundaryDecoderCalculatorOptions>();
+  RET_CHECK(options_.num_edge_frames() >= 0 &&
+            2 * options_.num_edge_frames() < kInputSize)
+      << "num_edge_frames must be in [0, " << kInputSize / 2 << ").";
   last_shot_timestamp_ = Timestamp(0);
+  last_decoded_timestamp_ = Timestamp::Unstarted();
+  // sigmoid(x) > threshold if and only if x > log(threshold / (1 - threshold)).
+  const double threshold = options_.threshold();
+  if (threshold <= 0.0) {
+    logit_threshold_ = -std::numeric_limits<double>::infinity();
+  } else if (threshold >= 1.0) {
+    logit_threshold_ = std::numeric_limits<double>::infinity();
+  } else {
+    logit_threshold_ = std::log(threshold / (1.0 - threshold));
+  }
 
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status ShotBoundaryDecoderCalculator::Process(
     CalculatorContext* cc) {
-  const auto& input_predictions 
-    = cc->Inputs().Tag(kInputPrediction).Get<std::vector<float>>();
   const auto& input_timestamps
     = cc->Inputs().Tag(kInputTimestamp).Get<std::vector<Timestamp>>();
-  RET_CHECK_EQ(input_predictions.size(), kInputSize)
-    << "Input PREDICTION size is not correct.";
-  RET_CHECK_EQ(input_timestamps.size(), kInputSize)
-    << "Input TIME size is not correct.";  
-  
-  for (int i = kPredictionBegin; i < kPredictionEnd; ++i) {
-    const auto& time = input_timestamps[i];
+  RET_CHECK(!input_timestamps.empty() &&
+            input_timestamps.size() % kInputSize == 0)
+    << "Input TIME size is not correct.";
+  const int num_windows = input_timestamps.size() / kInputSize;
+  const std::vector<std::pair<int, int>>* frame_ranges = nullptr;
+  if (cc->Inputs().HasTag(kInputFrameRange) &&
+      !cc->Inputs().Tag(kInputFrameRange).IsEmpty()) {
+    frame_ranges = &cc->Inputs()
+                        .Tag(kInputFrameRange)
+                        .Get<std::vector<std::pair<int, int>>>();
+    RET_CHECK_EQ(frame_ranges->size(), num_windows)
+      << "Input FRAME_RANGE size is not correct.";
+  }
+
+  const char* prediction_tag =
+      cc->Inputs().HasTag(kInputPrediction)
+          ? kInputPrediction
+          : cc->Inputs().HasTag(kInputTensor) ? kInputTensor : kInputTensors;
+  if (cc->Inputs().Tag(prediction_tag).IsEmpty()) {
+    DecodeWindows<float>(cc, nullptr, 1.0f, 0, input_timestamps, frame_ranges);
+  } else if (cc->Inputs().HasTag(kInputPrediction)) {
+    const auto& predictions
+      = cc->Inputs().Tag(kInputPrediction).Get<std::vector<float>>();
+    RET_CHECK_EQ(predictions.size(), input_timestamps.size())
+      << "Input PREDICTION size is not correct.";
+    DecodeWindows(cc, predictions.data(), 1.0f, 0, input_timestamps,
+                  frame_ranges);
+  } else if (cc->Inputs().HasTag(kInputTensor)) {
+    const auto& tensor = cc->Inputs().Tag(kInputTensor).Get<tf::Tensor>();
+    RET_CHECK_EQ(tensor.dtype(), tf::DT_FLOAT);
+    RET_CHECK_EQ(tensor.NumElements(), input_timestamps.size())
+      << "Input TENSOR size is not correct.";
+    DecodeWindows(cc, tensor.flat<float>().data(), 1.0f, 0, input_timestamps,
+                  frame_ranges);
+  } else {
+    const auto& tensors
+      = cc->Inputs().Tag(kInputTensors).Get<std::vector<TfLiteTensor>>();
+    RET_CHECK_LT(options_.prediction_tensor_index(), tensors.size())
+      << "No prediction tensor in TENSORS.";
+    const TfLiteTensor& tensor = tensors[options_.prediction_tensor_index()];
+    switch (tensor.type) {
+      case kTfLiteFloat32:
+        RET_CHECK_GE(tensor.bytes / sizeof(float), input_timestamps.size())
+          << "Input TENSORS size is not correct.";
+        DecodeWindows(cc, tensor.data.f, 1.0f, 0, input_timestamps,
+                      frame_ranges);
+        break;
+      case kTfLiteUInt8:
+        RET_CHECK_GT(tensor.params.scale, 0.0f);
+        RET_CHECK_GE(tensor.bytes, input_timestamps.size())
+          << "Input TENSORS size is not correct.";
+        DecodeWindows(cc, tensor.data.uint8, tensor.params.scale,
+                      tensor.params.zero_point, input_timestamps,
+                      frame_ranges);
+        break;
+      case kTfLiteInt8:
+        RET_CHECK_GT(tensor.params.scale, 0.0f);
+        RET_CHECK_GE(tensor.bytes, input_timestamps.size())
+          << "Input TENSORS size is not correct.";
+        DecodeWindows(cc, tensor.data.int8, tensor.params.scale,
+                      tensor.params.zero_point, input_timestamps,
+                      frame_ranges);
+        break;
+      default:
+        return ::mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+               << "Unsupported type of the prediction tensor: "
+               << tensor.type;
+    }
+  }
+  // The next shot is output at the start of the current one at the
+  // earliest.
+  if (cc->Outputs().HasTag(kOutputSegment) &&
+      segment_builder_.current_start() != Timestamp::Unset()) {
+    cc->Outputs().Tag(kOutputSegment).SetNextTimestampBound(
+        segment_builder_.current_start());
+  }
+  // The frames up to the last decoded one are settled, even without a shot
+  // change, e.g. for the consumers which also take the video frames.
+  if (cc->Outputs().HasTag(kOutputShotChange) &&
+      last_decoded_timestamp_ != Timestamp::Unstarted()) {
+    cc->Outputs().Tag(kOutputShotChange).SetNextTimestampBound(
+        last_decoded_timestamp_.NextAllowedInStream());
+  }
+
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotBoundaryDecoderCalculator::Close(
+    CalculatorContext* cc) {
+  DecodePendingPredictions(cc, Timestamp::Max());
+  ShotSegment segment;
+  if (cc->Outputs().HasTag(kOutputSegment) &&
+      segment_builder_.Finish(
+          segment_builder_.last_timestamp().NextAllowedInStream(), &segment)) {
+    cc->Outputs().Tag(kOutputSegment).AddPacket(
+        MakePacket<ShotSegment>(segment).At(
+            Timestamp(segment.start_timestamp_us())));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+template <typename T>
+void ShotBoundaryDecoderCalculator::DecodeWindows(
+    CalculatorContext* cc, const T* input_predictions, float scale,
+    int zero_point, const std::vector<Timestamp>& input_timestamps,
+    const std::vector<std::pair<int, int>>* frame_ranges) {
+  // A prediction q is above the logit threshold if and only if q is above
+  // its quantized value.
+  const double threshold = logit_threshold_ / scale + zero_point;
+  const int num_windows = input_timestamps.size() / kInputSize;
+  for (int window = 0; window < num_windows; ++window) {
+    int prediction_begin = options_.num_edge_frames();
+    // The prediction of a frame is output at the timestamp of the next frame,
+    // so the last real frame has none.
+    int prediction_end = kInputSize - options_.num_edge_frames();
+    if (frame_ranges != nullptr) {
+      prediction_begin =
+          std::max(prediction_begin, (*frame_ranges)[window].first);
+      prediction_end =
+          std::min(prediction_end, (*frame_ranges)[window].second - 1);
+    }
+    // The first shot starts at the first frame, whose prediction is the
+    // first decoded one.
+    const Timestamp first_frame =
+        input_timestamps[window * kInputSize + prediction_begin];
+    if (cc->Outputs().HasTag(kOutputSegment) &&
+        segment_builder_.last_timestamp() == Timestamp::Unset() &&
+        prediction_begin < prediction_end && first_frame != Timestamp::Done()) {
+      ShotSegment segment;
+      segment_builder_.AddFrame(first_frame, false, 0.0f, &segment);
+    }
+    if (options_.merge_mode() == ShotBoundaryDecoderCalculatorOptions::NONE) {
+      DecodeWindow(cc, input_predictions + window * kInputSize, scale,
+                   zero_point, threshold,
+                   &input_timestamps[window * kInputSize], prediction_begin,
+                   prediction_end);
+    } else {
+      MergeWindow(cc, input_predictions + window * kInputSize, scale,
+                  zero_point, &input_timestamps[window * kInputSize],
+                  prediction_begin, prediction_end);
+    }
+  }
+}
+
+template <typename T>
+void ShotBoundaryDecoderCalculator::DecodeWindow(
+    CalculatorContext* cc, const T* input_predictions, float scale,
+    int zero_point, double threshold, const Timestamp* input_timestamps,
+    int prediction_begin, int prediction_end) {
+  for (int i = prediction_begin; i < prediction_end; ++i) {
     const auto& next_time = input_timestamps[i+1];
     // Handle the padding after the video. The timestampd of 
     // the padding frames after the video are the timestamp of
@@ -109,35 +385,95 @@ REGISTER_CALCULATOR(ShotBoundaryDecoderCalculator);
     // pad_lapped_tensor_buffer_calculator.cc Close function. 
     if (next_time == Timestamp::Done())
       break;
+    // The frames already decoded in the previous window.
+    if (next_time <= last_decoded_timestamp_)
+      continue;
 
-    auto prediction =  Sigmoid(input_predictions[i]);
-    bool is_shot_change = prediction > options_.threshold();
-    Transmit(cc, is_shot_change, next_time);
+    bool is_shot_change =
+        input_predictions != nullptr && input_predictions[i] > threshold;
+    Transmit(cc, is_shot_change,
+             is_shot_change ? scale * (input_predictions[i] - zero_point) : 0.0,
+             next_time);
+    last_decoded_timestamp_ = next_time;
   }
-      
+}
 
-  return ::mediapipe::OkStatus();
+template <typename T>
+void ShotBoundaryDecoderCalculator::MergeWindow(
+    CalculatorContext* cc, const T* input_predictions, float scale,
+    int zero_point, const Timestamp* input_timestamps, int prediction_begin,
+    int prediction_end) {
+  if (prediction_begin >= prediction_end ||
+      input_timestamps[prediction_begin + 1] == Timestamp::Done()) {
+    return;
+  }
+  // The windows arrive in order, so the next windows start after this one
+  // and the frames before it are final.
+  DecodePendingPredictions(cc, input_timestamps[prediction_begin + 1]);
+  for (int i = prediction_begin; i < prediction_end; ++i) {
+    const auto& next_time = input_timestamps[i+1];
+    if (next_time == Timestamp::Done())
+      break;
+    if (next_time <= last_decoded_timestamp_)
+      continue;
+
+    MergedPrediction& merged = pending_predictions_[next_time];
+    if (input_predictions == nullptr)
+      continue;
+    const double logit = scale * (input_predictions[i] - zero_point);
+    merged.max_logit = std::max(merged.max_logit, logit);
+    merged.sum_logits += logit;
+    ++merged.count;
+  }
 }
 
-// The sigmoid function
-double ShotBoundaryDecoderCalculator:: Sigmoid(float output) {
-  return 1 / (1 + exp(-output));
+void ShotBoundaryDecoderCalculator::DecodePendingPredictions(
+    CalculatorContext* cc, Timestamp end) {
+  auto it = pending_predictions_.begin();
+  for (; it != pending_predictions_.end() && it->first < end; ++it) {
+    const MergedPrediction& merged = it->second;
+    // The frames only decoded in windows without predictions have no shot
+    // boundary.
+    const double logit =
+        options_.merge_mode() == ShotBoundaryDecoderCalculatorOptions::MAX
+            ? merged.max_logit
+            : merged.sum_logits / std::max(merged.count, 1);
+    const bool is_shot_change = merged.count > 0 && logit > logit_threshold_;
+    Transmit(cc, is_shot_change, logit, it->first);
+    last_decoded_timestamp_ = it->first;
+  }
+  pending_predictions_.erase(pending_predictions_.begin(), it);
 }
 
 void ShotBoundaryDecoderCalculator::Transmit(mediapipe::CalculatorContext* cc,
-        bool is_shot_change, Timestamp time) {
+        bool is_shot_change, double logit, Timestamp time) {
   if ((time - last_shot_timestamp_).Seconds() <
       options_.min_shot_span()) {
     is_shot_change = false;
   }
+  // The frames of the padding before the video may all have the timestamp
+  // of the first frame.
+  if (cc->Outputs().HasTag(kOutputSegment) &&
+      time > segment_builder_.last_timestamp()) {
+    ShotSegment segment;
+    if (segment_builder_.AddFrame(time, is_shot_change,
+                                  1.0 / (1.0 + std::exp(-logit)), &segment)) {
+      cc->Outputs().Tag(kOutputSegment).AddPacket(
+          MakePacket<ShotSegment>(segment).At(
+              Timestamp(segment.start_timestamp_us())));
+    }
+  }
   if (is_shot_change) {
     LOG(INFO) << "Shot change at: " << time.Seconds()
               << " seconds.";
-    cc->Outputs()
-        .Tag(kOutputShotChange)
-        .AddPacket(Adopt(std::make_unique<bool>(true).release())
-                       .At(time));
-  } else if (!options_.output_only_on_change()) {
+    if (cc->Outputs().HasTag(kOutputShotChange)) {
+      cc->Outputs()
+          .Tag(kOutputShotChange)
+          .AddPacket(Adopt(std::make_unique<bool>(true).release())
+                         .At(time));
+    }
+  } else if (!options_.output_only_on_change() &&
+             cc->Outputs().HasTag(kOutputShotChange)) {
     cc->Outputs()
         .Tag(kOutputShotChange)
         .AddPacket(Adopt(std::make_unique<bool>(false).release())
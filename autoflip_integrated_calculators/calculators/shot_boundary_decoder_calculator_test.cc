@@ -12,21 +12,32 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
+
 #include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_decoder_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/lite/interpreter.h"
 
 namespace mediapipe {
 namespace autoflip {
 
 namespace {
 
+namespace tf = tensorflow;
+
 constexpr char kInputPrediction[] = "PREDICTION";
+constexpr char kInputTensor[] = "TENSOR";
+constexpr char kInputTensors[] = "TENSORS";
 constexpr char kInputTimestamp[] = "TIME";
+constexpr char kInputFrameRange[] = "FRAME_RANGE";
 constexpr char kOutputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kOutputSegment[] = "SEGMENT";
 
 const float kNoBoundary = -5.0;
 const float KBoundary = 0.5;
@@ -40,11 +51,15 @@ const int kNumOfOutput = 49;
 
 class ShotBoundaryDecoderCalculatorTest : public ::testing::Test {
  protected:
-  void SetupCalculator(bool output_only_on_change) {
+  void SetupCalculator(bool output_only_on_change,
+                       bool input_frame_range = false) {
     CalculatorGraphConfig::Node config;
     config.set_calculator("ShotBoundaryDecoderCalculator");
     config.add_input_stream("PREDICTION:prediction_vector");
     config.add_input_stream("TIME:time_stamp");
+    if (input_frame_range) {
+      config.add_input_stream("FRAME_RANGE:frame_range");
+    }
     config.add_output_stream("IS_SHOT_CHANGE:is_shot");
     config.mutable_options()
       ->MutableExtension(ShotBoundaryDecoderCalculatorOptions::ext)
@@ -54,31 +69,33 @@ class ShotBoundaryDecoderCalculatorTest : public ::testing::Test {
   std::unique_ptr<CalculatorRunner> runner_;
 };
 
-void SetupInputs(const std::vector<int>& kBoundaryPosition, 
-                                CalculatorRunner* runner) {
-  auto input_value = ::absl::make_unique<std::vector<float>>();
-  auto input_time = ::absl::make_unique<std::vector<Timestamp>>();
-
-  // Setup input value
-  for (int i = 0; i < kBufferSize; ++i)
-    input_value->push_back(kNoBoundary);
+std::vector<float> MakePredictions(const std::vector<int>& kBoundaryPosition) {
+  std::vector<float> input_value(kBufferSize, kNoBoundary);
   for (auto position : kBoundaryPosition)
-    (*input_value)[kNumOfPadding+position] = KBoundary;
-    
-  // Setup input timestamp
+    input_value[kNumOfPadding+position] = KBoundary;
+  return input_value;
+}
+
+std::vector<Timestamp> MakeTimestamps() {
+  std::vector<Timestamp> input_time;
   for (int i = 0; i < kBufferSize; ++i) {
     if (i < kNumOfPadding)
-      input_time->push_back(Timestamp(0));
+      input_time.push_back(Timestamp(0));
     else if (i < kFramesPerProcess + kNumOfPadding)
-      input_time->push_back(Timestamp(i-kNumOfPadding));
+      input_time.push_back(Timestamp(i-kNumOfPadding));
     else
-      input_time->push_back(Timestamp::Done());
+      input_time.push_back(Timestamp::Done());
   }
+  return input_time;
+}
 
+void SetupInputs(const std::vector<int>& kBoundaryPosition, 
+                                CalculatorRunner* runner) {
   runner->MutableInputs()->Tag(kInputPrediction).packets.push_back(
-        Adopt(input_value.release()).At(Timestamp(0)));
+        MakePacket<std::vector<float>>(MakePredictions(kBoundaryPosition))
+            .At(Timestamp(0)));
   runner->MutableInputs()->Tag(kInputTimestamp).packets.push_back(
-        Adopt(input_time.release()).At(Timestamp(0)));
+        MakePacket<std::vector<Timestamp>>(MakeTimestamps()).At(Timestamp(0)));
 }
 
 void CheckOutputs(const std::vector<int>& kBoundaryPosition, 
@@ -160,6 +177,227 @@ TEST_F(ShotBoundaryDecoderCalculatorTest, ThreeBoundariesOutputOnlyOnChange) {
   CheckOutputs(kBoundaryPositionThree, num_output, runner_.get());
 }
 
+TEST_F(ShotBoundaryDecoderCalculatorTest, FrameRange) {
+  SetupCalculator(false, /*input_frame_range=*/true);
+  SetupInputs(kBoundaryPositionTwo, runner_.get());
+  // The real frames end before the Timestamp::Done() padding.
+  runner_->MutableInputs()->Tag(kInputFrameRange).packets.push_back(
+      Adopt(new std::vector<std::pair<int, int>>(
+                {std::make_pair(0, kNumOfPadding + 30)}))
+          .At(Timestamp(0)));
+  ASSERT_TRUE(runner_->Run().ok());
+  CheckOutputs(kBoundaryPositionTwo, 29, runner_.get());
+}
+TEST_F(ShotBoundaryDecoderCalculatorTest, BatchOfWindows) {
+  SetupCalculator(true);
+  // A batch of two windows, the second one follows the first one.
+  auto input_value = ::absl::make_unique<std::vector<float>>(
+      2 * kBufferSize, kNoBoundary);
+  auto input_time = ::absl::make_unique<std::vector<Timestamp>>();
+  for (int window = 0; window < 2; ++window) {
+    for (int i = 0; i < kBufferSize; ++i) {
+      input_time->push_back(Timestamp(
+          std::max(window * kFramesPerProcess + i - kNumOfPadding, 0)));
+    }
+  }
+  (*input_value)[kNumOfPadding + 12] = KBoundary;
+  (*input_value)[kBufferSize + kNumOfPadding + 36] = KBoundary;
+  runner_->MutableInputs()->Tag(kInputPrediction).packets.push_back(
+        Adopt(input_value.release()).At(Timestamp(0)));
+  runner_->MutableInputs()->Tag(kInputTimestamp).packets.push_back(
+        Adopt(input_time.release()).At(Timestamp(0)));
+  ASSERT_TRUE(runner_->Run().ok());
+  CheckOutputs({12, kFramesPerProcess + 36}, 2, runner_.get());
+}
+
+TEST_F(ShotBoundaryDecoderCalculatorTest, TfLiteTensors) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotBoundaryDecoderCalculator");
+  config.add_input_stream("TENSORS:prediction_tensors");
+  config.add_input_stream("TIME:time_stamp");
+  config.add_output_stream("IS_SHOT_CHANGE:is_shot");
+  config.mutable_options()
+      ->MutableExtension(ShotBoundaryDecoderCalculatorOptions::ext)
+      ->set_prediction_tensor_index(1);
+  CalculatorRunner runner(config);
+  // The predictions are the second tensor, in a batch of two windows whose
+  // second window completes the batch and is ignored.
+  std::vector<float> all_frame_predictions(2 * kBufferSize, KBoundary);
+  std::vector<float> predictions = MakePredictions(kBoundaryPositionTwo);
+  predictions.resize(2 * kBufferSize, KBoundary);
+  auto tensors = ::absl::make_unique<std::vector<TfLiteTensor>>(2);
+  for (int i = 0; i < 2; ++i) {
+    (*tensors)[i].type = kTfLiteFloat32;
+    (*tensors)[i].data.f =
+        i == 0 ? all_frame_predictions.data() : predictions.data();
+    (*tensors)[i].bytes = 2 * kBufferSize * sizeof(float);
+  }
+  runner.MutableInputs()->Tag(kInputTensors).packets.push_back(
+      Adopt(tensors.release()).At(Timestamp(0)));
+  runner.MutableInputs()->Tag(kInputTimestamp).packets.push_back(
+      MakePacket<std::vector<Timestamp>>(MakeTimestamps()).At(Timestamp(0)));
+  ASSERT_TRUE(runner.Run().ok());
+  CheckOutputs(kBoundaryPositionTwo, 2, &runner);
+}
+
+TEST_F(ShotBoundaryDecoderCalculatorTest, TfTensor) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotBoundaryDecoderCalculator");
+  config.add_input_stream("TENSOR:prediction_tensor");
+  config.add_input_stream("TIME:time_stamp");
+  config.add_output_stream("IS_SHOT_CHANGE:is_shot");
+  CalculatorRunner runner(config);
+  // The single-frame predictions of the model as they are, of shape
+  // [1, 100, 1].
+  auto tensor = ::absl::make_unique<tf::Tensor>(
+      tf::DT_FLOAT, tf::TensorShape({1, kBufferSize, 1}));
+  const std::vector<float> predictions =
+      MakePredictions(kBoundaryPositionThree);
+  std::copy(predictions.begin(), predictions.end(),
+            tensor->flat<float>().data());
+  runner.MutableInputs()->Tag(kInputTensor).packets.push_back(
+      Adopt(tensor.release()).At(Timestamp(0)));
+  runner.MutableInputs()->Tag(kInputTimestamp).packets.push_back(
+      MakePacket<std::vector<Timestamp>>(MakeTimestamps()).At(Timestamp(0)));
+  ASSERT_TRUE(runner.Run().ok());
+  CheckOutputs(kBoundaryPositionThree, 3, &runner);
+}
+
+TEST_F(ShotBoundaryDecoderCalculatorTest, WindowWithoutPredictions) {
+  SetupCalculator(false);
+  SetupInputs(kBoundaryPositionTwo, runner_.get());
+  // The next window was not sent to the model, and only has its TIME.
+  auto input_time = ::absl::make_unique<std::vector<Timestamp>>();
+  for (int i = 0; i < kBufferSize; ++i) {
+    input_time->push_back(Timestamp(i + kNumOfPadding));
+  }
+  runner_->MutableInputs()->Tag(kInputTimestamp).packets.push_back(
+      Adopt(input_time.release()).At(Timestamp(kFramesPerProcess)));
+  ASSERT_TRUE(runner_->Run().ok());
+  CheckOutputs(kBoundaryPositionTwo, kNumOfOutput + kFramesPerProcess,
+               runner_.get());
+}
+
+TEST_F(ShotBoundaryDecoderCalculatorTest, ShotSegments) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotBoundaryDecoderCalculator");
+  config.add_input_stream("PREDICTION:prediction_vector");
+  config.add_input_stream("TIME:time_stamp");
+  config.add_output_stream("SEGMENT:shot_segment");
+  CalculatorRunner runner(config);
+  SetupInputs(kBoundaryPositionTwo, &runner);
+  ASSERT_TRUE(runner.Run().ok());
+
+  // The shots of the frames [0, 7), [7, 26) and [26, 50).
+  const std::vector<Packet>& output_packets =
+      runner.Outputs().Tag(kOutputSegment).packets;
+  ASSERT_EQ(3, output_packets.size());
+  const int64 starts[] = {0, 7, 26};
+  const int64 ends[] = {7, 26, kFramesPerProcess};
+  for (int i = 0; i < 3; ++i) {
+    const auto& segment = output_packets[i].Get<ShotSegment>();
+    EXPECT_EQ(Timestamp(starts[i]), output_packets[i].Timestamp());
+    EXPECT_EQ(starts[i], segment.start_timestamp_us());
+    EXPECT_EQ(ends[i], segment.end_timestamp_us());
+    EXPECT_EQ(i > 0, segment.starts_with_shot_change());
+    EXPECT_EQ(ShotSegment::SHOT_BOUNDARY_DETECTION, segment.source());
+    if (i > 0) {
+      EXPECT_FLOAT_EQ(1.0 / (1.0 + std::exp(-KBoundary)),
+                      segment.confidence());
+    }
+  }
+}
+
+// Decodes two windows whose decoded frames overlap on the frames [76, 80),
+// with 10 edge frames and the windows of PadLappedTensorBufferCalculator with
+// 24 frames of overlap and 10 padding frames. Returns the timestamps of the
+// shot changes.
+std::vector<Timestamp> DecodeOverlappingWindows(
+    ShotBoundaryDecoderCalculatorOptions::MergeMode merge_mode) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotBoundaryDecoderCalculator");
+  config.add_input_stream("PREDICTION:prediction_vector");
+  config.add_input_stream("TIME:time_stamp");
+  config.add_input_stream("FRAME_RANGE:frame_range");
+  config.add_output_stream("IS_SHOT_CHANGE:is_shot");
+  auto* options = config.mutable_options()->MutableExtension(
+      ShotBoundaryDecoderCalculatorOptions::ext);
+  options->set_num_edge_frames(10);
+  options->set_merge_mode(merge_mode);
+  CalculatorRunner runner(config);
+  const int window_begins[] = {-10, 66};
+  // The predictions of the frames 77 and 78 in both windows.
+  const float predictions_77[] = {1.0, -3.0};
+  const float predictions_78[] = {-1.0, 2.0};
+  for (int window = 0; window < 2; ++window) {
+    const int begin = window_begins[window];
+    auto input_value =
+        ::absl::make_unique<std::vector<float>>(kBufferSize, kNoBoundary);
+    auto input_time = ::absl::make_unique<std::vector<Timestamp>>();
+    for (int i = 0; i < kBufferSize; ++i) {
+      input_time->push_back(Timestamp(std::max(begin + i, 0)));
+    }
+    (*input_value)[77 - begin] = predictions_77[window];
+    (*input_value)[78 - begin] = predictions_78[window];
+    const Timestamp packet_timestamp(begin + 10);
+    runner.MutableInputs()->Tag(kInputPrediction).packets.push_back(
+        Adopt(input_value.release()).At(packet_timestamp));
+    runner.MutableInputs()->Tag(kInputTimestamp).packets.push_back(
+        Adopt(input_time.release()).At(packet_timestamp));
+    runner.MutableInputs()->Tag(kInputFrameRange).packets.push_back(
+        Adopt(new std::vector<std::pair<int, int>>(
+                  {std::make_pair(std::max(-begin, 0), kBufferSize)}))
+            .At(packet_timestamp));
+  }
+  EXPECT_TRUE(runner.Run().ok());
+  std::vector<Timestamp> shot_changes;
+  for (const Packet& packet :
+       runner.Outputs().Tag(kOutputShotChange).packets) {
+    EXPECT_TRUE(packet.Get<bool>());
+    shot_changes.push_back(packet.Timestamp());
+  }
+  return shot_changes;
+}
+
+TEST_F(ShotBoundaryDecoderCalculatorTest, OverlappingWindows) {
+  // The first window decodes the overlapping frames.
+  EXPECT_EQ(std::vector<Timestamp>({Timestamp(78)}),
+            DecodeOverlappingWindows(
+                ShotBoundaryDecoderCalculatorOptions::NONE));
+  EXPECT_EQ(std::vector<Timestamp>({Timestamp(78), Timestamp(79)}),
+            DecodeOverlappingWindows(
+                ShotBoundaryDecoderCalculatorOptions::MAX));
+  EXPECT_EQ(std::vector<Timestamp>({Timestamp(79)}),
+            DecodeOverlappingWindows(
+                ShotBoundaryDecoderCalculatorOptions::MEAN));
+}
+
+TEST_F(ShotBoundaryDecoderCalculatorTest, QuantizedTfLiteTensor) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotBoundaryDecoderCalculator");
+  config.add_input_stream("TENSORS:prediction_tensors");
+  config.add_input_stream("TIME:time_stamp");
+  config.add_output_stream("IS_SHOT_CHANGE:is_shot");
+  CalculatorRunner runner(config);
+  // Logits in [-8, 8) quantized with a scale of 1/16 around 128. The logit
+  // threshold of 0.5 is 0, quantized to 128, which is not a shot change.
+  std::vector<uint8> predictions(kBufferSize, 128);
+  for (const int position : kBoundaryPositionTwo) {
+    predictions[kNumOfPadding + position] = 129;
+  }
+  auto tensors = ::absl::make_unique<std::vector<TfLiteTensor>>(1);
+  (*tensors)[0].type = kTfLiteUInt8;
+  (*tensors)[0].data.uint8 = predictions.data();
+  (*tensors)[0].bytes = kBufferSize;
+  (*tensors)[0].params.scale = 1.0f / 16;
+  (*tensors)[0].params.zero_point = 128;
+  runner.MutableInputs()->Tag(kInputTensors).packets.push_back(
+      Adopt(tensors.release()).At(Timestamp(0)));
+  runner.MutableInputs()->Tag(kInputTimestamp).packets.push_back(
+      MakePacket<std::vector<Timestamp>>(MakeTimestamps()).At(Timestamp(0)));
+  ASSERT_TRUE(runner.Run().ok());
+  CheckOutputs(kBoundaryPositionTwo, 2, &runner);
+}
 
 }  // namespace
 }  // namespace autoflip
@@ -0,0 +1,243 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_gate_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Frame change scores of the frames, see FrameChangeCalculator.
+constexpr char kInputScore[] = "SCORE";
+// The windows of PadLappedTensorBufferCalculator or
+// PadLappedTfLiteTensorBufferCalculator, of any type.
+constexpr char kWindow[] = "WINDOW";
+constexpr char kTime[] = "TIME";
+constexpr char kFrameRange[] = "FRAME_RANGE";
+
+constexpr int kInputSize = 100;
+
+// This calculator runs TransNetV2 only on the windows which may hold a shot
+// boundary. A WINDOW is sent to the model when a frame it decodes has a
+// SCORE of at least min_score, or has no SCORE. The other windows are
+// static: they are dropped, and ShotBoundaryDecoderCalculator decodes their
+// frames as without shot boundary from their TIME and FRAME_RANGE, which are
+// always output. On long shots, most windows are static and the model rarely
+// runs.
+//
+// The scores of the frames of a window arrive after the window, since it is
+// output at the timestamp of its first decoded frame. The windows wait for
+// them and are output at their own timestamps.
+//
+// Example:
+//    calculator: "ShotBoundaryGateCalculator"
+//    input_stream: "SCORE:frame_change"
+//    input_stream: "WINDOW:lapped_feature_tensor"
+//    input_stream: "TIME:time_stamp"
+//    input_stream: "FRAME_RANGE:frame_range"
+//    output_stream: "WINDOW:gated_feature_tensor"
+//    output_stream: "TIME:gated_time_stamp"
+//    output_stream: "FRAME_RANGE:gated_frame_range"
+class ShotBoundaryGateCalculator : public CalculatorBase {
+ public:
+  ShotBoundaryGateCalculator() {}
+  ~ShotBoundaryGateCalculator() override {}
+  ShotBoundaryGateCalculator(const ShotBoundaryGateCalculator&) = delete;
+  ShotBoundaryGateCalculator& operator=(const ShotBoundaryGateCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // A window waiting for the scores of its frames.
+  struct PendingWindow {
+    Packet window;
+    Packet time;
+    Packet frame_range;
+    // The output timestamps of the decoded predictions, the timestamps of
+    // the frames following the decoded frames.
+    std::vector<Timestamp> decoded_timestamps;
+  };
+
+  // Gets the output timestamps of the predictions which the decoder decodes
+  // in the windows.
+  ::mediapipe::Status GetDecodedTimestamps(
+      const Packet& time, const Packet& frame_range,
+      std::vector<Timestamp>* decoded_timestamps) const;
+  // Outputs the pending windows whose scores have arrived, or all of them.
+  void OutputWindows(mediapipe::CalculatorContext* cc, bool flush);
+  // Returns true if a decoded frame has a high score, or no score.
+  bool MayHoldShotBoundary(const std::vector<Timestamp>& decoded_timestamps);
+
+  ShotBoundaryGateCalculatorOptions options_;
+  // The scores since the first decoded frame of the pending windows.
+  std::deque<std::pair<Timestamp, float>> scores_;
+  std::deque<PendingWindow> pending_windows_;
+  int num_windows_ = 0;
+  int num_sent_windows_ = 0;
+};
+REGISTER_CALCULATOR(ShotBoundaryGateCalculator);
+
+::mediapipe::Status ShotBoundaryGateCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputScore).Set<float>();
+  cc->Inputs().Tag(kWindow).SetAny();
+  cc->Inputs().Tag(kTime).Set<std::vector<Timestamp>>();
+  cc->Outputs().Tag(kWindow).SetSameAs(&cc->Inputs().Tag(kWindow));
+  cc->Outputs().Tag(kTime).Set<std::vector<Timestamp>>();
+  if (cc->Inputs().HasTag(kFrameRange)) {
+    cc->Inputs().Tag(kFrameRange).Set<std::vector<std::pair<int, int>>>();
+    RET_CHECK(cc->Outputs().HasTag(kFrameRange))
+        << "FRAME_RANGE is an input but not an output.";
+    cc->Outputs().Tag(kFrameRange).Set<std::vector<std::pair<int, int>>>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotBoundaryGateCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  options_ = cc->Options<ShotBoundaryGateCalculatorOptions>();
+  RET_CHECK(options_.num_edge_frames() >= 0 &&
+            2 * options_.num_edge_frames() < kInputSize)
+      << "num_edge_frames must be in [0, " << kInputSize / 2 << ").";
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotBoundaryGateCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  if (!cc->Inputs().Tag(kInputScore).IsEmpty()) {
+    scores_.emplace_back(cc->InputTimestamp(),
+                         cc->Inputs().Tag(kInputScore).Get<float>());
+  }
+  if (!cc->Inputs().Tag(kTime).IsEmpty()) {
+    RET_CHECK(!cc->Inputs().Tag(kWindow).IsEmpty())
+        << "TIME without WINDOW.";
+    PendingWindow pending;
+    pending.window = cc->Inputs().Tag(kWindow).Value();
+    pending.time = cc->Inputs().Tag(kTime).Value();
+    if (cc->Inputs().HasTag(kFrameRange)) {
+      pending.frame_range = cc->Inputs().Tag(kFrameRange).Value();
+    }
+    MP_RETURN_IF_ERROR(GetDecodedTimestamps(
+        pending.time, pending.frame_range, &pending.decoded_timestamps));
+    pending_windows_.push_back(std::move(pending));
+  }
+  OutputWindows(cc, /*flush=*/false);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotBoundaryGateCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  OutputWindows(cc, /*flush=*/true);
+  LOG(INFO) << "Shot boundary gate: " << num_sent_windows_ << " of "
+            << num_windows_ << " windows sent to the model.";
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotBoundaryGateCalculator::GetDecodedTimestamps(
+    const Packet& time, const Packet& frame_range,
+    std::vector<Timestamp>* decoded_timestamps) const {
+  const auto& timestamps = time.Get<std::vector<Timestamp>>();
+  RET_CHECK(!timestamps.empty() && timestamps.size() % kInputSize == 0)
+      << "Input TIME size is not correct.";
+  const int num_windows = timestamps.size() / kInputSize;
+  const std::vector<std::pair<int, int>>* frame_ranges = nullptr;
+  if (!frame_range.IsEmpty()) {
+    frame_ranges = &frame_range.Get<std::vector<std::pair<int, int>>>();
+    RET_CHECK_EQ(frame_ranges->size(), num_windows)
+        << "Input FRAME_RANGE size is not correct.";
+  }
+  // The same predictions as ShotBoundaryDecoderCalculator.
+  for (int window = 0; window < num_windows; ++window) {
+    int begin = options_.num_edge_frames();
+    int end = kInputSize - options_.num_edge_frames();
+    if (frame_ranges != nullptr) {
+      begin = std::max(begin, (*frame_ranges)[window].first);
+      end = std::min(end, (*frame_ranges)[window].second - 1);
+    }
+    for (int i = begin; i < end; ++i) {
+      const Timestamp next_time = timestamps[window * kInputSize + i + 1];
+      if (next_time == Timestamp::Done()) {
+        break;
+      }
+      decoded_timestamps->push_back(next_time);
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void ShotBoundaryGateCalculator::OutputWindows(
+    mediapipe::CalculatorContext* cc, bool flush) {
+  const Timestamp last_score_timestamp =
+      scores_.empty() ? Timestamp::Unstarted() : scores_.back().first;
+  while (!pending_windows_.empty()) {
+    const PendingWindow& pending = pending_windows_.front();
+    const auto& decoded_timestamps = pending.decoded_timestamps;
+    if (!flush && !decoded_timestamps.empty() &&
+        decoded_timestamps.back() > last_score_timestamp) {
+      break;
+    }
+    ++num_windows_;
+    const Timestamp timestamp = pending.time.Timestamp();
+    if (MayHoldShotBoundary(decoded_timestamps)) {
+      ++num_sent_windows_;
+      cc->Outputs().Tag(kWindow).AddPacket(pending.window);
+    } else {
+      cc->Outputs().Tag(kWindow).SetNextTimestampBound(
+          timestamp.NextAllowedInStream());
+    }
+    cc->Outputs().Tag(kTime).AddPacket(pending.time);
+    if (cc->Outputs().HasTag(kFrameRange) && !pending.frame_range.IsEmpty()) {
+      cc->Outputs().Tag(kFrameRange).AddPacket(pending.frame_range);
+    }
+    // The next windows start after this one.
+    if (!decoded_timestamps.empty()) {
+      while (!scores_.empty() &&
+             scores_.front().first < decoded_timestamps.front()) {
+        scores_.pop_front();
+      }
+    }
+    pending_windows_.pop_front();
+  }
+}
+
+bool ShotBoundaryGateCalculator::MayHoldShotBoundary(
+    const std::vector<Timestamp>& decoded_timestamps) {
+  auto score = scores_.begin();
+  for (const Timestamp timestamp : decoded_timestamps) {
+    while (score != scores_.end() && score->first < timestamp) {
+      ++score;
+    }
+    if (score == scores_.end() || score->first != timestamp ||
+        score->second >= options_.min_score()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,104 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_gate_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kScore[] = "SCORE";
+constexpr char kWindow[] = "WINDOW";
+constexpr char kTime[] = "TIME";
+
+const int kBufferSize = 100;
+const int kNumOfPadding = 25;
+const int kFramesPerProcess = 50;
+
+// Runs the gate on a window of 50 frames whose frames have the given scores,
+// 0 when not given, and returns the number of windows sent to the model.
+int RunGate(const std::map<int, float>& scores, int num_scored_frames) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotBoundaryGateCalculator");
+  config.add_input_stream("SCORE:frame_change");
+  config.add_input_stream("WINDOW:lapped_feature_tensor");
+  config.add_input_stream("TIME:time_stamp");
+  config.add_output_stream("WINDOW:gated_feature_tensor");
+  config.add_output_stream("TIME:gated_time_stamp");
+  config.mutable_options()
+      ->MutableExtension(ShotBoundaryGateCalculatorOptions::ext)
+      ->set_min_score(0.2);
+  CalculatorRunner runner(config);
+  for (int i = 0; i < num_scored_frames; ++i) {
+    const auto score = scores.find(i);
+    runner.MutableInputs()->Tag(kScore).packets.push_back(
+        MakePacket<float>(score == scores.end() ? 0.0f : score->second)
+            .At(Timestamp(i)));
+  }
+  // The first window of PadLappedTensorBufferCalculator, padded with the
+  // first frame before and Timestamp::Done() after the frames.
+  auto input_time = ::absl::make_unique<std::vector<Timestamp>>();
+  for (int i = 0; i < kBufferSize; ++i) {
+    input_time->push_back(i < kNumOfPadding ? Timestamp(0)
+                          : i < kNumOfPadding + kFramesPerProcess
+                              ? Timestamp(i - kNumOfPadding)
+                              : Timestamp::Done());
+  }
+  runner.MutableInputs()->Tag(kWindow).packets.push_back(
+      MakePacket<int>(1).At(Timestamp(0)));
+  runner.MutableInputs()->Tag(kTime).packets.push_back(
+      Adopt(input_time.release()).At(Timestamp(0)));
+  EXPECT_TRUE(runner.Run().ok());
+
+  // The TIME of every window is output.
+  EXPECT_EQ(1, runner.Outputs().Tag(kTime).packets.size());
+  const auto& windows = runner.Outputs().Tag(kWindow).packets;
+  for (const Packet& window : windows) {
+    EXPECT_EQ(Timestamp(0), window.Timestamp());
+    EXPECT_EQ(1, window.Get<int>());
+  }
+  return windows.size();
+}
+
+TEST(ShotBoundaryGateCalculatorTest, DropsStaticWindow) {
+  EXPECT_EQ(0, RunGate({{10, 0.1f}, {49, 0.19f}}, kFramesPerProcess));
+}
+
+TEST(ShotBoundaryGateCalculatorTest, SendsWindowWithHighScore) {
+  EXPECT_EQ(1, RunGate({{30, 0.5f}}, kFramesPerProcess));
+  EXPECT_EQ(1, RunGate({{49, 0.2f}}, kFramesPerProcess));
+}
+
+TEST(ShotBoundaryGateCalculatorTest, IgnoresFramesNotDecoded) {
+  // The shot boundaries are decoded at the frames following the decoded
+  // frames, which the first frame is not.
+  EXPECT_EQ(0, RunGate({{0, 0.9f}}, kFramesPerProcess));
+}
+
+TEST(ShotBoundaryGateCalculatorTest, SendsWindowWithoutScores) {
+  // The last frame has no score.
+  EXPECT_EQ(1, RunGate({}, kFramesPerProcess - 1));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
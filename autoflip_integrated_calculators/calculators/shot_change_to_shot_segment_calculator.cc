@@ -0,0 +1,161 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_change_to_shot_segment_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_segment.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Shot change signals, e.g. of LipTrackCalculator or
+// ShotChangeFusingCalculator.
+constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
+// (Optional) A packet of any type per frame, e.g. the video frames.
+constexpr char kInputVideo[] = "VIDEO";
+// A ShotSegment per shot, at the timestamp of its first frame.
+constexpr char kOutputSegment[] = "SEGMENT";
+
+// This calculator converts a stream of bool shot change signals into a
+// ShotSegment per shot, for the producers without a SEGMENT output. A shot
+// starts at the first frame, and at every true packet. It is output once the
+// next shot change, or the end of the stream, ends it, and the last shot
+// ends right after the last frame.
+//
+// The frames are the timestamps of the VIDEO packets and of the shot change
+// signals. The producers only send the shot changes by default, e.g.
+// ShotBoundaryDecoderCalculator with output_only_on_change, so VIDEO must be
+// connected to know the first and the last frames. Without VIDEO, the input
+// must have a packet per frame, and the calculator fails when it only
+// receives shot changes.
+//
+// The timestamp bound of SEGMENT follows the start of the current shot, so
+// a consumer which is synchronized with SEGMENT waits for each shot to end.
+//
+// Example:
+//    calculator: "ShotChangeToShotSegmentCalculator"
+//    input_stream: "IS_SHOT_CHANGE:speaker_change"
+//    input_stream: "VIDEO:input_video"
+//    output_stream: "SEGMENT:speaker_segment"
+//    options {
+//      [mediapipe.autoflip.ShotChangeToShotSegmentCalculatorOptions.ext] {
+//        source: SPEAKER_CHANGE
+//      }
+//    }
+class ShotChangeToShotSegmentCalculator : public CalculatorBase {
+ public:
+  ShotChangeToShotSegmentCalculator() {}
+  ~ShotChangeToShotSegmentCalculator() override {}
+  ShotChangeToShotSegmentCalculator(const ShotChangeToShotSegmentCalculator&) =
+      delete;
+  ShotChangeToShotSegmentCalculator& operator=(
+      const ShotChangeToShotSegmentCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Fails when VIDEO is not connected and IS_SHOT_CHANGE has only had shot
+  // changes after its first packet, since the frames are then unknown.
+  ::mediapipe::Status CheckFrames(mediapipe::CalculatorContext* cc) const;
+  void OutputSegment(mediapipe::CalculatorContext* cc,
+                     const ShotSegment& segment);
+
+  std::unique_ptr<ShotSegmentBuilder> segment_builder_;
+  // Whether a frame without a shot change was received, which tells a
+  // signal per frame from the shot changes only.
+  bool has_frame_without_shot_change_ = false;
+};
+REGISTER_CALCULATOR(ShotChangeToShotSegmentCalculator);
+
+::mediapipe::Status ShotChangeToShotSegmentCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputShotChange).Set<bool>();
+  if (cc->Inputs().HasTag(kInputVideo)) {
+    cc->Inputs().Tag(kInputVideo).SetAny();
+  }
+  cc->Outputs().Tag(kOutputSegment).Set<ShotSegment>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotChangeToShotSegmentCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  segment_builder_ = absl::make_unique<ShotSegmentBuilder>(
+      cc->Options<ShotChangeToShotSegmentCalculatorOptions>().source());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotChangeToShotSegmentCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  const auto& shot_change = cc->Inputs().Tag(kInputShotChange);
+  const bool is_shot_change = !shot_change.IsEmpty() && shot_change.Get<bool>();
+  if (is_shot_change) {
+    MP_RETURN_IF_ERROR(CheckFrames(cc));
+  } else {
+    has_frame_without_shot_change_ = true;
+  }
+  ShotSegment segment;
+  // A bool signal is certain.
+  if (segment_builder_->AddFrame(cc->InputTimestamp(), is_shot_change,
+                                 /*confidence=*/1.0f, &segment)) {
+    OutputSegment(cc, segment);
+  }
+  // The next shot is output at the start of the current one at the
+  // earliest.
+  cc->Outputs().Tag(kOutputSegment).SetNextTimestampBound(
+      segment_builder_->current_start());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotChangeToShotSegmentCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(CheckFrames(cc));
+  ShotSegment segment;
+  if (segment_builder_->Finish(
+          segment_builder_->last_timestamp().NextAllowedInStream(),
+          &segment)) {
+    OutputSegment(cc, segment);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotChangeToShotSegmentCalculator::CheckFrames(
+    mediapipe::CalculatorContext* cc) const {
+  RET_CHECK(cc->Inputs().HasTag(kInputVideo) ||
+            has_frame_without_shot_change_ ||
+            segment_builder_->last_timestamp() == Timestamp::Unset())
+      << "IS_SHOT_CHANGE only has the shot changes. Connect VIDEO, or output "
+         "a signal per frame.";
+  return ::mediapipe::OkStatus();
+}
+
+void ShotChangeToShotSegmentCalculator::OutputSegment(
+    mediapipe::CalculatorContext* cc, const ShotSegment& segment) {
+  cc->Outputs()
+      .Tag(kOutputSegment)
+      .AddPacket(MakePacket<ShotSegment>(segment).At(
+          Timestamp(segment.start_timestamp_us())));
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
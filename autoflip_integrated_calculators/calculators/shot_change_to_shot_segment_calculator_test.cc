@@ -0,0 +1,132 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_change_to_shot_segment_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kSegment[] = "SEGMENT";
+constexpr char kVideo[] = "VIDEO";
+
+// Creates a runner with the shot change signals at the given timestamps,
+// and with the frames at video_timestamps on VIDEO unless it is empty.
+std::unique_ptr<CalculatorRunner> CreateRunner(
+    const std::vector<int>& timestamps, const std::vector<int>& shot_changes,
+    const std::vector<int>& video_timestamps) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotChangeToShotSegmentCalculator");
+  config.add_input_stream("IS_SHOT_CHANGE:speaker_change");
+  if (!video_timestamps.empty()) {
+    config.add_input_stream("VIDEO:input_video");
+  }
+  config.add_output_stream("SEGMENT:speaker_segment");
+  config.mutable_options()
+      ->MutableExtension(ShotChangeToShotSegmentCalculatorOptions::ext)
+      ->set_source(ShotSegment::SPEAKER_CHANGE);
+  auto runner = absl::make_unique<CalculatorRunner>(config);
+  for (const int timestamp : timestamps) {
+    const bool is_shot_change =
+        std::find(shot_changes.begin(), shot_changes.end(), timestamp) !=
+        shot_changes.end();
+    runner->MutableInputs()->Tag(kShotChange).packets.push_back(
+        MakePacket<bool>(is_shot_change).At(Timestamp(timestamp)));
+  }
+  for (const int timestamp : video_timestamps) {
+    runner->MutableInputs()->Tag(kVideo).packets.push_back(
+        MakePacket<int>(timestamp).At(Timestamp(timestamp)));
+  }
+  return runner;
+}
+
+// Converts the shot change signals, and returns the shots.
+std::vector<ShotSegment> RunCalculator(
+    const std::vector<int>& timestamps, const std::vector<int>& shot_changes,
+    const std::vector<int>& video_timestamps = {}) {
+  auto runner = CreateRunner(timestamps, shot_changes, video_timestamps);
+  EXPECT_TRUE(runner->Run().ok());
+  std::vector<ShotSegment> segments;
+  for (const Packet& packet : runner->Outputs().Tag(kSegment).packets) {
+    const auto& segment = packet.Get<ShotSegment>();
+    EXPECT_EQ(Timestamp(segment.start_timestamp_us()), packet.Timestamp());
+    EXPECT_EQ(ShotSegment::SPEAKER_CHANGE, segment.source());
+    segments.push_back(segment);
+  }
+  return segments;
+}
+
+TEST(ShotChangeToShotSegmentCalculatorTest, SignalOfEveryFrame) {
+  const auto segments =
+      RunCalculator({0, 10, 20, 30, 40, 50}, /*shot_changes=*/{20, 40});
+  ASSERT_EQ(3, segments.size());
+  EXPECT_EQ(0, segments[0].start_timestamp_us());
+  EXPECT_EQ(20, segments[0].end_timestamp_us());
+  EXPECT_FALSE(segments[0].starts_with_shot_change());
+  EXPECT_EQ(20, segments[1].start_timestamp_us());
+  EXPECT_EQ(40, segments[1].end_timestamp_us());
+  EXPECT_TRUE(segments[1].starts_with_shot_change());
+  EXPECT_FLOAT_EQ(1.0f, segments[1].confidence());
+  EXPECT_EQ(40, segments[2].start_timestamp_us());
+  // Right after the last frame.
+  EXPECT_EQ(51, segments[2].end_timestamp_us());
+}
+
+// The shot changes only, as with output_only_on_change, with the frames on
+// VIDEO.
+TEST(ShotChangeToShotSegmentCalculatorTest, OnlyShotChangesWithVideo) {
+  const auto segments =
+      RunCalculator({20, 40}, /*shot_changes=*/{20, 40},
+                    /*video_timestamps=*/{0, 10, 20, 30, 40, 50});
+  ASSERT_EQ(3, segments.size());
+  EXPECT_EQ(0, segments[0].start_timestamp_us());
+  EXPECT_EQ(20, segments[0].end_timestamp_us());
+  EXPECT_FALSE(segments[0].starts_with_shot_change());
+  EXPECT_EQ(20, segments[1].start_timestamp_us());
+  EXPECT_EQ(40, segments[1].end_timestamp_us());
+  EXPECT_TRUE(segments[1].starts_with_shot_change());
+  EXPECT_EQ(40, segments[2].start_timestamp_us());
+  // Right after the last frame, not after the shot change.
+  EXPECT_EQ(51, segments[2].end_timestamp_us());
+  EXPECT_TRUE(segments[2].starts_with_shot_change());
+}
+
+// Without VIDEO, the first and the last frames of the shot changes only are
+// unknown.
+TEST(ShotChangeToShotSegmentCalculatorTest, FailsOnOnlyShotChanges) {
+  EXPECT_FALSE(CreateRunner({20, 40}, /*shot_changes=*/{20, 40},
+                            /*video_timestamps=*/{})
+                   ->Run()
+                   .ok());
+  EXPECT_FALSE(CreateRunner({20}, /*shot_changes=*/{20},
+                            /*video_timestamps=*/{})
+                   ->Run()
+                   .ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
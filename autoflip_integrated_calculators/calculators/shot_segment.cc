@@ -0,0 +1,53 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_segment.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+bool ShotSegmentBuilder::AddFrame(Timestamp timestamp, bool is_shot_change,
+                                  float confidence, ShotSegment* segment) {
+  last_timestamp_ = timestamp;
+  if (has_current_ && !is_shot_change) {
+    return false;
+  }
+  const bool ended = has_current_;
+  if (ended) {
+    *segment = current_;
+    segment->set_end_timestamp_us(timestamp.Value());
+  }
+  current_.Clear();
+  current_.set_start_timestamp_us(timestamp.Value());
+  current_.set_source(source_);
+  if (is_shot_change) {
+    current_.set_starts_with_shot_change(true);
+    current_.set_confidence(confidence);
+  }
+  has_current_ = true;
+  return ended;
+}
+
+bool ShotSegmentBuilder::Finish(Timestamp end, ShotSegment* segment) {
+  if (!has_current_) {
+    return false;
+  }
+  *segment = current_;
+  segment->set_end_timestamp_us(end.Value());
+  has_current_ = false;
+  return true;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
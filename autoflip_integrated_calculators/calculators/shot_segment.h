@@ -0,0 +1,75 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SHOT_SEGMENT_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SHOT_SEGMENT_H_
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Builds the ShotSegments of a stream of shot change signals. A shot starts
+// at the first frame, and at every frame with a shot change.
+//
+// Example:
+//   ShotSegmentBuilder builder(ShotSegment::SHOT_BOUNDARY_DETECTION);
+//   ShotSegment segment;
+//   for (each frame) {
+//     if (builder.AddFrame(timestamp, is_shot_change, confidence, &segment)) {
+//       // The shot before the frame ended.
+//     }
+//   }
+//   if (builder.Finish(builder.last_timestamp().NextAllowedInStream(),
+//                      &segment)) {
+//     // The last shot.
+//   }
+class ShotSegmentBuilder {
+ public:
+  explicit ShotSegmentBuilder(ShotSegment::Source source) : source_(source) {}
+
+  // Adds the shot change signal of a frame, after the previous frames. The
+  // confidence is only used with a shot change. Returns true with the shot
+  // which the shot change ends, if any.
+  bool AddFrame(Timestamp timestamp, bool is_shot_change, float confidence,
+                ShotSegment* segment);
+
+  // Ends the current shot right before end. Returns true with the shot, if
+  // any frame was added since the last one ended.
+  bool Finish(Timestamp end, ShotSegment* segment);
+
+  // The timestamp of the last frame added, or Timestamp::Unset().
+  Timestamp last_timestamp() const { return last_timestamp_; }
+
+  // The start of the shot which is not ended yet, or Timestamp::Unset(). No
+  // later shot is output before it, so it is the timestamp bound of a stream
+  // of the shots.
+  Timestamp current_start() const {
+    return has_current_ ? Timestamp(current_.start_timestamp_us())
+                        : Timestamp::Unset();
+  }
+
+ private:
+  ShotSegment::Source source_;
+  // The shot which the next shot change ends.
+  ShotSegment current_;
+  bool has_current_ = false;
+  Timestamp last_timestamp_ = Timestamp::Unset();
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SHOT_SEGMENT_H_
@@ -0,0 +1,75 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_segment.h"
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+TEST(ShotSegmentBuilderTest, BuildsTheShots) {
+  ShotSegmentBuilder builder(ShotSegment::SHOT_BOUNDARY_DETECTION);
+  ShotSegment segment;
+  EXPECT_EQ(Timestamp::Unset(), builder.last_timestamp());
+  EXPECT_EQ(Timestamp::Unset(), builder.current_start());
+  // Shot changes at the frames 3 and 5 of 7.
+  for (int i = 0; i < 7; ++i) {
+    const bool is_shot_change = i == 3 || i == 5;
+    const bool ended =
+        builder.AddFrame(Timestamp(i), is_shot_change, 0.1f * i, &segment);
+    EXPECT_EQ(is_shot_change, ended);
+    if (i == 3) {
+      EXPECT_EQ(0, segment.start_timestamp_us());
+      EXPECT_EQ(3, segment.end_timestamp_us());
+      EXPECT_FALSE(segment.starts_with_shot_change());
+      EXPECT_FALSE(segment.has_confidence());
+      EXPECT_EQ(ShotSegment::SHOT_BOUNDARY_DETECTION, segment.source());
+    } else if (i == 5) {
+      EXPECT_EQ(3, segment.start_timestamp_us());
+      EXPECT_EQ(5, segment.end_timestamp_us());
+      EXPECT_TRUE(segment.starts_with_shot_change());
+      EXPECT_FLOAT_EQ(0.3f, segment.confidence());
+    }
+  }
+  EXPECT_EQ(Timestamp(6), builder.last_timestamp());
+  EXPECT_EQ(Timestamp(5), builder.current_start());
+  ASSERT_TRUE(builder.Finish(Timestamp(7), &segment));
+  EXPECT_EQ(5, segment.start_timestamp_us());
+  EXPECT_EQ(7, segment.end_timestamp_us());
+  EXPECT_FLOAT_EQ(0.5f, segment.confidence());
+  EXPECT_EQ(Timestamp::Unset(), builder.current_start());
+  EXPECT_FALSE(builder.Finish(Timestamp(8), &segment));
+}
+
+TEST(ShotSegmentBuilderTest, StartsWithShotChange) {
+  ShotSegmentBuilder builder(ShotSegment::SPEAKER_CHANGE);
+  ShotSegment segment;
+  EXPECT_FALSE(builder.Finish(Timestamp(0), &segment));
+  // Only the shot changes, as with output_only_on_change.
+  EXPECT_FALSE(builder.AddFrame(Timestamp(10), true, 1.0f, &segment));
+  ASSERT_TRUE(builder.AddFrame(Timestamp(20), true, 1.0f, &segment));
+  EXPECT_EQ(10, segment.start_timestamp_us());
+  EXPECT_EQ(20, segment.end_timestamp_us());
+  EXPECT_TRUE(segment.starts_with_shot_change());
+  EXPECT_EQ(ShotSegment::SPEAKER_CHANGE, segment.source());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,86 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// A ShotSegment per shot, e.g. of ShotBoundaryDecoderCalculator.
+constexpr char kInputSegment[] = "SEGMENT";
+// A true packet at the first frame of each shot which starts with a shot
+// change.
+constexpr char kOutputShotChange[] = "IS_SHOT_CHANGE";
+
+// This calculator converts the ShotSegments of a shot boundary detection
+// into the shot change signals of the consumers of bool packets, such as
+// ShotChangeFusingCalculator, as with output_only_on_change. There is one
+// packet per shot change instead of one per frame.
+//
+// A shot is only output once it ends, so a shot change is late by the length
+// of the shot which it starts, and the timestamp bound of IS_SHOT_CHANGE,
+// which follows the one of SEGMENT, stays at the start of the current shot.
+// A consumer which is synchronized with IS_SHOT_CHANGE waits for each shot
+// to end. The consumers which need the shot changes as soon as they are
+// decoded should use the bool output of the detector instead.
+//
+// Example:
+//    calculator: "ShotSegmentToShotChangeCalculator"
+//    input_stream: "SEGMENT:shot_segment"
+//    output_stream: "IS_SHOT_CHANGE:shot_change"
+class ShotSegmentToShotChangeCalculator : public CalculatorBase {
+ public:
+  ShotSegmentToShotChangeCalculator() {}
+  ~ShotSegmentToShotChangeCalculator() override {}
+  ShotSegmentToShotChangeCalculator(const ShotSegmentToShotChangeCalculator&) =
+      delete;
+  ShotSegmentToShotChangeCalculator& operator=(
+      const ShotSegmentToShotChangeCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+};
+REGISTER_CALCULATOR(ShotSegmentToShotChangeCalculator);
+
+::mediapipe::Status ShotSegmentToShotChangeCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputSegment).Set<ShotSegment>();
+  cc->Outputs().Tag(kOutputShotChange).Set<bool>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotSegmentToShotChangeCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotSegmentToShotChangeCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  const auto& segment = cc->Inputs().Tag(kInputSegment).Get<ShotSegment>();
+  if (segment.starts_with_shot_change()) {
+    cc->Outputs()
+        .Tag(kOutputShotChange)
+        .AddPacket(MakePacket<bool>(true).At(
+            Timestamp(segment.start_timestamp_us())));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,123 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kSegment[] = "SEGMENT";
+constexpr char kShotChange[] = "IS_SHOT_CHANGE";
+
+Packet MakeSegment(int64 start, int64 end, bool starts_with_shot_change) {
+  ShotSegment segment;
+  segment.set_start_timestamp_us(start);
+  segment.set_end_timestamp_us(end);
+  segment.set_starts_with_shot_change(starts_with_shot_change);
+  return MakePacket<ShotSegment>(segment).At(Timestamp(start));
+}
+
+TEST(ShotSegmentToShotChangeCalculatorTest, OutputsTheShotChanges) {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("ShotSegmentToShotChangeCalculator");
+  config.add_input_stream("SEGMENT:shot_segment");
+  config.add_output_stream("IS_SHOT_CHANGE:shot_change");
+  CalculatorRunner runner(config);
+  auto& segments = runner.MutableInputs()->Tag(kSegment).packets;
+  segments.push_back(MakeSegment(0, 7, false));
+  segments.push_back(MakeSegment(7, 26, true));
+  segments.push_back(MakeSegment(26, 50, true));
+  ASSERT_TRUE(runner.Run().ok());
+
+  const auto& shot_changes = runner.Outputs().Tag(kShotChange).packets;
+  ASSERT_EQ(2, shot_changes.size());
+  EXPECT_EQ(Timestamp(7), shot_changes[0].Timestamp());
+  EXPECT_EQ(Timestamp(26), shot_changes[1].Timestamp());
+  for (const Packet& packet : shot_changes) {
+    EXPECT_TRUE(packet.Get<bool>());
+  }
+}
+
+// The shot changes are output once the shot which they start ends, and the
+// frames synchronized with them wait for the current shot to end, but not
+// for the end of the stream.
+TEST(ShotSegmentToShotChangeCalculatorTest, FollowsTheCurrentShot) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "is_shot_change"
+    input_stream: "frame"
+    node {
+      calculator: "ShotChangeToShotSegmentCalculator"
+      input_stream: "IS_SHOT_CHANGE:is_shot_change"
+      output_stream: "SEGMENT:shot_segment"
+    }
+    node {
+      calculator: "ShotSegmentToShotChangeCalculator"
+      input_stream: "SEGMENT:shot_segment"
+      output_stream: "IS_SHOT_CHANGE:shot_change"
+    }
+    node {
+      calculator: "PassThroughCalculator"
+      input_stream: "frame"
+      input_stream: "shot_change"
+      output_stream: "synced_frame"
+      output_stream: "synced_shot_change"
+    }
+  )");
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(config));
+  std::vector<Timestamp> synced_frames;
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "synced_frame", [&synced_frames](const Packet& packet) {
+        synced_frames.push_back(packet.Timestamp());
+        return ::mediapipe::OkStatus();
+      }));
+  std::vector<Timestamp> shot_changes;
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "synced_shot_change", [&shot_changes](const Packet& packet) {
+        shot_changes.push_back(packet.Timestamp());
+        return ::mediapipe::OkStatus();
+      }));
+  MP_ASSERT_OK(graph.StartRun({}));
+  // Shot changes at the frames 2 and 4 of 6.
+  for (int i = 0; i < 6; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "is_shot_change", MakePacket<bool>(i == 2 || i == 4).At(Timestamp(i))));
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "frame", MakePacket<int>(i).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+  // The shot starting at 4 is not ended yet.
+  EXPECT_THAT(synced_frames, testing::ElementsAre(Timestamp(0), Timestamp(1),
+                                                  Timestamp(2), Timestamp(3)));
+  EXPECT_THAT(shot_changes, testing::ElementsAre(Timestamp(2)));
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+  EXPECT_EQ(6, synced_frames.size());
+  EXPECT_THAT(shot_changes, testing::ElementsAre(Timestamp(2), Timestamp(4)));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,161 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_shots.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// The look of a shot: stripes of a random orientation and frequency moving
+// over a random colour.
+struct ShotStyle {
+  float color[3];
+  float phase[3];
+  float amplitude;
+  float frequency_x;
+  float frequency_y;
+  float speed;
+};
+
+ShotStyle DrawShotStyle(std::mt19937* generator) {
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  ShotStyle style;
+  for (int c = 0; c < 3; ++c) {
+    style.color[c] = 40.0f + 175.0f * unit(*generator);
+    style.phase[c] = 2.0f * M_PI * unit(*generator);
+  }
+  style.amplitude = 20.0f + 20.0f * unit(*generator);
+  const float angle = M_PI * unit(*generator);
+  const float frequency = 0.1f + 0.5f * unit(*generator);
+  style.frequency_x = frequency * std::cos(angle);
+  style.frequency_y = frequency * std::sin(angle);
+  style.speed = 0.3f * (unit(*generator) - 0.5f);
+  return style;
+}
+
+// Value of a pixel of the frame t of a shot.
+float ShotPixel(const ShotStyle& style, int x, int y, int c, int t) {
+  return style.color[c] +
+         style.amplitude * std::sin(style.frequency_x * x +
+                                    style.frequency_y * y + style.speed * t +
+                                    style.phase[c]);
+}
+
+// Renders the frame t of a shot, blended with the frame next_t of the next
+// shot with the weight alpha.
+ImageFrame RenderFrame(const SyntheticShotOptions& options,
+                       const ShotStyle& style, int t,
+                       const ShotStyle& next_style, int next_t, float alpha) {
+  ImageFrame frame(ImageFormat::SRGB, options.frame_width,
+                   options.frame_height);
+  for (int y = 0; y < options.frame_height; ++y) {
+    uint8* row = frame.MutablePixelData() + y * frame.WidthStep();
+    for (int x = 0; x < options.frame_width; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        float value = ShotPixel(style, x, y, c, t);
+        if (alpha > 0.0f) {
+          value = (1.0f - alpha) * value +
+                  alpha * ShotPixel(next_style, x, y, c, next_t);
+        }
+        row[x * 3 + c] = std::min(std::max(std::lround(value), 0L), 255L);
+      }
+    }
+  }
+  return frame;
+}
+
+}  // namespace
+
+void GenerateSyntheticShots(const SyntheticShotOptions& options,
+                            std::vector<ImageFrame>* frames,
+                            std::vector<ShotTransition>* transitions) {
+  std::mt19937 generator(options.seed);
+  std::uniform_int_distribution<int> shot_frames(options.min_shot_frames,
+                                                 options.max_shot_frames);
+  std::uniform_int_distribution<int> dissolve_frames(
+      options.min_dissolve_frames, options.max_dissolve_frames);
+  std::bernoulli_distribution is_dissolve(options.dissolve_fraction);
+
+  ShotStyle style = DrawShotStyle(&generator);
+  // The first frame of the current shot, after the dissolve which starts it.
+  int t = 0;
+  for (int shot = 0; shot < options.num_shots; ++shot) {
+    const int shot_end = t + shot_frames(generator);
+    for (; t < shot_end; ++t) {
+      frames->push_back(RenderFrame(options, style, t, style, 0, 0.0f));
+    }
+    if (shot + 1 == options.num_shots) {
+      break;
+    }
+    const ShotStyle next_style = DrawShotStyle(&generator);
+    ShotTransition transition;
+    transition.begin = frames->size();
+    int next_t = 0;
+    if (is_dissolve(generator)) {
+      const int num_blended = dissolve_frames(generator);
+      for (; next_t < num_blended; ++next_t, ++t) {
+        const float alpha = (next_t + 1.0f) / (num_blended + 1.0f);
+        frames->push_back(
+            RenderFrame(options, style, t, next_style, next_t, alpha));
+      }
+    }
+    transition.end = frames->size();
+    transitions->push_back(transition);
+    style = next_style;
+    t = next_t;
+  }
+}
+
+BoundaryScore ScoreBoundaries(const std::vector<ShotTransition>& expected,
+                              const std::vector<int>& detected,
+                              int tolerance_frames) {
+  std::vector<int> detections;
+  for (int i = 0; i < detected.size(); ++i) {
+    if (i == 0 || detected[i] > detected[i - 1] + 1) {
+      detections.push_back(detected[i]);
+    }
+  }
+  int matches = 0;
+  int next = 0;
+  for (const ShotTransition& transition : expected) {
+    while (next < detections.size() &&
+           detections[next] < transition.begin - tolerance_frames) {
+      ++next;
+    }
+    if (next < detections.size() &&
+        detections[next] <= transition.end + tolerance_frames) {
+      ++matches;
+      ++next;
+    }
+  }
+  BoundaryScore score;
+  score.precision = detections.empty()
+                        ? 1.0
+                        : static_cast<double>(matches) / detections.size();
+  score.recall =
+      expected.empty() ? 1.0 : static_cast<double>(matches) / expected.size();
+  score.f1 = score.precision + score.recall > 0
+                 ? 2 * score.precision * score.recall /
+                       (score.precision + score.recall)
+                 : 0.0;
+  return score;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
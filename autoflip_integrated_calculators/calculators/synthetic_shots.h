@@ -0,0 +1,75 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SYNTHETIC_SHOTS_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SYNTHETIC_SHOTS_H_
+
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// A labelled transition between two shots. The first frame of the next shot
+// is a boundary anywhere in [begin, end]. A cut has begin == end, a dissolve
+// covers the blended frames and the first frame of the next shot.
+struct ShotTransition {
+  int begin;
+  int end;
+};
+
+// A sequence of shots of moving stripes, whose colours, orientations and
+// speeds are drawn for every shot. The shots are separated by cuts or by
+// dissolves, where the frames are blended from one shot to the next.
+struct SyntheticShotOptions {
+  int num_shots = 100;
+  int min_shot_frames = 40;
+  int max_shot_frames = 160;
+  // Fraction of the transitions which are dissolves instead of cuts.
+  float dissolve_fraction = 0.3f;
+  int min_dissolve_frames = 8;
+  int max_dissolve_frames = 24;
+  // The input size of TransNetV2.
+  int frame_width = 48;
+  int frame_height = 27;
+  uint32 seed = 0;
+};
+
+// Generates the SRGB frames of a synthetic sequence, and its transitions in
+// the order of the frames.
+void GenerateSyntheticShots(const SyntheticShotOptions& options,
+                            std::vector<ImageFrame>* frames,
+                            std::vector<ShotTransition>* transitions);
+
+struct BoundaryScore {
+  double precision;
+  double recall;
+  double f1;
+};
+
+// Scores the detected boundaries, the sorted indices of the frames starting
+// a shot, against the expected transitions, with tolerance_frames frames of
+// tolerance. Detections of consecutive frames count once, since a dissolve
+// may be detected on several frames. Each transition matches at most one
+// detection.
+BoundaryScore ScoreBoundaries(const std::vector<ShotTransition>& expected,
+                              const std::vector<int>& detected,
+                              int tolerance_frames);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SYNTHETIC_SHOTS_H_
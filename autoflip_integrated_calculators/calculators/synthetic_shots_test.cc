@@ -0,0 +1,94 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_shots.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// Mean absolute difference of the pixels of two frames.
+double FrameDifference(const ImageFrame& a, const ImageFrame& b) {
+  double sum = 0.0;
+  for (int y = 0; y < a.Height(); ++y) {
+    for (int x = 0; x < a.Width() * 3; ++x) {
+      sum += std::abs(a.PixelData()[y * a.WidthStep() + x] -
+                      b.PixelData()[y * b.WidthStep() + x]);
+    }
+  }
+  return sum / (a.Width() * a.Height() * 3);
+}
+
+TEST(SyntheticShotsTest, GeneratesCutsAndDissolves) {
+  SyntheticShotOptions options;
+  options.num_shots = 20;
+  options.dissolve_fraction = 0.5f;
+  std::vector<ImageFrame> frames;
+  std::vector<ShotTransition> transitions;
+  GenerateSyntheticShots(options, &frames, &transitions);
+
+  ASSERT_EQ(19, transitions.size());
+  EXPECT_GE(frames.size(), 20 * options.min_shot_frames);
+  EXPECT_LE(frames.size(), 20 * options.max_shot_frames +
+                               19 * options.max_dissolve_frames);
+  int num_cuts = 0;
+  int previous_end = 0;
+  for (const ShotTransition& transition : transitions) {
+    EXPECT_GT(transition.begin, previous_end);
+    EXPECT_LT(transition.end, frames.size());
+    EXPECT_EQ(48, frames[transition.end].Width());
+    EXPECT_EQ(27, frames[transition.end].Height());
+    const int length = transition.end - transition.begin;
+    if (length == 0) {
+      ++num_cuts;
+      // The frames change much more at a cut than within a shot.
+      EXPECT_GT(FrameDifference(frames[transition.end - 1],
+                                frames[transition.end]),
+                4 * FrameDifference(frames[transition.end - 2],
+                                    frames[transition.end - 1]));
+    } else {
+      EXPECT_GE(length, options.min_dissolve_frames);
+      EXPECT_LE(length, options.max_dissolve_frames);
+    }
+    previous_end = transition.end;
+  }
+  EXPECT_GT(num_cuts, 0);
+  EXPECT_LT(num_cuts, transitions.size());
+}
+
+TEST(SyntheticShotsTest, ScoresTheBoundaries) {
+  const std::vector<ShotTransition> expected = {{10, 10}, {30, 40}, {70, 70}};
+  // The dissolve is detected on three frames, which count once, and the
+  // boundary at 60 is wrong.
+  const BoundaryScore score =
+      ScoreBoundaries(expected, {12, 35, 36, 37, 60}, /*tolerance_frames=*/2);
+  EXPECT_DOUBLE_EQ(2.0 / 3.0, score.precision);
+  EXPECT_DOUBLE_EQ(2.0 / 3.0, score.recall);
+  EXPECT_DOUBLE_EQ(2.0 / 3.0, score.f1);
+
+  const BoundaryScore perfect = ScoreBoundaries(expected, {9, 40, 71}, 1);
+  EXPECT_DOUBLE_EQ(1.0, perfect.f1);
+  EXPECT_DOUBLE_EQ(0.0, ScoreBoundaries(expected, {}, 1).recall);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,96 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/track_table.h"
+
+#include <cstddef>
+
+namespace mediapipe {
+namespace autoflip {
+
+int TrackTable::AddTrack() {
+  tracks_.push_back({/* first_run = */ -1, /* last_run = */ -1,
+                     /* votes = */ 0});
+  return tracks_.size() - 1;
+}
+
+void TrackTable::Add(int track_id, int frame, int face_id) {
+  Track& track = tracks_[track_id];
+  if (track.last_run != -1) {
+    Run& last = runs_[track.last_run];
+    if (last.end() == frame && last.face_id == face_id) {
+      ++last.length;
+      return;
+    }
+  }
+  runs_.push_back({frame, /* length = */ 1, face_id, /* next = */ -1});
+  const int run_id = runs_.size() - 1;
+  if (track.last_run == -1) {
+    track.first_run = run_id;
+  } else {
+    runs_[track.last_run].next = run_id;
+  }
+  track.last_run = run_id;
+}
+
+int TrackTable::FaceId(int track_id, int frame) const {
+  for (int id = tracks_[track_id].first_run; id != -1; id = runs_[id].next) {
+    const Run& r = runs_[id];
+    if (frame < r.start) break;
+    if (frame < r.end()) return r.face_id;
+  }
+  return -1;
+}
+
+bool TrackTable::FindClosest(int track_id, int frame, int* found_frame,
+                             int* face_id) const {
+  bool found = false;
+  for (int id = tracks_[track_id].first_run; id != -1; id = runs_[id].next) {
+    const Run& r = runs_[id];
+    if (frame < r.start) {
+      // The first appearance after the frame, unless an earlier one is
+      // at least as close.
+      if (!found || r.start - frame < frame - *found_frame) {
+        *found_frame = r.start;
+        *face_id = r.face_id;
+      }
+      return true;
+    }
+    found = true;
+    *face_id = r.face_id;
+    *found_frame = frame < r.end() ? frame : r.end() - 1;
+    if (frame < r.end()) return true;
+  }
+  return found;
+}
+
+int TrackTable::MostVoted() const {
+  int most_voted = -1;
+  int max_votes = 0;
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    if (tracks_[i].votes > max_votes) {
+      most_voted = static_cast<int>(i);
+      max_votes = tracks_[i].votes;
+    }
+  }
+  return most_voted;
+}
+
+void TrackTable::Clear() {
+  tracks_.clear();
+  runs_.clear();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,86 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_TRACK_TABLE_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_TRACK_TABLE_H_
+
+#include <vector>
+
+namespace mediapipe {
+namespace autoflip {
+
+// Sparse table of the face tracks of a scene. A track only records the
+// frames where it appears, as runs of consecutive frames in which the face
+// keeps the same index in the frame. Every track also counts the frames in
+// which it is voted as the active speaker.
+//
+// All the runs are kept in one vector and chained per track, so adding a
+// track does not allocate once the table has grown.
+class TrackTable {
+ public:
+  // Consecutive frames [start, start + length) in which the track is the
+  // face face_id of the frame.
+  struct Run {
+    int start;
+    int length;
+    int face_id;
+    // Index of the next run of the track, or -1.
+    int next;
+    int end() const { return start + length; }
+  };
+
+  // Adds a track and returns its id. Track ids are consecutive from 0.
+  int AddTrack();
+  // Records that the track is the face face_id in the frame. The frames of
+  // a track have to be added in increasing order.
+  void Add(int track_id, int frame, int face_id);
+  // Adds a speaker vote to the track.
+  void Vote(int track_id) { ++tracks_[track_id].votes; }
+
+  // Returns the face id of the track in the frame, or -1 if the track does
+  // not appear in the frame.
+  int FaceId(int track_id, int frame) const;
+  // Finds the appearance of the track closest to the frame, preferring the
+  // earlier one on ties. Returns false if the track never appears.
+  bool FindClosest(int track_id, int frame, int* found_frame,
+                   int* face_id) const;
+  // Returns the track with the most votes (the first one on ties), or -1 if
+  // no track has a vote.
+  int MostVoted() const;
+
+  int votes(int track_id) const { return tracks_[track_id].votes; }
+  int num_tracks() const { return tracks_.size(); }
+  int num_runs() const { return runs_.size(); }
+  // Index of the first run of the track, or -1.
+  int first_run(int track_id) const { return tracks_[track_id].first_run; }
+  const Run& run(int run_id) const { return runs_[run_id]; }
+
+  // Removes all the tracks and keeps the storage.
+  void Clear();
+
+ private:
+  struct Track {
+    int first_run;
+    int last_run;
+    int votes;
+  };
+
+  std::vector<Track> tracks_;
+  std::vector<Run> runs_;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_TRACK_TABLE_H_
@@ -0,0 +1,97 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/track_table.h"
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+TEST(TrackTableTest, ConsecutiveFramesShareARun) {
+  TrackTable table;
+  int track = table.AddTrack();
+  for (int frame = 0; frame < 10; ++frame) {
+    table.Add(track, frame, 1);
+  }
+  EXPECT_EQ(1, table.num_runs());
+  const auto& run = table.run(table.first_run(track));
+  EXPECT_EQ(0, run.start);
+  EXPECT_EQ(10, run.length);
+  EXPECT_EQ(1, run.face_id);
+  EXPECT_EQ(-1, run.next);
+}
+
+TEST(TrackTableTest, FaceIdOfMissingAndPresentFrames) {
+  TrackTable table;
+  int track_1 = table.AddTrack();
+  int track_2 = table.AddTrack();
+  table.Add(track_1, 0, 0);
+  table.Add(track_1, 1, 0);
+  table.Add(track_2, 1, 1);
+  table.Add(track_1, 2, 1);
+  table.Add(track_1, 5, 1);
+  EXPECT_EQ(4, table.num_runs());
+  EXPECT_EQ(0, table.FaceId(track_1, 1));
+  EXPECT_EQ(1, table.FaceId(track_1, 2));
+  EXPECT_EQ(-1, table.FaceId(track_1, 3));
+  EXPECT_EQ(1, table.FaceId(track_1, 5));
+  EXPECT_EQ(-1, table.FaceId(track_1, 6));
+  EXPECT_EQ(-1, table.FaceId(track_2, 0));
+  EXPECT_EQ(1, table.FaceId(track_2, 1));
+}
+
+TEST(TrackTableTest, FindClosest) {
+  TrackTable table;
+  int track = table.AddTrack();
+  int empty_track = table.AddTrack();
+  table.Add(track, 2, 0);
+  table.Add(track, 3, 0);
+  table.Add(track, 7, 1);
+  int frame = -1, face_id = -1;
+  ASSERT_TRUE(table.FindClosest(track, 0, &frame, &face_id));
+  EXPECT_EQ(2, frame);
+  EXPECT_EQ(0, face_id);
+  ASSERT_TRUE(table.FindClosest(track, 5, &frame, &face_id));
+  EXPECT_EQ(3, frame);
+  ASSERT_TRUE(table.FindClosest(track, 6, &frame, &face_id));
+  EXPECT_EQ(7, frame);
+  EXPECT_EQ(1, face_id);
+  ASSERT_TRUE(table.FindClosest(track, 9, &frame, &face_id));
+  EXPECT_EQ(7, frame);
+  EXPECT_FALSE(table.FindClosest(empty_track, 0, &frame, &face_id));
+}
+
+TEST(TrackTableTest, MostVoted) {
+  TrackTable table;
+  EXPECT_EQ(-1, table.MostVoted());
+  int track_1 = table.AddTrack();
+  int track_2 = table.AddTrack();
+  EXPECT_EQ(-1, table.MostVoted());
+  table.Vote(track_2);
+  table.Vote(track_1);
+  EXPECT_EQ(track_1, table.MostVoted());
+  table.Vote(track_2);
+  EXPECT_EQ(track_2, table.MostVoted());
+  EXPECT_EQ(2, table.votes(track_2));
+  table.Clear();
+  EXPECT_EQ(0, table.num_tracks());
+  EXPECT_EQ(-1, table.MostVoted());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
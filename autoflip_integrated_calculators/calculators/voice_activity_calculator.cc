@@ -0,0 +1,365 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+
+#include "mediapipe/examples/desktop/autoflip/calculators/voice_activity_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/audio_decoder.h"
+#include "mediapipe/util/audio_decoder.pb.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Audio samples, channels x samples, as output by AudioDecoderCalculator.
+constexpr char kInputAudio[] = "AUDIO";
+// Stream whose timestamps the decisions are output at, usually the video
+// frames. Only the timestamps of its packets are used.
+constexpr char kInputVideo[] = "VIDEO";
+// Path of the audio track, as saved by OpenCvVideoDecoderCalculator. Used
+// instead of AUDIO; the path is empty when the video has no audio.
+constexpr char kAudioPath[] = "AUDIO_PATH";
+constexpr char kOutputIsSpeech[] = "IS_SPEECH";
+
+namespace {
+
+constexpr float kEpsilon = 1e-12f;
+
+// In-place iterative radix-2 FFT. The size of re and im is a power of two.
+void Fft(std::vector<float>* re, std::vector<float>* im) {
+  const int n = re->size();
+  for (int i = 1, j = 0; i < n; ++i) {
+    int bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      std::swap((*re)[i], (*re)[j]);
+      std::swap((*im)[i], (*im)[j]);
+    }
+  }
+  for (int length = 2; length <= n; length <<= 1) {
+    const double angle = -2.0 * M_PI / length;
+    const float w_re = std::cos(angle);
+    const float w_im = std::sin(angle);
+    for (int start = 0; start < n; start += length) {
+      float cur_re = 1.0f;
+      float cur_im = 0.0f;
+      for (int k = 0; k < length / 2; ++k) {
+        const int a = start + k;
+        const int b = a + length / 2;
+        const float b_re = (*re)[b] * cur_re - (*im)[b] * cur_im;
+        const float b_im = (*re)[b] * cur_im + (*im)[b] * cur_re;
+        (*re)[b] = (*re)[a] - b_re;
+        (*im)[b] = (*im)[a] - b_im;
+        (*re)[a] += b_re;
+        (*im)[a] += b_im;
+        const float next_re = cur_re * w_re - cur_im * w_im;
+        cur_im = cur_re * w_im + cur_im * w_re;
+        cur_re = next_re;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+// This calculator detects the spans of the audio track in which someone
+// speaks, so that the active speaker detection can skip the frames in which
+// no one can be speaking (music, silence).
+//
+// The mono mix of the audio is cut into frames. A frame is voiced when the
+// energy of the speech band is well above the noise floor, and it is speech
+// when the spectral flux of the band, averaged over the recent frames, is
+// high as well. Every packet of VIDEO gets a decision at its timestamp:
+// true if a speech frame ended less than hangover seconds before, or if no
+// audio is received yet so that videos without audio are not gated.
+//
+// The audio comes either from the AUDIO stream of AudioDecoderCalculator or
+// from the AUDIO_PATH side packet, in which case the track is decoded here
+// up to each VIDEO timestamp. AudioDecoderCalculator fails on the empty path
+// of a video without audio, so graphs that may see such videos should use
+// AUDIO_PATH.
+//
+// Example:
+//    calculator: "VoiceActivityCalculator"
+//    input_side_packet: "AUDIO_PATH:audio_path"
+//    input_stream: "VIDEO:input_video"
+//    output_stream: "IS_SPEECH:is_speech"
+class VoiceActivityCalculator : public CalculatorBase {
+ public:
+  VoiceActivityCalculator() {}
+  ~VoiceActivityCalculator() override {}
+  VoiceActivityCalculator(const VoiceActivityCalculator&) = delete;
+  VoiceActivityCalculator& operator=(const VoiceActivityCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Appends the mono mix of the samples and analyzes the complete frames.
+  void AddAudio(const Matrix& audio, Timestamp timestamp);
+  // Decodes the AUDIO_PATH track until a packet after the time is added.
+  ::mediapipe::Status DecodeAudioUntil(Timestamp timestamp);
+  // Analyzes the first frame_size_ pending samples.
+  void AnalyzeFrame(int64 frame_end_us);
+  // Returns true if the time is in a speech span.
+  bool IsSpeech(int64 time_us) const;
+
+  VoiceActivityCalculatorOptions options_;
+  // Decoder of the AUDIO_PATH track, null once the track is fully decoded or
+  // when there is no track.
+  std::unique_ptr<AudioDecoder> decoder_;
+  Timestamp last_audio_timestamp_ = Timestamp::Unset();
+  int frame_size_ = 0;
+  double frame_seconds_ = 0;
+  // FFT bins of the speech band, [min_bin_, max_bin_).
+  int min_bin_ = 0;
+  int max_bin_ = 0;
+  std::vector<float> window_;
+
+  // Mono samples not analyzed yet, starting at pending_start_us_.
+  std::vector<float> pending_;
+  int64 pending_start_us_ = 0;
+  bool has_audio_ = false;
+
+  // Band magnitudes of the current and the previous frame.
+  std::vector<float> magnitude_;
+  std::vector<float> prev_magnitude_;
+  bool has_prev_magnitude_ = false;
+  // FFT buffers.
+  std::vector<float> re_;
+  std::vector<float> im_;
+
+  float noise_floor_db_ = 0;
+  bool has_noise_floor_ = false;
+  float smoothed_flux_ = 0;
+  // End time of the last speech frame.
+  int64 last_speech_us_ = 0;
+  bool has_speech_ = false;
+};
+REGISTER_CALCULATOR(VoiceActivityCalculator);
+
+::mediapipe::Status VoiceActivityCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  RET_CHECK(cc->Inputs().HasTag(kInputAudio) !=
+            cc->InputSidePackets().HasTag(kAudioPath))
+      << "Exactly one of AUDIO and AUDIO_PATH must be connected.";
+  if (cc->Inputs().HasTag(kInputAudio)) {
+    cc->Inputs().Tag(kInputAudio).Set<Matrix>();
+  } else {
+    cc->InputSidePackets().Tag(kAudioPath).Set<std::string>();
+  }
+  cc->Inputs().Tag(kInputVideo).SetAny();
+  cc->Outputs().Tag(kOutputIsSpeech).Set<bool>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status VoiceActivityCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  options_ = cc->Options<VoiceActivityCalculatorOptions>();
+  RET_CHECK_GT(options_.frame_duration(), 0);
+  RET_CHECK_LT(options_.min_frequency(), options_.max_frequency());
+
+  double sample_rate = options_.sample_rate();
+  if (cc->Inputs().HasTag(kInputAudio)) {
+    const Packet& header = cc->Inputs().Tag(kInputAudio).Header();
+    if (!header.IsEmpty()) {
+      sample_rate = header.Get<TimeSeriesHeader>().sample_rate();
+    }
+  } else {
+    const std::string& audio_path =
+        cc->InputSidePackets().Tag(kAudioPath).Get<std::string>();
+    if (!audio_path.empty()) {
+      AudioDecoderOptions decoder_options;
+      decoder_options.add_audio_stream()->set_stream_index(0);
+      decoder_ = absl::make_unique<AudioDecoder>();
+      MP_RETURN_IF_ERROR(decoder_->Initialize(audio_path, decoder_options));
+      TimeSeriesHeader header;
+      if (decoder_->FillAudioHeader(decoder_options.audio_stream(0), &header)
+              .ok()) {
+        sample_rate = header.sample_rate();
+      }
+    }
+  }
+  RET_CHECK_GT(sample_rate, 0) << "Unknown audio sample rate.";
+
+  frame_size_ = 2;
+  while (frame_size_ < sample_rate * options_.frame_duration()) {
+    frame_size_ <<= 1;
+  }
+  frame_seconds_ = frame_size_ / sample_rate;
+  min_bin_ = std::max(
+      1, static_cast<int>(options_.min_frequency() * frame_size_ / sample_rate));
+  max_bin_ = std::min(
+      frame_size_ / 2,
+      static_cast<int>(options_.max_frequency() * frame_size_ / sample_rate) +
+          1);
+  RET_CHECK_LT(min_bin_, max_bin_) << "Empty speech band.";
+
+  window_.resize(frame_size_);
+  for (int i = 0; i < frame_size_; ++i) {
+    window_[i] = 0.5f - 0.5f * std::cos(2.0 * M_PI * i / frame_size_);
+  }
+  re_.resize(frame_size_);
+  im_.resize(frame_size_);
+  magnitude_.resize(max_bin_ - min_bin_);
+  prev_magnitude_.resize(max_bin_ - min_bin_);
+  pending_.reserve(2 * frame_size_);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status VoiceActivityCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  if (cc->Inputs().HasTag(kInputAudio) &&
+      !cc->Inputs().Tag(kInputAudio).IsEmpty()) {
+    AddAudio(cc->Inputs().Tag(kInputAudio).Get<Matrix>(), cc->InputTimestamp());
+  }
+  if (!cc->Inputs().Tag(kInputVideo).IsEmpty()) {
+    MP_RETURN_IF_ERROR(DecodeAudioUntil(cc->InputTimestamp()));
+    cc->Outputs()
+        .Tag(kOutputIsSpeech)
+        .Add(new bool(IsSpeech(cc->InputTimestamp().Value())),
+             cc->InputTimestamp());
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status VoiceActivityCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  if (decoder_ != nullptr) {
+    return decoder_->Close();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status VoiceActivityCalculator::DecodeAudioUntil(
+    Timestamp timestamp) {
+  // As with the AUDIO stream, the last added packet may end after the time.
+  while (decoder_ != nullptr && (last_audio_timestamp_ == Timestamp::Unset() ||
+                                 last_audio_timestamp_ <= timestamp)) {
+    Packet data;
+    int options_index = -1;
+    const ::mediapipe::Status status = decoder_->GetData(&options_index, &data);
+    if (!status.ok()) {
+      MP_RETURN_IF_ERROR(decoder_->Close());
+      decoder_.reset();
+      // The decoder reports the end of the track as OutOfRange.
+      if (status.code() != ::mediapipe::StatusCode::kOutOfRange) {
+        return status;
+      }
+      break;
+    }
+    last_audio_timestamp_ = data.Timestamp();
+    AddAudio(data.Get<Matrix>(), data.Timestamp());
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void VoiceActivityCalculator::AddAudio(const Matrix& audio,
+                                       Timestamp timestamp) {
+  if (audio.rows() == 0 || audio.cols() == 0) {
+    return;
+  }
+  if (pending_.empty()) {
+    pending_start_us_ = timestamp.Value();
+  }
+  has_audio_ = true;
+  const float scale = 1.0f / audio.rows();
+  for (int i = 0; i < audio.cols(); ++i) {
+    pending_.push_back(audio.col(i).sum() * scale);
+  }
+
+  const int64 frame_us = std::llround(frame_seconds_ * 1e6);
+  int consumed = 0;
+  while (static_cast<int>(pending_.size()) - consumed >= frame_size_) {
+    std::copy(pending_.begin() + consumed,
+              pending_.begin() + consumed + frame_size_, re_.begin());
+    consumed += frame_size_;
+    pending_start_us_ += frame_us;
+    AnalyzeFrame(pending_start_us_);
+  }
+  pending_.erase(pending_.begin(), pending_.begin() + consumed);
+}
+
+void VoiceActivityCalculator::AnalyzeFrame(int64 frame_end_us) {
+  for (int i = 0; i < frame_size_; ++i) {
+    re_[i] *= window_[i];
+  }
+  std::fill(im_.begin(), im_.end(), 0.0f);
+  Fft(&re_, &im_);
+
+  float power = 0;
+  float magnitude_sum = 0;
+  float flux = 0;
+  for (int bin = min_bin_; bin < max_bin_; ++bin) {
+    const float bin_power = re_[bin] * re_[bin] + im_[bin] * im_[bin];
+    const float magnitude = std::sqrt(bin_power);
+    const int k = bin - min_bin_;
+    power += bin_power;
+    magnitude_sum += magnitude;
+    if (has_prev_magnitude_) {
+      flux += std::max(0.0f, magnitude - prev_magnitude_[k]);
+    }
+    magnitude_[k] = magnitude;
+  }
+  magnitude_.swap(prev_magnitude_);
+  has_prev_magnitude_ = true;
+
+  // Power of a full scale sine in the band is about 0 dB.
+  const float window_gain = 0.375f * frame_size_ * frame_size_ / 4;
+  const float energy_db = 10.0f * std::log10(power / window_gain + kEpsilon);
+  if (!has_noise_floor_ || energy_db < noise_floor_db_) {
+    noise_floor_db_ = energy_db;
+    has_noise_floor_ = true;
+  } else {
+    noise_floor_db_ += options_.noise_floor_rise_db() * frame_seconds_;
+  }
+
+  const float alpha = static_cast<float>(
+      std::min(1.0, frame_seconds_ / options_.flux_smoothing()));
+  smoothed_flux_ += alpha * (flux / (magnitude_sum + kEpsilon) - smoothed_flux_);
+
+  const bool voiced =
+      energy_db >= options_.min_energy_db() &&
+      energy_db >= noise_floor_db_ + options_.min_energy_above_noise_db();
+  if (voiced && smoothed_flux_ >= options_.min_spectral_flux()) {
+    last_speech_us_ = frame_end_us;
+    has_speech_ = true;
+  }
+}
+
+bool VoiceActivityCalculator::IsSpeech(int64 time_us) const {
+  if (!has_audio_) {
+    return true;
+  }
+  return has_speech_ &&
+         last_speech_us_ + std::llround(options_.hangover() * 1e6) >= time_us;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
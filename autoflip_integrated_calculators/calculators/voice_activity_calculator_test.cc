@@ -0,0 +1,198 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputAudio[] = "AUDIO";
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kAudioPath[] = "AUDIO_PATH";
+constexpr char kOutputIsSpeech[] = "IS_SPEECH";
+
+constexpr int kSampleRate = 16000;
+constexpr int kAudioPacketSamples = 1024;
+constexpr int64 kVideoPeriodUs = 100000;
+
+const char kConfig[] = R"(
+    calculator: "VoiceActivityCalculator"
+    input_stream: "AUDIO:audio"
+    input_stream: "VIDEO:video"
+    output_stream: "IS_SPEECH:is_speech"
+    )";
+
+const char kAudioPathConfig[] = R"(
+    calculator: "VoiceActivityCalculator"
+    input_side_packet: "AUDIO_PATH:audio_path"
+    input_stream: "VIDEO:video"
+    output_stream: "IS_SPEECH:is_speech"
+    )";
+
+enum class Sound { kSilence, kSpeech, kMusic };
+
+// Speech-like sound: a tone that jumps to another pitch every 50 ms, with
+// a 4 Hz syllable envelope.
+float SpeechSample(int i) {
+  static const float kPitches[] = {500, 1100, 700, 1600, 900};
+  const float t = static_cast<float>(i) / kSampleRate;
+  const float pitch = kPitches[(i / (kSampleRate / 20)) % 5];
+  const float envelope = 0.6f + 0.4f * std::sin(2 * M_PI * 4 * t);
+  return 0.3f * envelope * std::sin(2 * M_PI * pitch * t);
+}
+
+// Steady chord.
+float MusicSample(int i) {
+  const float t = static_cast<float>(i) / kSampleRate;
+  return 0.2f * std::sin(2 * M_PI * 440 * t) +
+         0.2f * std::sin(2 * M_PI * 660 * t);
+}
+
+// Adds the audio of the sounds, each lasting one second, and video frames
+// over the whole duration.
+void AddInputs(const std::vector<Sound>& sounds, CalculatorRunner* runner) {
+  const int num_samples = sounds.size() * kSampleRate;
+  for (int start = 0; start < num_samples; start += kAudioPacketSamples) {
+    const int packet_samples =
+        std::min(kAudioPacketSamples, num_samples - start);
+    auto audio = absl::make_unique<Matrix>(2, packet_samples);
+    for (int i = 0; i < packet_samples; ++i) {
+      const int sample = start + i;
+      float value = 0;
+      switch (sounds[sample / kSampleRate]) {
+        case Sound::kSilence:
+          break;
+        case Sound::kSpeech:
+          value = SpeechSample(sample);
+          break;
+        case Sound::kMusic:
+          value = MusicSample(sample);
+          break;
+      }
+      (*audio)(0, i) = value;
+      (*audio)(1, i) = value;
+    }
+    const int64 timestamp = static_cast<int64>(start) * 1000000 / kSampleRate;
+    runner->MutableInputs()->Tag(kInputAudio).packets.push_back(
+        Adopt(audio.release()).At(Timestamp(timestamp)));
+  }
+  for (int64 t = 0; t < sounds.size() * 1000000; t += kVideoPeriodUs) {
+    runner->MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(new int(0)).At(Timestamp(t)));
+  }
+  auto header = absl::make_unique<TimeSeriesHeader>();
+  header->set_sample_rate(kSampleRate);
+  header->set_num_channels(2);
+  runner->MutableInputs()->Tag(kInputAudio).header = Adopt(header.release());
+}
+
+// Returns the decision of the video frame at the time.
+bool IsSpeechAt(const CalculatorRunner& runner, int64 time_us) {
+  for (const auto& packet : runner.Outputs().Tag(kOutputIsSpeech).packets) {
+    if (packet.Timestamp() == Timestamp(time_us)) {
+      return packet.Get<bool>();
+    }
+  }
+  ADD_FAILURE() << "No decision at " << time_us;
+  return false;
+}
+
+TEST(VoiceActivityCalculatorTest, DetectsSpeech) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddInputs({Sound::kSilence, Sound::kSpeech, Sound::kSpeech, Sound::kSilence,
+             Sound::kSilence},
+            &runner);
+  MP_ASSERT_OK(runner.Run());
+
+  EXPECT_EQ(50, runner.Outputs().Tag(kOutputIsSpeech).packets.size());
+  for (int64 t = 0; t < 1000000; t += kVideoPeriodUs) {
+    EXPECT_FALSE(IsSpeechAt(runner, t)) << t;
+  }
+  for (int64 t = 1300000; t < 3000000; t += kVideoPeriodUs) {
+    EXPECT_TRUE(IsSpeechAt(runner, t)) << t;
+  }
+  // Speech is kept for the hangover after the last speech frame.
+  EXPECT_TRUE(IsSpeechAt(runner, 3300000));
+  for (int64 t = 3700000; t < 5000000; t += kVideoPeriodUs) {
+    EXPECT_FALSE(IsSpeechAt(runner, t)) << t;
+  }
+}
+
+TEST(VoiceActivityCalculatorTest, IgnoresSteadyMusic) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddInputs({Sound::kSilence, Sound::kMusic, Sound::kMusic, Sound::kSpeech},
+            &runner);
+  MP_ASSERT_OK(runner.Run());
+
+  for (int64 t = 1100000; t < 3000000; t += kVideoPeriodUs) {
+    EXPECT_FALSE(IsSpeechAt(runner, t)) << t;
+  }
+  for (int64 t = 3300000; t < 4000000; t += kVideoPeriodUs) {
+    EXPECT_TRUE(IsSpeechAt(runner, t)) << t;
+  }
+}
+
+TEST(VoiceActivityCalculatorTest, AllowsVideoWithoutAudio) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  for (int64 t = 0; t < 1000000; t += kVideoPeriodUs) {
+    runner.MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(new int(0)).At(Timestamp(t)));
+  }
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputIsSpeech).packets;
+  ASSERT_EQ(10, packets.size());
+  for (const auto& packet : packets) {
+    EXPECT_TRUE(packet.Get<bool>());
+  }
+}
+
+// OpenCvVideoDecoderCalculator saves an empty audio path for a video without
+// audio. The graph must not fail on it and no frame must be gated.
+TEST(VoiceActivityCalculatorTest, AllowsEmptyAudioPath) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kAudioPathConfig));
+  runner.MutableSidePackets()->Tag(kAudioPath) = MakePacket<std::string>("");
+  for (int64 t = 0; t < 1000000; t += kVideoPeriodUs) {
+    runner.MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(new int(0)).At(Timestamp(t)));
+  }
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& packets = runner.Outputs().Tag(kOutputIsSpeech).packets;
+  ASSERT_EQ(10, packets.size());
+  for (const auto& packet : packets) {
+    EXPECT_TRUE(packet.Get<bool>());
+  }
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe